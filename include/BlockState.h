@@ -3,40 +3,119 @@
 
 #include "DataTypes/Identifier.h"
 #include "SFW/LoggerManager.h"
+#include <array>
 #include <cstdint>
 #include <initializer_list>
+#include <iterator>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <variant>
-#include <map>
 #include <format>
 namespace mc
 {
+    // Property names and values are interned, a state keeps a 16 bit name id and value id per
+    // property inline, sorted by name id, so it never allocates and compares as a few integers.
+    // Values are interned by their text: "true" and true, "5" and 5 are the same value and read
+    // back as bool and int, which is how the strings of the block report match typed properties
     class BlockState
     {
     public:
         using PropertyValue = std::variant<int, bool, std::string>;
-        using PropertyMap = std::map<std::string, PropertyValue>;
-        using Property = PropertyMap::value_type;
-        
-        BlockState()=default;
-        BlockState(Identifier blockIdentifier)
-            : m_ID(std::move(blockIdentifier))
-        {}
-
-        BlockState(Identifier blockIdentifier, std::initializer_list<Property> properties)
-            : m_ID(std::move(blockIdentifier)), m_properties(properties)
-        {}
+        using Property = std::pair<std::string, PropertyValue>;
+
+        // chiseled_bookshelf has the most with 7
+        constexpr static size_t MAX_PROPERTIES = 8;
+
+        struct PackedProperty
+        {
+            std::uint16_t name;
+            std::uint16_t value;
+
+            bool operator==(const PackedProperty&) const = default;
+        };
+
+        // Read only view over the properties as (name, value) pairs
+        class PropertyView
+        {
+        public:
+            using value_type = std::pair<std::string_view, const PropertyValue&>;
+
+            class Iterator
+            {
+            public:
+                using value_type        = PropertyView::value_type;
+                using difference_type   = std::ptrdiff_t;
+                using iterator_category = std::forward_iterator_tag;
+
+                // Lets it->second work although the pair is built on the fly
+                struct Arrow
+                {
+                    value_type pair;
+                    inline const value_type* operator->() const noexcept { return &pair; }
+                };
+
+                Iterator() noexcept : m_property(nullptr) {}
+                Iterator(const PackedProperty* property) noexcept : m_property(property) {}
+
+                inline value_type operator*() const noexcept { return { NameOf(m_property->name), ValueOf(m_property->value) }; }
+                inline Arrow operator->() const noexcept { return { **this }; }
+
+                inline Iterator& operator++() noexcept { ++m_property; return *this; }
+                inline Iterator operator++(int) noexcept { Iterator old = *this; ++m_property; return old; }
+                bool operator==(const Iterator&) const = default;
+
+            private:
+                const PackedProperty* m_property;
+            };
+
+            PropertyView(std::span<const PackedProperty> properties) noexcept : m_properties(properties) {}
+
+            inline Iterator begin() const noexcept { return m_properties.data(); }
+            inline Iterator end() const noexcept { return m_properties.data() + m_properties.size(); }
+            inline size_t size() const noexcept { return m_properties.size(); }
+            inline bool empty() const noexcept { return m_properties.empty(); }
+
+            // end() if there is no such property
+            Iterator find(std::string_view name) const noexcept;
+            inline bool contains(std::string_view name) const noexcept { return find(name) != end(); }
+
+            bool operator==(const PropertyView& other) const noexcept;
+
+        private:
+            std::span<const PackedProperty> m_properties;
+        };
+
+        BlockState();
+        BlockState(Identifier blockIdentifier);
+        BlockState(Identifier blockIdentifier, std::initializer_list<Property> properties);
         ~BlockState() = default;
 
         inline const Identifier& GetID() const noexcept { return m_ID; }
-        inline const PropertyMap& GetProperties() const noexcept { return m_properties; }
+        inline PropertyView GetProperties() const noexcept { return GetPackedProperties(); }
+        inline std::span<const PackedProperty> GetPackedProperties() const noexcept { return { m_properties.data(), m_size }; }
 
-        inline void AddProperty(std::string_view name, PropertyValue value) { m_properties.emplace(name, value); }
+        // Like inserting into a map a property that is already set keeps its value.
+        // Throws std::length_error past MAX_PROPERTIES
+        void AddProperty(std::string_view name, const PropertyValue& value);
+        void AddProperty(PackedProperty property);
+
+        inline bool operator==(const BlockState& other) const noexcept { return m_ID == other.m_ID && GetProperties() == other.GetProperties(); }
+
+        static std::uint16_t InternName(std::string_view name);
+        static std::uint16_t InternValue(const PropertyValue& value);
+        // Never add anything, empty if the name or value was never interned
+        static std::optional<std::uint16_t> FindName(std::string_view name) noexcept;
+        static std::optional<std::uint16_t> FindValue(const PropertyValue& value);
+        static std::string_view NameOf(std::uint16_t name) noexcept;
+        static const PropertyValue& ValueOf(std::uint16_t value) noexcept;
 
     private:
         Identifier m_ID;
-        PropertyMap m_properties;
+        std::uint8_t m_size;
+        std::array<PackedProperty, MAX_PROPERTIES> m_properties;
     };
 }
 
@@ -44,22 +123,23 @@ namespace mc
 namespace std
 {
 
+    // Ids only, nothing is formatted or allocated
     template<>
     class hash<mc::BlockState>
     {
     public:
         std::uint64_t operator()(const mc::BlockState& blockState) const
         {
-#if NDEBUG
-            return std::hash<std::string>()
-            (
-                format("{}[{}]", blockState.GetID(), blockState.GetProperties())
-            );
-#else
-            std::string hashedString = std::format("{}[{}]",blockState.GetID(), blockState.GetProperties());
-            std::uint64_t hash = std::hash<std::string>()(hashedString);
-            return hash; 
-#endif
+            std::uint64_t seed = std::hash<mc::Identifier>()(blockState.GetID());
+            for (const auto& property : blockState.GetPackedProperties())
+                combine(seed, std::uint64_t(property.name) << 16 | property.value);
+            return seed;
+        }
+
+    private:
+        static inline void combine(std::uint64_t& seed, std::uint64_t value) noexcept
+        {
+            seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
         }
     };
     
@@ -68,21 +148,7 @@ namespace std
     {
         bool operator()(const mc::BlockState& lhs, const mc::BlockState& rhs) const
         {
-            auto& lhsProperties = lhs.GetProperties();
-            auto& rhsProperties = rhs.GetProperties();
-
-            if (lhs.GetID() != rhs.GetID())
-                return false;
-
-            for (const auto& [property, value] : lhsProperties)
-            {
-                if(!rhsProperties.contains(property))
-                    return false;
-                if(value != rhsProperties.at(property))
-                    return false;
-
-            }
-            return true;
+            return lhs == rhs;
         }
     };
 /*
@@ -0,0 +1,55 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <SFW/Serializer.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Recycled outbound buffers. Packets are serialized into a vector taken from here, moved
+// through the transport as is and given back once the socket took it, so after warm up the
+// send path doesn't allocate.
+// Capacities are rounded up to a power of two and every thread keeps its own free lists, no
+// locking at all. A buffer released on another thread than the one that acquired it just
+// lands in that thread's lists
+namespace mc::pool
+{
+    constexpr size_t MIN_CLASS_SIZE   = 256;
+    // Anything bigger is allocated and freed as usual
+    constexpr size_t MAX_CLASS_SIZE   = 1 << 20;
+    // Per thread limits, buffers past them are freed on release
+    constexpr size_t MAX_PER_CLASS    = 32;
+    constexpr size_t MAX_CACHED_BYTES = 8 * 1024 * 1024;
+
+    struct Stats
+    {
+        // acquire served from a free list / by a new allocation
+        size_t hits;
+        size_t misses;
+        size_t cachedBytes;
+    };
+
+    // Empty buffer with room for at least capacity bytes
+    std::vector<std::uint8_t> acquire(size_t capacity);
+    // Takes the buffer back whatever it holds, it is cleared before being handed out again
+    void release(std::vector<std::uint8_t>&& buffer) noexcept;
+
+    // Calling thread only
+    Stats stats() noexcept;
+
+    // Serializes into a pooled buffer, sized up front when the serializer knows the size
+    template<typename T>
+    std::vector<std::uint8_t> serialize(const T& object)
+    {
+        iu::Serializer<T> serializer;
+        size_t capacity = MIN_CLASS_SIZE;
+        if constexpr (requires { serializer.GetSize(object); })
+            capacity = serializer.GetSize(object);
+
+        auto buffer = acquire(capacity);
+        serializer.Serialize(buffer, object);
+        return buffer;
+    }
+}
+
+#endif //BUFFER_POOL_H
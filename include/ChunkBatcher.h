@@ -0,0 +1,53 @@
+#ifndef CHUNK_BATCHER_H
+#define CHUNK_BATCHER_H
+
+#include <chrono>
+#include <cstddef>
+
+namespace mc
+{
+    // Paces the chunks of one player to what their client reports it can process.
+    // Chunks go out in batches framed by Chunk Batch Start/Finished, the client answers each one
+    // with Chunk Batch Received carrying the chunks per tick it wants next. That rate refills a
+    // token bucket holding at most one tick of chunks, and only a few batches may be unanswered at
+    // once, so a slow client or link stalls the sender instead of piling chunks up in its queue.
+    // Same numbers as the vanilla server
+    class ChunkBatcher
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using Ticks = std::chrono::duration<float, std::ratio<1, 20>>;
+
+        constexpr static float INITIAL_CHUNKS_PER_TICK = 9;
+        constexpr static float MIN_CHUNKS_PER_TICK     = 0.01f;
+        constexpr static float MAX_CHUNKS_PER_TICK     = 64;
+        // Batches that may be unanswered at once, bounds what a client that stopped answering gets
+        constexpr static int MAX_UNACKNOWLEDGED        = 10;
+
+        ChunkBatcher(Clock::time_point now);
+        ~ChunkBatcher() = default;
+
+        // Chunks the next batch may hold, 0 while too many batches are unanswered
+        size_t Available(Clock::time_point now);
+        // A batch holding count chunks went out
+        void OnBatchSent(size_t count);
+        // Chunk Batch Received, NaN and out of range rates are clamped
+        void OnBatchReceived(float chunksPerTick);
+
+        inline float ChunksPerTick() const noexcept { return m_chunksPerTick; }
+        inline int Unacknowledged() const noexcept { return m_unacknowledged; }
+
+    private:
+        // Never more than a tick worth, but always room for a single chunk
+        inline float Capacity() const noexcept { return m_chunksPerTick > 1 ? m_chunksPerTick : 1; }
+
+        float m_chunksPerTick;
+        float m_tokens;
+        Clock::time_point m_lastRefill;
+        int m_unacknowledged;
+        // 1 until the client answered its first batch, MAX_UNACKNOWLEDGED from then on
+        int m_maxUnacknowledged;
+    };
+}
+
+#endif //CHUNK_BATCHER_H
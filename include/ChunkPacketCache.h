@@ -0,0 +1,94 @@
+#ifndef CHUNK_PACKET_CACHE_H
+#define CHUNK_PACKET_CACHE_H
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "ChunkPacketEncoder.h"
+#include "RegionManager.h"
+
+namespace mc
+{
+    // Chunk Data and Update Light packet of one chunk, built once and shared by every player
+    // it is sent to. Never modified, a changed chunk gets a new entry
+    struct EncodedChunk
+    {
+        int x;
+        int z;
+        // Complete frame in the plain format
+        std::vector<std::uint8_t> frame;
+        // Same frame in the compressed format, empty when compression is disabled
+        std::vector<std::uint8_t> compressed;
+    };
+
+    // Encoded chunk packets keyed by chunk coordinate, in an LRU bounded by chunk count split into
+    // shards like the RegionManager's.
+    // Entries are refcounted, a connection that still has one queued keeps it alive after
+    // it was evicted or invalidated so senders never copy the bytes. Safe to use from every I/O thread
+    class ChunkPacketCache
+    {
+    public:
+        using Entry = std::shared_ptr<const EncodedChunk>;
+
+        // A bit more than what a few players at view distance 16 see
+        constexpr static size_t DEFAULT_CAPACITY = 4096;
+        // Power of two, the capacity is split evenly between them
+        constexpr static size_t SHARD_COUNT      = 16;
+
+        ChunkPacketCache(RegionManager& regions, const ChunkPacketEncoder& encoder, size_t capacity = DEFAULT_CAPACITY);
+        ChunkPacketCache(const ChunkPacketCache&) = delete;
+        ChunkPacketCache& operator=(const ChunkPacketCache&) = delete;
+        ~ChunkPacketCache() = default;
+
+        // Encodes the chunk on a miss, nullptr if the chunk doesn't exist
+        Entry Get(int x, int z);
+        // For whatever changes a chunk, the next Get decodes and encodes it again. The decoded chunk
+        // is evicted from the RegionManager too. An encode that was running meanwhile still hands its
+        // result to its caller but never caches it. Nothing changes chunks yet, the world is read only
+        void Invalidate(int x, int z);
+        // Drops every entry, decoded chunks stay in the RegionManager
+        void Clear();
+
+        size_t Size() const;
+
+    private:
+        using LruList = std::list<std::pair<std::uint64_t, Entry>>;
+
+        struct Shard
+        {
+            std::mutex mutex;
+            // Most recently used first
+            LruList lru;
+            std::unordered_map<std::uint64_t, LruList::iterator> entries;
+            // Bumped by every invalidation, an encode that started before one doesn't get inserted
+            std::uint64_t generation = 0;
+        };
+
+        static inline std::uint64_t Key(int x, int z)
+        {
+            return (std::uint64_t(std::uint32_t(x)) << 32) | std::uint32_t(z);
+        }
+
+        inline Shard& ShardOf(std::uint64_t key) const noexcept
+        {
+            return m_shards[(key * 0x9e3779b97f4a7c15ull) >> (64 - std::countr_zero(SHARD_COUNT))];
+        }
+
+        Entry Encode(int x, int z) const;
+
+        RegionManager& m_regions;
+        const ChunkPacketEncoder& m_encoder;
+        // Per shard
+        size_t m_shardCapacity;
+        mutable std::array<Shard, SHARD_COUNT> m_shards;
+    };
+}
+
+#endif //CHUNK_PACKET_CACHE_H
@@ -0,0 +1,84 @@
+#ifndef CHUNK_PACKET_ENCODER_H
+#define CHUNK_PACKET_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "DataTypes/Identifier.h"
+#include "DataTypes/NBTLazyDocument.h"
+#include "PalettedContainer.h"
+#include "Registry.h"
+
+namespace mc
+{
+    // Turns a chunk as the region files store it into a Chunk Data and Update Light frame.
+    // Sections are decoded into PalettedContainers, heightmaps, light and block entity NBT are
+    // already big endian in the file and copied as they are. Everything is measured before
+    // anything is written, so the frame is written front to back once into a buffer of its exact
+    // size from the BufferPool. Safe to use from several threads once SetBiomes was called
+    class ChunkPacketEncoder
+    {
+    public:
+        constexpr static int CHUNK_DATA_ID        = 0x27;
+        // Overworld, sections -4 to 19
+        constexpr static int MIN_SECTION          = -4;
+        constexpr static int SECTION_COUNT        = 24;
+        constexpr static size_t LIGHT_ARRAY_SIZE  = 2048;
+
+        ChunkPacketEncoder(const BlockStateRegistry& blocks);
+        ~ChunkPacketEncoder() = default;
+
+        // Biome ids are their index in the worldgen/biome registry sent during configuration
+        void SetBiomes(std::span<const Identifier> biomes);
+
+        // Throws std::runtime_error if the chunk is malformed or uses a block or biome that isn't registered
+        std::vector<std::uint8_t> Encode(int x, int z, const NBT::LazyDocument& chunk) const;
+
+    private:
+        struct Heightmap
+        {
+            int type;
+            // Big endian longs
+            std::span<const std::uint8_t> data;
+        };
+
+        struct Section
+        {
+            PalettedContainer blocks;
+            PalettedContainer biomes;
+            int nonAir;
+        };
+
+        struct BlockEntity
+        {
+            std::uint8_t packedXZ;
+            std::int16_t y;
+            int type;
+            // Compound payload as stored
+            std::span<const std::uint8_t> nbt;
+        };
+
+        // One bit per section plus the one below and the one above the world
+        struct Light
+        {
+            std::uint64_t mask;
+            std::uint64_t emptyMask;
+            std::vector<std::span<const std::uint8_t>> arrays;
+        };
+
+        Section ReadSection(const NBT::LazyTag& section) const;
+        std::vector<BlockEntity> ReadBlockEntities(const NBT::LazyDocument& chunk) const;
+
+        const BlockStateRegistry& m_blocks;
+        int m_air;
+        unsigned m_blockBits;
+        unsigned m_biomeBits;
+        std::unordered_map<Identifier, int> m_biomes;
+        std::unordered_map<Identifier, int> m_blockEntityTypes;
+    };
+}
+
+#endif //CHUNK_PACKET_ENCODER_H
@@ -0,0 +1,85 @@
+#ifndef CHUNK_VIEW_H
+#define CHUNK_VIEW_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace mc
+{
+    struct ChunkPos
+    {
+        // Blocks from the origin to the world border
+        constexpr static double WORLD_BORDER = 30'000'000;
+
+        int x;
+        int z;
+
+        // Chunk holding the block coordinates, which have to be finite. Anything past the world
+        // border counts as on it
+        static inline ChunkPos At(double x, double z)
+        {
+            x = std::clamp(x, -WORLD_BORDER, WORLD_BORDER);
+            z = std::clamp(z, -WORLD_BORDER, WORLD_BORDER);
+            return { int(std::floor(x / 16)), int(std::floor(z / 16)) };
+        }
+
+        friend bool operator==(const ChunkPos&, const ChunkPos&) = default;
+    };
+
+    // Chunks one player can see: the square of viewDistance chunks around the one they stand in.
+    // Chunks entering the square wait in a queue that hands out the nearest one first, ring by ring
+    // as a spiral around the center. A move only walks the strips the old and new squares don't
+    // share, chunks still queued when they leave the square are dropped without being reported
+    // since the client never got them
+    class ChunkView
+    {
+    public:
+        ChunkView(int viewDistance);
+        ~ChunkView() = default;
+
+        // Recenters the view, queues the chunks that came into range. Returns the chunks that left
+        // it and were already handed out by Next, the client has to forget them
+        std::vector<ChunkPos> Move(ChunkPos center);
+
+        // Nearest queued chunk to the center, it counts as sent from now on
+        std::optional<ChunkPos> Next();
+
+        inline bool IsCentered() const noexcept { return m_centered; }
+        inline bool HasPending() const noexcept { return !m_pending.empty(); }
+        inline size_t Pending() const noexcept { return m_pending.size(); }
+        // Meaningless before the first Move
+        inline ChunkPos Center() const noexcept { return m_center; }
+        inline int ViewDistance() const noexcept { return m_viewDistance; }
+        bool Contains(ChunkPos chunk) const noexcept;
+
+    private:
+        struct Square
+        {
+            int minX;
+            int minZ;
+            int maxX;
+            int maxZ;
+
+            inline bool Contains(ChunkPos chunk) const noexcept
+            {
+                return chunk.x >= minX && chunk.x <= maxX && chunk.z >= minZ && chunk.z <= maxZ;
+            }
+        };
+
+        Square SquareAround(ChunkPos center) const noexcept;
+        // Ring first, squared distance within a ring
+        std::uint64_t Distance(ChunkPos chunk) const noexcept;
+
+        int m_viewDistance;
+        bool m_centered;
+        ChunkPos m_center;
+        // Farthest first, Next takes from the back
+        std::vector<ChunkPos> m_pending;
+    };
+}
+
+#endif //CHUNK_VIEW_H
@@ -0,0 +1,72 @@
+#ifndef CLIENT_CONNECTION_H
+#define CLIENT_CONNECTION_H
+
+#include <SFW/Connection.h>
+#include <SFW/Serializer.h>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "BufferPool.h"
+
+namespace mc
+{
+    // Transport PlayerHandler writes to. Lets the same state machine run on top of
+    // SFW's blocking connections and on the epoll reactor
+    class ClientConnection
+    {
+    public:
+        virtual ~ClientConnection() = default;
+
+        template<typename T>
+        void Send(const T& packet)
+        {
+            Send(pool::serialize(packet));
+        }
+
+        // data holds one or more complete frames
+        virtual void Send(const std::vector<std::uint8_t>& data) = 0;
+        // Same but the buffer can be queued without a copy
+        virtual void Send(std::vector<std::uint8_t>&& data) { Send(static_cast<const std::vector<std::uint8_t>&>(data)); }
+        // For packets owned by the ServerContext, they outlive every connection so they are not copied
+        virtual void SendPrebuilt(std::span<const std::uint8_t> data) { Send(std::vector<std::uint8_t>(data.begin(), data.end())); }
+        // For immutable buffers shared between players (ChunkPacketCache), the reference keeps them
+        // alive until they are sent
+        virtual void SendShared(std::shared_ptr<const std::vector<std::uint8_t>> data) { Send(*data); }
+
+        // Packets sent while corked are held back and leave together once the last Uncork runs
+        virtual void Cork() {}
+        virtual void Uncork() {}
+
+        virtual std::string GetAdress() const = 0;
+        virtual int GetPort() const = 0;
+    };
+
+    class SFWClientConnection : public ClientConnection
+    {
+    public:
+        SFWClientConnection(iu::Connection& connection) : m_connection(connection), m_corks(0) {}
+        ~SFWClientConnection() = default;
+
+        using ClientConnection::Send;
+
+        void Send(const std::vector<std::uint8_t>& data) override;
+        void Send(std::vector<std::uint8_t>&& data) override;
+
+        void Cork() override;
+        void Uncork() override;
+
+        inline std::string GetAdress() const override { return m_connection.GetAdress(); }
+        inline int GetPort() const override { return m_connection.GetPort(); }
+
+    private:
+        iu::Connection& m_connection;
+        unsigned m_corks;
+        // Concatenated frames held back while corked
+        std::vector<std::uint8_t> m_corked;
+    };
+}
+
+#endif //CLIENT_CONNECTION_H
@@ -1,12 +1,15 @@
 #ifndef CLIENT_PACKETS_H
 #define CLIENT_PACKETS_H
 #include "Packet.h"
+#include "PacketSchema.h"
+#include "PacketTable.h"
 #include "utils.h"
 
 #include <bits/stdint-uintn.h>
 #include <spdlog/fmt/fmt.h>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace mc
 {
@@ -43,6 +46,9 @@ namespace mc
         enum class PlayPacketID : int
         {
             UNKNOWN           = -1,
+            ChunkBatchReceived = 0x0A,
+            SetPlayerPosition = 0x1D,
+            SetPlayerPositionAndRotation = 0x1E
         };
 
         // ***************
@@ -52,13 +58,12 @@ namespace mc
         class HandshakePacket : public Packet
         {
         public:
-            template<util::IteratorU8 Iter>
-            HandshakePacket(Iter& data)
-                : Packet(IdlePacketID::HANDSHAKE),
-                  m_protocolVersion(util::readVarInt(data)),
-                  m_serverAddress(util::readString(data)),
-                  m_port((*data << 8) + *(++data)),
-                  m_nextState(util::readVarInt(++data))
+            HandshakePacket()
+                : Packet(Schema::ID),
+                  m_protocolVersion(0),
+                  m_serverAddress(),
+                  m_port(0),
+                  m_nextState(0)
             {
             }
 
@@ -75,6 +80,12 @@ namespace mc
             std::string m_serverAddress;
             uint16_t m_port;
             int m_nextState;
+        public:
+            using Schema = schema::PacketSchema<IdlePacketID::HANDSHAKE,
+                schema::Field<schema::VarInt, &HandshakePacket::m_protocolVersion>,
+                schema::Field<schema::String, &HandshakePacket::m_serverAddress>,
+                schema::Field<schema::UShort, &HandshakePacket::m_port>,
+                schema::Field<schema::VarInt, &HandshakePacket::m_nextState>>;
         };
 
         // *****************
@@ -84,21 +95,21 @@ namespace mc
         class StatusRequestPacket : public Packet
         {
         public:
-            StatusRequestPacket() : Packet(StatusPacketID::STATUS) {}
+            StatusRequestPacket() : Packet(Schema::ID) {}
             ~StatusRequestPacket() = default;
 
             std::string AsString() const override;
             constexpr std::string PacketName() const override;
+
+            using Schema = schema::PacketSchema<StatusPacketID::STATUS>;
         };
 
         class PingRequest : public Packet
         {
         public:
-            template<util::IteratorU8 Iter>
-            PingRequest(Iter& data)
-                : Packet(StatusPacketID::PING),
-                  m_payload((*data << 8) + (*++data << 8) + (*++data << 8) + (*++data << 8) +
-                            (*++data << 8) + (*++data << 8) + (*++data << 8) + (*++data << 8))
+            PingRequest()
+                : Packet(Schema::ID),
+                  m_payload(0)
             {
             }
 
@@ -109,6 +120,9 @@ namespace mc
 
         private:
             uint64_t m_payload;
+        public:
+            using Schema = schema::PacketSchema<StatusPacketID::PING,
+                schema::Field<schema::Long, &PingRequest::m_payload>>;
         };
 
         // *****************
@@ -118,33 +132,51 @@ namespace mc
         class KnownPacksPacket : public Packet
         {
         public:
-            template<util::IteratorU8 Iter>
-            KnownPacksPacket(Iter& data)
-                : Packet(std::to_underlying(ConfigPacketID::KnownPacks)),
-                  m_namespace([&data](){util::readVarInt(data); return util::readString(data);}()),
-                  m_id(util::readString(data)),
-                  m_version(util::readString(data))
+            struct Pack
+            {
+                std::string nspace;
+                std::string id;
+                std::string version;
+
+                using Schema = schema::FieldList<
+                    schema::Field<schema::String, &Pack::nspace>,
+                    schema::Field<schema::String, &Pack::id>,
+                    schema::Field<schema::String, &Pack::version>>;
+            };
+
+            KnownPacksPacket()
+                : Packet(Schema::ID),
+                  m_packs()
             {
             }
             virtual ~KnownPacksPacket() {}
+
+            inline const std::vector<Pack>& GetPacks() const { return m_packs; }
+
             std::string AsString() const override
             {
-                return std::format("{{namespace: {}, id: {}, version: {}}}", m_namespace, m_version, m_id);
+                std::string text;
+                for (const auto& pack : m_packs)
+                    text += std::format("{{namespace: {}, id: {}, version: {}}}", pack.nspace, pack.id, pack.version);
+                return text;
             }
             constexpr std::string PacketName()const override { return "KnownPacks"; }
         private:
-            std::string m_namespace;
-            std::string m_id;
-            std::string m_version;
+            std::vector<Pack> m_packs;
+        public:
+            using Schema = schema::PacketSchema<ConfigPacketID::KnownPacks,
+                schema::Field<schema::Array<schema::Struct<Pack>>, &KnownPacksPacket::m_packs>>;
         };
 
         class AcknowledgeConfig : public Packet
         {
         public:
             AcknowledgeConfig()
-                : Packet((int)ConfigPacketID::AcknowledgeConfigEnd)
+                : Packet(Schema::ID)
             {}
             ~AcknowledgeConfig() = default;
+
+            using Schema = schema::PacketSchema<ConfigPacketID::AcknowledgeConfigEnd>;
         };
 
         // ****************
@@ -154,12 +186,10 @@ namespace mc
         class LoginStartPacket : public Packet
         {
         public:
-            template<util::IteratorU8 Iter>
-            LoginStartPacket(Iter& data)
-                : Packet(LoginPacketID::START),
-                  m_playerName(util::readString(data)),
-                  m_hasUUID(*data++),
-                  m_uuid(data)
+            LoginStartPacket()
+                : Packet(Schema::ID),
+                  m_playerName(),
+                  m_uuid()
             {
             }
 
@@ -171,18 +201,123 @@ namespace mc
 
         private:
             std::string m_playerName;
-            bool m_hasUUID;
             util::uuid m_uuid;
+        public:
+            using Schema = schema::PacketSchema<LoginPacketID::START,
+                schema::Field<schema::String, &LoginStartPacket::m_playerName>,
+                schema::Field<schema::UUID, &LoginStartPacket::m_uuid>>;
         };
 
-        // ****************
+        class LoginAckPacket : public Packet
+        {
+        public:
+            LoginAckPacket() : Packet(Schema::ID) {}
+
+            using Schema = schema::PacketSchema<LoginPacketID::LoginAcknowledged>;
+        };
+
+        // ***************
         // * PlayPackets *
-        // ****************
+        // ***************
 
-        class LoginAckPacket : public Packet
+        // Answers server::ChunkBatchFinished
+        class ChunkBatchReceived : public Packet
+        {
+        public:
+            ChunkBatchReceived()
+                : Packet(Schema::ID),
+                  m_chunksPerTick(0)
+            {
+            }
+
+            inline float GetChunksPerTick() const { return m_chunksPerTick; }
+
+            std::string AsString() const override { return std::format("{{chunksPerTick: {}}}", m_chunksPerTick); }
+            constexpr std::string PacketName() const override { return "ChunkBatchReceived"; }
+
+        private:
+            // What the client wants next, from how fast it processed the batch
+            float m_chunksPerTick;
+        public:
+            using Schema = schema::PacketSchema<PlayPacketID::ChunkBatchReceived,
+                schema::Field<schema::Float, &ChunkBatchReceived::m_chunksPerTick>>;
+        };
+
+        class SetPlayerPosition : public Packet
+        {
+        public:
+            SetPlayerPosition()
+                : Packet(Schema::ID),
+                  m_x(0),
+                  m_y(0),
+                  m_z(0),
+                  m_flags(0)
+            {
+            }
+
+            inline double GetX() const { return m_x; }
+            inline double GetY() const { return m_y; }
+            inline double GetZ() const { return m_z; }
+
+            std::string AsString() const override { return std::format("{{x: {}, y: {}, z: {}}}", m_x, m_y, m_z); }
+            constexpr std::string PacketName() const override { return "SetPlayerPosition"; }
+
+        private:
+            double m_x;
+            // Feet
+            double m_y;
+            double m_z;
+            // On ground, pushing against a wall
+            std::uint8_t m_flags;
+        public:
+            using Schema = schema::PacketSchema<PlayPacketID::SetPlayerPosition,
+                schema::Field<schema::Double, &SetPlayerPosition::m_x>,
+                schema::Field<schema::Double, &SetPlayerPosition::m_y>,
+                schema::Field<schema::Double, &SetPlayerPosition::m_z>,
+                schema::Field<schema::UByte, &SetPlayerPosition::m_flags>>;
+        };
+
+        class SetPlayerPositionAndRotation : public Packet
         {
         public:
-            LoginAckPacket() : Packet(LoginPacketID::LoginAcknowledged) {}
+            SetPlayerPositionAndRotation()
+                : Packet(Schema::ID),
+                  m_x(0),
+                  m_y(0),
+                  m_z(0),
+                  m_yaw(0),
+                  m_pitch(0),
+                  m_flags(0)
+            {
+            }
+
+            inline double GetX() const { return m_x; }
+            inline double GetY() const { return m_y; }
+            inline double GetZ() const { return m_z; }
+            inline float GetYaw() const { return m_yaw; }
+            inline float GetPitch() const { return m_pitch; }
+
+            std::string AsString() const override
+            {
+                return std::format("{{x: {}, y: {}, z: {}, yaw: {}, pitch: {}}}", m_x, m_y, m_z, m_yaw, m_pitch);
+            }
+            constexpr std::string PacketName() const override { return "SetPlayerPositionAndRotation"; }
+
+        private:
+            double m_x;
+            double m_y;
+            double m_z;
+            float m_yaw;
+            float m_pitch;
+            std::uint8_t m_flags;
+        public:
+            using Schema = schema::PacketSchema<PlayPacketID::SetPlayerPositionAndRotation,
+                schema::Field<schema::Double, &SetPlayerPositionAndRotation::m_x>,
+                schema::Field<schema::Double, &SetPlayerPositionAndRotation::m_y>,
+                schema::Field<schema::Double, &SetPlayerPositionAndRotation::m_z>,
+                schema::Field<schema::Float, &SetPlayerPositionAndRotation::m_yaw>,
+                schema::Field<schema::Float, &SetPlayerPositionAndRotation::m_pitch>,
+                schema::Field<schema::UByte, &SetPlayerPositionAndRotation::m_flags>>;
         };
 
         // INLINES
@@ -226,9 +361,8 @@ namespace mc
 
         inline std::string LoginStartPacket::AsString() const
         {
-            return std::format("{{playerName: {}, hasUUID: {}, uuid:{} }}",
+            return std::format("{{playerName: {}, uuid:{} }}",
                 m_playerName,
-                m_hasUUID,
                 m_uuid);
         }
 
@@ -240,6 +374,17 @@ namespace mc
         inline const std::string& LoginStartPacket::GetPlayerName() const { return m_playerName; }
 
         inline util::uuid LoginStartPacket::GetUUID() const { return m_uuid; }
+
+        // *****************
+        // * Packet tables *
+        // *****************
+
+        // What each connection state accepts
+        using IdlePackets   = PacketTable<HandshakePacket>;
+        using StatusPackets = PacketTable<StatusRequestPacket, PingRequest>;
+        using LoginPackets  = PacketTable<LoginStartPacket, LoginAckPacket>;
+        using ConfigPackets = PacketTable<AcknowledgeConfig, KnownPacksPacket>;
+        using PlayPackets   = PacketTable<ChunkBatchReceived, SetPlayerPosition, SetPlayerPositionAndRotation>;
     } // namespace client
 } // namespace mc
 
@@ -0,0 +1,45 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Compressed packet format, enabled per connection by Set Compression:
+//   VarInt packet length | VarInt data length | id + payload, deflated when data length != 0
+// Every thread keeps its own deflate and inflate streams and resets them between packets,
+// zlib's allocations only happen the first time a thread compresses something.
+namespace mc::compression
+{
+    // Packets (id + payload) of at least this many bytes get deflated
+    constexpr int DEFAULT_THRESHOLD = 256;
+    constexpr int DEFAULT_LEVEL     = 6;
+    // Threshold value that keeps Set Compression from being sent at all
+    constexpr int DISABLED          = -1;
+    // Largest uncompressed packet a client is allowed to announce
+    constexpr size_t MAX_DATA_LENGTH = 1 << 23;
+
+    // Process wide, set from main before any server is created.
+    // Throws std::out_of_range if the threshold is below DISABLED or the level isn't a zlib level (-1..9)
+    void configure(int threshold, int level);
+    int threshold() noexcept;
+    int level() noexcept;
+    inline bool enabled() noexcept { return threshold() >= 0; }
+
+    // Rewrites one or more complete uncompressed frames in the compressed format, appended to out
+    void compressFrames(std::span<const std::uint8_t> frames, std::vector<std::uint8_t>& out);
+    // Same into a buffer from the BufferPool
+    std::vector<std::uint8_t> compressFrames(std::span<const std::uint8_t> frames);
+
+    // Takes a frame as handed out by FrameDecoder (data length + data) and returns id + payload.
+    // Uncompressed packets are returned in place, inflated ones live in scratch.
+    // Throws std::runtime_error on a malformed packet
+    std::span<const std::uint8_t> decompressFrame(std::span<const std::uint8_t> frame, std::vector<std::uint8_t>& scratch);
+
+    // Inflates a complete zlib or gzip stream whose size is not known up front (region chunks).
+    // Throws std::runtime_error if it is malformed or truncated
+    std::vector<std::uint8_t> inflateStream(std::span<const std::uint8_t> data);
+}
+
+#endif //COMPRESSION_H
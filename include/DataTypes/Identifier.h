@@ -1,54 +1,107 @@
 #ifndef IDENTIFIER_H
 #define IDENTIFIER_H
+#include <cstdint>
+#include <optional>
+#include <span>
 #include <string>
-#include <regex>
+#include <string_view>
 
 #include "utils.h"
 
 namespace mc
 {
+    // Namespaced name ("minecraft:overworld") interned in a global table that only ever grows.
+    // An Identifier is a 32 bit handle into it, so copies, comparisons and hashing are integer
+    // operations and the wire encoding is built once, the first time a name is seen.
+    // Names the table already knows are found without taking a lock. The table is never freed, so
+    // names from clients only go through Find
     class Identifier
     {
     public:
-        Identifier() = default;
-        Identifier(const std::string& category, const std::string& value);
+        constexpr static std::string_view DEFAULT_NAMESPACE = "minecraft";
 
-        Identifier(const std::string& value);
+        // The empty identifier
+        Identifier() noexcept : m_handle(0) {}
+        // Both parts are lowercased, throws std::runtime_error on characters identifiers don't allow
+        Identifier(std::string_view category, std::string_view value);
+        // "namespace:value", or only a value in the minecraft namespace
+        Identifier(std::string_view value);
 
-        inline std::string AsString()const
-        {
-            return m_category + ':' + m_value;
-        }
-        
+        // Same rules as the constructor but never adds to the table, empty if the name is unknown or invalid
+        static std::optional<Identifier> Find(std::string_view value);
+
+        std::string_view GetCategory() const noexcept;
+        std::string_view GetValue() const noexcept;
+        // "namespace:value"
+        std::string_view View() const noexcept;
+        inline std::string AsString() const { return std::string(View()); }
 
-        bool Equal(const Identifier& other)const { return m_category == other.m_category && m_value == other.m_value; }
+        // Length prefixed text as it is written to packets
+        std::span<const std::uint8_t> Encoded() const noexcept;
+        // Of the text, the same in every process unlike the handle
+        std::uint64_t Hash() const noexcept;
+        inline std::uint32_t Handle() const noexcept { return m_handle; }
+
+        bool Equal(const Identifier& other)const { return m_handle == other.m_handle; }
         bool operator==(const Identifier& other)const { return Equal(other); }
         bool operator!=(const Identifier& other)const { return !Equal(other); }
+
+        // Allowed characters, https://minecraft.wiki/w/Resource_location
+        static constexpr bool IsValidNamespace(std::string_view category) noexcept
+        {
+            for (const char c : category)
+            {
+                if (!IsValidCharacter(c))
+                    return false;
+            }
+            return true;
+        }
+
+        static constexpr bool IsValidValue(std::string_view value) noexcept
+        {
+            for (const char c : value)
+            {
+                if (!IsValidCharacter(c) && c != '/')
+                    return false;
+            }
+            return !value.empty();
+        }
+
     private:
-        static std::regex s_allowedNamespaceCharacters;
-        static std::regex s_allowedValueCharacters;
-        std::string m_category;
-        std::string m_value;
+        static constexpr bool IsValidCharacter(char c) noexcept
+        {
+            return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '-' || c == '.';
+        }
+
+        std::uint32_t m_handle;
     };
 }
 
 template<>
-struct std::formatter<mc::Identifier> : public std::formatter<std::string>
+struct std::hash<mc::Identifier>
+{
+    size_t operator()(const mc::Identifier& identifier) const noexcept { return identifier.Handle(); }
+};
+
+template<>
+struct std::formatter<mc::Identifier> : public std::formatter<std::string_view>
 {
     template<typename FmtContext>
     FmtContext::iterator format(const mc::Identifier& my, FmtContext &ctx) const
     {
-        return std::formatter<std::string>::format(my.AsString(), ctx);
+        return std::formatter<std::string_view>::format(my.View(), ctx);
     }
 };
 
 template<>
 struct iu::Serializer<mc::Identifier>
 {
+    size_t GetSize(const mc::Identifier& object) { return object.Encoded().size(); }
+
     void Serialize(std::vector<uint8_t>& buffer, const mc::Identifier& toSerialize)
     {
-        const std::string identifier = toSerialize.AsString();
-        mc::util::writeStringToBuff(buffer, {identifier.c_str(), identifier.size()});
+        const auto encoded = toSerialize.Encoded();
+        buffer.insert(buffer.end(), encoded.begin(), encoded.end());
     }
 };
-#endif
\ No newline at end of file
+#endif
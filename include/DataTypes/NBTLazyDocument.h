@@ -0,0 +1,133 @@
+#ifndef NBT_LAZY_DOCUMENT_H
+#define NBT_LAZY_DOCUMENT_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "DataTypes/nbt.h"
+
+namespace mc::NBT
+{
+    // What LazyTag::Get<T> decodes to, Int and Long arrays are byte swapped into a copy
+    template<CanConstructNBTTag T>
+    struct LazyValueOf { using type = T; };
+    template<> struct LazyValueOf<String>    { using type = std::string_view; };
+    template<> struct LazyValueOf<ByteArray> { using type = std::span<const Byte>; };
+
+    template<CanConstructNBTTag T>
+    using LazyValue = typename LazyValueOf<T>::type;
+
+    // Position of one tag inside binary NBT, nothing of it is decoded until asked for.
+    // Paths are names separated by '/', list elements are picked by index ("sections/3/block_states").
+    // Tags that are not on the path are stepped over: arrays, strings and lists of numbers cost a
+    // single length skip, compounds and other lists only a walk over their tag headers
+    class LazyTag
+    {
+    public:
+        LazyTag(std::span<const std::uint8_t> source, TagType type, std::string_view name, size_t offset);
+
+        inline TagType Type() const noexcept { return m_type; }
+        // Empty for list elements
+        inline std::string_view Name() const noexcept { return m_name; }
+
+        // Relative to this tag, empty if any part of the path does not exist
+        std::optional<LazyTag> Find(std::string_view path) const;
+
+        // Children of a compound or elements of a list, found in one walk
+        std::vector<LazyTag> Children() const;
+
+        // Elements of lists and arrays, bytes of strings, children of compounds
+        size_t Size() const;
+        // Element type of a list
+        TagType ElementType() const;
+
+        // Payload as it is stored, so a tag can be copied into a packet without decoding it
+        std::span<const std::uint8_t> Raw() const;
+        // Elements of an Int or Long array as they are stored, big endian.
+        // Throws std::runtime_error if the tag is not one of them
+        std::span<const std::uint8_t> RawArray() const;
+
+        // Throws std::runtime_error if the tag is not a T, compounds and lists are walked with Find instead
+        template<CanConstructNBTTag T>
+        LazyValue<T> Get() const
+        {
+            static_assert(!std::same_as<T, NBTCompound> && !std::same_as<T, NBTList>, "Containers are walked with Find");
+            if (m_type != getTagType<T>())
+                throw std::runtime_error(std::format("Requested tag type {} but {} is {}", (int)getTagType<T>(), m_name, (int)m_type));
+
+            Reader reader(m_source);
+            reader.Seek(m_offset);
+            if constexpr (std::same_as<T, String>)
+                return reader.ReadString();
+            else if constexpr (std::same_as<T, ByteArray>)
+            {
+                const auto bytes = reader.ReadBytes(ArrayLength(reader));
+                return { reinterpret_cast<const Byte*>(bytes.data()), bytes.size() };
+            }
+            else if constexpr (std::same_as<T, IntArray> || std::same_as<T, LongArray>)
+                return reader.ReadArray<typename T::value_type>();
+            else
+                return reader.Read<T>();
+        }
+
+    private:
+        static size_t ArrayLength(Reader& reader);
+
+        std::optional<LazyTag> Child(std::string_view segment) const;
+
+        std::span<const std::uint8_t> m_source;
+        TagType m_type;
+        std::string_view m_name;
+        // Start of the payload, right after the name
+        size_t m_offset;
+    };
+
+    // Uncompressed NBT indexed only as far as the children of its root compound. Everything below
+    // is located when a path asks for it, so a chunk that only needs its heightmaps never touches
+    // entities, structures or ticks beyond stepping over them. Immutable once constructed
+    class LazyDocument
+    {
+    public:
+        // Takes over the buffer, throws like NBT::parse if the root compound is malformed.
+        // Errors deeper down only surface from the lookups that reach them
+        LazyDocument(std::vector<std::uint8_t> data);
+        LazyDocument(const LazyDocument&) = delete;
+        LazyDocument(LazyDocument&&) = default;
+
+        LazyDocument& operator=(const LazyDocument&) = delete;
+        LazyDocument& operator=(LazyDocument&&) = default;
+
+        ~LazyDocument() = default;
+
+        inline std::string_view RootName() const noexcept { return m_rootName; }
+
+        // "Heightmaps/WORLD_SURFACE", empty if any part of the path does not exist
+        std::optional<LazyTag> Find(std::string_view path) const;
+
+        // Throws std::out_of_range if the path does not exist
+        template<CanConstructNBTTag T>
+        LazyValue<T> Get(std::string_view path) const
+        {
+            const auto tag = Find(path);
+            if (!tag.has_value())
+                throw std::out_of_range("Element does not exist: " + std::string(path));
+            return tag->Get<T>();
+        }
+
+        // Bytes held by the document, source buffer included
+        size_t MemoryUsage() const noexcept;
+
+    private:
+        std::vector<std::uint8_t> m_source;
+        std::string_view m_rootName;
+        // Children of the root, sorted by name
+        std::vector<LazyTag> m_root;
+    };
+}
+
+#endif //NBT_LAZY_DOCUMENT_H
@@ -1,6 +1,7 @@
 #ifndef POSITION_H
 #define POSITION_H
 
+#include <SFW/utils.h>
 #include <cstdint>
 
 #include "utils.h"
@@ -1,6 +1,7 @@
 #ifndef NBT_H
 #define NBT_H
 
+#include <bit>
 #include <concepts>
 #include <cstring>
 #include <filesystem>
@@ -13,7 +14,9 @@
 #include <SFW/utils.h>
 #include <cstdint>
 #include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 #include <fstream>
@@ -39,6 +42,9 @@ namespace mc::NBT
         LONG_ARRAY
     };
 
+    // Same limit the vanilla server uses, deeper data is rejected instead of overflowing the stack
+    constexpr int MAX_DEPTH = 512;
+
     using Byte   = std::int8_t;
     using Short  = std::int16_t;
     using Int    = std::int32_t;
@@ -104,9 +110,7 @@ namespace mc::NBT
     void serializeArray(std::vector<std::uint8_t>& buffer, const std::vector<T>& data)
     {
         util::IntSerializer().Serialize(buffer, data.size());
-        iu::Serializer<T> s;
-        for (const auto element : data)
-            s.Serialize(buffer, element);
+        util::writeBigEndian(buffer, std::span<const T>(data));
     }
 
     class NBTTag
@@ -614,6 +618,79 @@ namespace mc::NBT
     using NBT = NamedCompound;
     using NBTSerializer = iu::Serializer<NBT>;
 
+    // Bounds checked cursor over binary NBT, every read throws std::out_of_range instead of
+    // running past the end. Nothing is copied, strings are views into the buffer
+    class Reader
+    {
+    public:
+        Reader(std::span<const std::uint8_t> data) : m_data(data), m_position(0) {}
+
+        TagType ReadTagType()
+        {
+            const Byte tag = Read<Byte>();
+            if (tag < (Byte)TagType::END || tag > (Byte)TagType::LONG_ARRAY)
+                throw std::runtime_error("Unknown tag type " + std::to_string(tag));
+            return (TagType)tag;
+        }
+
+        template<util::Numeric T>
+        T Read()
+        {
+            return util::loadBigEndian<T>(Take(sizeof(T)));
+        }
+
+        // Only valid as long as the buffer is
+        std::string_view ReadString()
+        {
+            const size_t size = std::uint16_t(Read<Short>());
+            return { reinterpret_cast<const char*>(Take(size)), size };
+        }
+
+        // Copies the payload in one go and fixes the byte order of the whole array afterwards.
+        // The payload is taken before anything is allocated, a corrupt length only throws
+        template<typename T>
+        Array<T> ReadArray()
+        {
+            const Int size = Read<Int>();
+            if (size < 0)
+                throw std::runtime_error("Negative array length " + std::to_string(size));
+
+            const auto payload = ReadBytes(size_t(size) * sizeof(T));
+            Array<T> out(size);
+            util::readBigEndian(payload, std::span(out));
+            return out;
+        }
+
+        inline std::span<const std::uint8_t> ReadBytes(size_t bytes) { return { Take(bytes), bytes }; }
+        inline void Skip(size_t bytes) { Take(bytes); }
+
+        inline void Seek(size_t position)
+        {
+            if (position > m_data.size())
+                throw std::out_of_range(std::format("NBT seek to {} past the end at {}", position, m_data.size()));
+            m_position = position;
+        }
+
+        inline size_t Position() const noexcept { return m_position; }
+        inline size_t Remaining() const noexcept { return m_data.size() - m_position; }
+
+    private:
+        const std::uint8_t* Take(size_t bytes)
+        {
+            if (bytes > Remaining())
+                throw std::out_of_range(std::format("NBT needs {} bytes at {}, only {} left", bytes, m_position, Remaining()));
+            const std::uint8_t* out = m_data.data() + m_position;
+            m_position += bytes;
+            return out;
+        }
+
+        std::span<const std::uint8_t> m_data;
+        size_t m_position;
+    };
+
+    // Parses a complete root compound, throws if the data is malformed or truncated
+    NBT parse(std::span<const std::uint8_t> data);
+    // Reads everything that is left in the stream and parses it from memory
     NBT parse(std::istream& data);
 
     inline NBT parse(std::filesystem::path file)
@@ -0,0 +1,50 @@
+#ifndef EPOLL_SERVER_H
+#define EPOLL_SERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ServerContext.h"
+
+namespace mc
+{
+    class EpollWorker;
+
+    // Event driven alternative to iu::AggregateServer<MinecraftHanlder>.
+    // Run accepts connections and spreads them over a fixed pool of I/O threads, each one
+    // waiting on its own edge triggered epoll instance and driving the PlayerHandler of every
+    // non blocking socket it owns. An idle connection only costs its socket and a small buffer.
+    class EpollServer
+    {
+    public:
+        constexpr static size_t DEFAULT_IO_THREADS = 4;
+
+        EpollServer(std::string address, std::uint16_t port, size_t ioThreads = DEFAULT_IO_THREADS);
+        EpollServer(const EpollServer&) = delete;
+        EpollServer& operator=(const EpollServer&) = delete;
+        ~EpollServer();
+
+        // Blocks until Stop is called
+        void Run();
+        void Stop();
+
+    private:
+        void Listen();
+        void AcceptAll();
+
+        std::string m_address;
+        std::uint16_t m_port;
+        int m_listenSocket;
+        int m_epoll;
+        int m_wakeup;
+        std::atomic_bool m_stop;
+        size_t m_nextWorker;
+        ServerContext m_context;
+        std::vector<std::unique_ptr<EpollWorker>> m_workers;
+    };
+}
+
+#endif //EPOLL_SERVER_H
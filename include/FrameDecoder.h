@@ -0,0 +1,55 @@
+#ifndef FRAME_DECODER_H
+#define FRAME_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace mc
+{
+    // Reassembles length prefixed packets out of an arbitrary stream of reads.
+    // TCP is free to split or coalesce packets, so bytes are appended at the tail of the buffer
+    // and whole frames are handed out as spans that point straight into it (no copy).
+    // Instead of letting a frame wrap around the end of the ring the unread region is moved back
+    // to the front, so a frame is always contiguous. The storage only grows when a single frame
+    // does not fit in it.
+    class FrameDecoder
+    {
+    public:
+        constexpr static size_t DEFAULT_CAPACITY = 16 * 1024;
+        // Packets are limited to 2^21 - 1 bytes which is also the largest 3 byte VarInt
+        constexpr static size_t MAX_FRAME_SIZE   = (1 << 21) - 1;
+        constexpr static size_t MAX_LENGTH_BYTES = 3;
+
+        FrameDecoder(size_t capacity = DEFAULT_CAPACITY);
+        ~FrameDecoder() = default;
+
+        // Free space at the tail of the buffer, at least minimum bytes big.
+        // Invalidates every span previously returned by NextFrame
+        std::span<std::uint8_t> WritableSpan(size_t minimum);
+        // Marks bytes written in the span returned by WritableSpan as received
+        void Commit(size_t bytes);
+        // Copies data at the end of the buffer, for transports that can't read in place
+        void Feed(std::span<const std::uint8_t> data);
+
+        // Returns the next complete frame without its length prefix (packet id + payload).
+        // The span is valid until the next call to WritableSpan or Feed.
+        // Throws std::runtime_error if the stream is malformed
+        std::optional<std::span<const std::uint8_t>> NextFrame();
+
+        inline size_t Buffered() const noexcept { return m_write - m_read; }
+        inline size_t Capacity() const noexcept { return m_buffer.size(); }
+
+    private:
+        bool PeekLength(size_t& length, size_t& headerSize) const;
+        void Compact();
+
+        std::vector<std::uint8_t> m_buffer;
+        size_t m_read;
+        size_t m_write;
+    };
+}
+
+#endif //FRAME_DECODER_H
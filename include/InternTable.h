@@ -0,0 +1,179 @@
+#ifndef INTERN_TABLE_H
+#define INTERN_TABLE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mc::util
+{
+    // FNV-1a, stable between runs unlike std::hash
+    constexpr std::uint64_t fnv1a(std::string_view text) noexcept
+    {
+        std::uint64_t hash = 0xcbf29ce484222325;
+        for (const char c : text)
+        {
+            hash ^= std::uint8_t(c);
+            hash *= 0x100000001b3;
+        }
+        return hash;
+    }
+
+    // Append only table of distinct strings, each with a Payload built once when it is added.
+    // Entries live in fixed pages that are never moved or freed, so a handle stays valid and
+    // readable without locking for the life of the table. New strings are appended under a mutex
+    // and published through the index with release stores. A reader holding an outdated index may
+    // miss the newest strings, Find and Intern then fall back to the locked path which checks again
+    template<typename Payload>
+    class InternTable
+    {
+    public:
+        struct Entry
+        {
+            std::string text;
+            std::uint64_t hash;
+            Payload payload;
+        };
+
+        InternTable()
+            : m_pages(),
+            m_index(),
+            m_retired(),
+            m_size(0),
+            m_mutex()
+        {
+            m_retired.push_back(MakeIndex(INITIAL_SLOTS));
+            m_index.store(m_retired.back().get(), std::memory_order_release);
+        }
+
+        InternTable(const InternTable&) = delete;
+        InternTable& operator=(const InternTable&) = delete;
+
+        ~InternTable()
+        {
+            for (auto& page : m_pages)
+                delete[] page.load(std::memory_order_relaxed);
+        }
+
+        inline const Entry& Get(std::uint32_t handle) const noexcept
+        {
+            return m_pages[handle >> PAGE_BITS].load(std::memory_order_acquire)[handle & (PAGE_SIZE - 1)];
+        }
+
+        // Never adds anything
+        std::optional<std::uint32_t> Find(std::string_view text) const
+        {
+            const std::uint64_t hash = fnv1a(text);
+            if (const auto handle = Find(*m_index.load(std::memory_order_acquire), text, hash))
+                return handle;
+
+            std::lock_guard lock(m_mutex);
+            return Find(*m_index.load(std::memory_order_relaxed), text, hash);
+        }
+
+        // makePayload(text) is only called for strings the table does not know yet, with the lock held
+        template<typename MakePayload>
+        std::uint32_t Intern(std::string_view text, MakePayload&& makePayload)
+        {
+            const std::uint64_t hash = fnv1a(text);
+            if (const auto handle = Find(*m_index.load(std::memory_order_acquire), text, hash))
+                return *handle;
+
+            std::lock_guard lock(m_mutex);
+            Index* index = m_index.load(std::memory_order_relaxed);
+            if (const auto handle = Find(*index, text, hash))
+                return *handle;
+
+            const std::uint32_t handle = Append(text, hash, makePayload(text));
+            if (m_size * 2 > index->slots.size())
+            {
+                // Readers may still be probing the old index, it is kept around instead of freed
+                m_retired.push_back(MakeIndex(index->slots.size() * 2));
+                for (std::uint32_t existing = 0; existing < m_size; ++existing)
+                    Insert(*m_retired.back(), existing);
+                m_index.store(m_retired.back().get(), std::memory_order_release);
+            }
+            else
+                Insert(*index, handle);
+            return handle;
+        }
+
+    private:
+        constexpr static size_t PAGE_BITS     = 10;
+        constexpr static size_t PAGE_SIZE     = 1 << PAGE_BITS;
+        constexpr static size_t MAX_PAGES     = 4096;
+        constexpr static size_t INITIAL_SLOTS = 1024;
+        constexpr static std::uint32_t NO_ENTRY = 0xffffffff;
+
+        // Open addressing over the handles, power of two sized and kept at most half full
+        struct Index
+        {
+            std::vector<std::atomic<std::uint32_t>> slots;
+        };
+
+        static std::unique_ptr<Index> MakeIndex(size_t slots)
+        {
+            auto index   = std::make_unique<Index>();
+            index->slots = std::vector<std::atomic<std::uint32_t>>(slots);
+            for (auto& slot : index->slots)
+                slot.store(NO_ENTRY, std::memory_order_relaxed);
+            return index;
+        }
+
+        std::optional<std::uint32_t> Find(const Index& index, std::string_view text, std::uint64_t hash) const noexcept
+        {
+            const size_t mask = index.slots.size() - 1;
+            for (size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+            {
+                const std::uint32_t handle = index.slots[slot].load(std::memory_order_acquire);
+                if (handle == NO_ENTRY)
+                    return {};
+
+                const Entry& entry = Get(handle);
+                if (entry.hash == hash && entry.text == text)
+                    return handle;
+            }
+        }
+
+        void Insert(Index& index, std::uint32_t handle) noexcept
+        {
+            const size_t mask = index.slots.size() - 1;
+            size_t slot       = Get(handle).hash & mask;
+            while (index.slots[slot].load(std::memory_order_relaxed) != NO_ENTRY)
+                slot = (slot + 1) & mask;
+            index.slots[slot].store(handle, std::memory_order_release);
+        }
+
+        std::uint32_t Append(std::string_view text, std::uint64_t hash, Payload payload)
+        {
+            const size_t page = m_size >> PAGE_BITS;
+            if (page >= MAX_PAGES)
+                throw std::runtime_error("Intern table is full");
+            if (m_pages[page].load(std::memory_order_relaxed) == nullptr)
+                m_pages[page].store(new Entry[PAGE_SIZE], std::memory_order_release);
+
+            Entry& entry  = m_pages[page].load(std::memory_order_relaxed)[m_size & (PAGE_SIZE - 1)];
+            entry.text    = text;
+            entry.hash    = hash;
+            entry.payload = std::move(payload);
+            return m_size++;
+        }
+
+        std::array<std::atomic<Entry*>, MAX_PAGES> m_pages;
+        std::atomic<Index*> m_index;
+        // Every index ever published, the last one is current
+        std::vector<std::unique_ptr<Index>> m_retired;
+        // Only touched with m_mutex held
+        std::uint32_t m_size;
+        mutable std::mutex m_mutex;
+    };
+}
+
+#endif //INTERN_TABLE_H
@@ -0,0 +1,112 @@
+#ifndef IO_URING_H
+#define IO_URING_H
+
+#include <linux/io_uring.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace mc
+{
+    // Thin wrapper over the raw io_uring syscalls, we only need a handful of opcodes so
+    // there is no point in pulling liburing in.
+    // Not thread safe, every thread that wants a ring owns its own
+    class IoUring
+    {
+    public:
+        IoUring(unsigned entries);
+        IoUring(const IoUring&) = delete;
+        IoUring& operator=(const IoUring&) = delete;
+        ~IoUring();
+
+        // True when the kernel has io_uring with provided buffer rings (5.19+) and
+        // we are allowed to use it. Probed once
+        static bool IsSupported();
+
+        inline int Fd() const noexcept { return m_fd; }
+
+        // Next free submission entry, already zeroed. Submits pending entries if the queue is full
+        io_uring_sqe* NextSqe();
+        // Hands every prepared entry to the kernel and waits for at least waitFor completions
+        int Submit(unsigned waitFor = 0);
+
+        // Calls handler(const io_uring_cqe&) for every completion available, returns how many
+        template<typename Handler>
+        unsigned ForEachCompletion(Handler&& handler)
+        {
+            unsigned head       = *m_cqHead;
+            const unsigned tail = std::atomic_ref(*m_cqTail).load(std::memory_order_acquire);
+            const unsigned seen = tail - head;
+
+            for (; head != tail; ++head)
+            {
+                // Copy out so the slot can be given back before the handler queues more work
+                const io_uring_cqe cqe = m_cqes[head & *m_cqMask];
+                std::atomic_ref(*m_cqHead).store(head + 1, std::memory_order_release);
+                handler(cqe);
+            }
+            return seen;
+        }
+
+    private:
+        void Release();
+
+        int m_fd;
+
+        void* m_sqRing;
+        size_t m_sqRingSize;
+        void* m_cqRing;
+        size_t m_cqRingSize;
+        io_uring_sqe* m_sqes;
+        size_t m_sqesSize;
+
+        unsigned* m_sqHead;
+        unsigned* m_sqTail;
+        unsigned* m_sqMask;
+        unsigned* m_sqArray;
+        unsigned m_sqEntries;
+        // Entries handed out by NextSqe but not yet published to the kernel
+        unsigned m_sqeHead;
+        unsigned m_sqeTail;
+
+        unsigned* m_cqHead;
+        unsigned* m_cqTail;
+        unsigned* m_cqMask;
+        io_uring_cqe* m_cqes;
+    };
+
+    // Receive buffers the kernel picks from when a recv is submitted with IOSQE_BUFFER_SELECT,
+    // memory is only tied to a socket while data is actually sitting in it
+    class ProvidedBufferRing
+    {
+    public:
+        ProvidedBufferRing(IoUring& ring, std::uint16_t group, std::uint16_t count, std::uint32_t bufferSize);
+        ProvidedBufferRing(const ProvidedBufferRing&) = delete;
+        ProvidedBufferRing& operator=(const ProvidedBufferRing&) = delete;
+        ~ProvidedBufferRing();
+
+        inline std::uint16_t Group() const noexcept { return m_group; }
+
+        inline std::span<const std::uint8_t> Buffer(std::uint16_t id, size_t length) const
+        {
+            return { m_buffers.data() + size_t(id) * m_bufferSize, length };
+        }
+
+        // Gives a buffer back to the kernel once its content was consumed
+        void Recycle(std::uint16_t id);
+
+    private:
+        IoUring& m_ring;
+        std::uint16_t m_group;
+        std::uint16_t m_count;
+        std::uint32_t m_bufferSize;
+        io_uring_buf_ring* m_bufRing;
+        size_t m_bufRingSize;
+        std::vector<std::uint8_t> m_buffers;
+    };
+}
+
+#endif //IO_URING_H
@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+namespace mc
+{
+    // Read only private mapping of a whole file, unmapped when destroyed
+    class MappedFile
+    {
+    public:
+        // nullptr if the file does not exist or is empty, throws std::system_error if it can't be mapped.
+        // advice is handed to madvise
+        static std::unique_ptr<MappedFile> Open(const std::filesystem::path& path, int advice);
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        inline std::span<const std::uint8_t> Data() const noexcept { return { m_data, m_size }; }
+        inline size_t Size() const noexcept { return m_size; }
+
+    private:
+        MappedFile(const std::uint8_t* data, size_t size);
+
+        const std::uint8_t* m_data;
+        size_t m_size;
+    };
+}
+
+#endif //MAPPED_FILE_H
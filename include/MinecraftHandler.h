@@ -20,8 +20,6 @@ namespace mc
         void OnConnected(iu::Connection& connection)override;
         void Stop()override;
     private:
-        void BuildRegistryPackets();
-    private:
 
         ServerContext m_context;
         std::atomic_bool m_stop;
@@ -0,0 +1,91 @@
+#ifndef OUTBOUND_QUEUE_H
+#define OUTBOUND_QUEUE_H
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace mc
+{
+    // Serialized packets waiting for the socket.
+    // Small packets are appended to a shared segment, big ones are taken over as they are and
+    // prebuilt or shared ones are only referenced, so everything queued during a handler step leaves with
+    // a single sendmsg. While corked nothing is flushed, which lets a whole step be batched.
+    // Owned buffers go back to the BufferPool once they were sent.
+    // Push reports when more than the limit is waiting so the owner can stop reading from the
+    // peer until it catches up, nothing is ever dropped.
+    class OutboundQueue
+    {
+    public:
+        constexpr static size_t DEFAULT_LIMIT   = 8 * 1024 * 1024;
+        // Packets smaller than this are copied into a shared segment
+        constexpr static size_t COALESCE_SIZE   = 2 * 1024;
+        constexpr static size_t SEGMENT_SIZE    = 16 * 1024;
+        // Well below IOV_MAX
+        constexpr static size_t MAX_IOVECS      = 64;
+
+        enum class FlushResult
+        {
+            DONE,
+            BLOCKED,
+            CORKED,
+            FAILED
+        };
+
+        OutboundQueue(size_t limit = DEFAULT_LIMIT);
+        ~OutboundQueue() = default;
+
+        // All of them return false once the queue is over its limit, the data is queued anyway
+        bool Push(std::span<const std::uint8_t> data);
+        bool Push(std::vector<std::uint8_t>&& data);
+        // data is not copied and has to stay alive until it was sent (ServerContext packets)
+        bool PushBorrowed(std::span<const std::uint8_t> data);
+        // data is shared with other queues and held until it was sent
+        bool PushShared(std::shared_ptr<const std::vector<std::uint8_t>> data);
+
+        // Corks nest, the queue is flushable again once every Cork got its Uncork
+        inline void Cork() noexcept { ++m_corks; }
+        inline void Uncork() noexcept { if (m_corks > 0) --m_corks; }
+        inline bool IsCorked() const noexcept { return m_corks > 0; }
+
+        inline size_t Size() const noexcept { return m_size; }
+        inline bool Empty() const noexcept { return m_size == 0; }
+        inline bool IsFull() const noexcept { return m_size > m_limit; }
+
+        // Points out at the oldest queued bytes, returns how many entries were filled.
+        // Queued memory never moves so the iovecs stay valid while more is pushed
+        size_t Gather(std::span<iovec> out) const;
+        // Drops the first bytes once the transport took them
+        void Consume(size_t bytes);
+
+        // Writes as much as the non blocking socket accepts
+        FlushResult Flush(int fd);
+
+    private:
+        struct Segment
+        {
+            std::vector<std::uint8_t> owned;
+            std::shared_ptr<const std::vector<std::uint8_t>> shared;
+            const std::uint8_t* data;
+            size_t size;
+            // Small packets may still be appended
+            bool open;
+        };
+
+        bool Append(Segment segment);
+
+        std::deque<Segment> m_segments;
+        // Already sent part of the front segment
+        size_t m_offset;
+        size_t m_size;
+        size_t m_limit;
+        unsigned m_corks;
+    };
+}
+
+#endif //OUTBOUND_QUEUE_H
@@ -0,0 +1,465 @@
+#ifndef PACKET_SCHEMA_H
+#define PACKET_SCHEMA_H
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "DataTypes/Identifier.h"
+#include "DataTypes/Position.h"
+#include "utils.h"
+
+// Packets describe their layout once as a list of fields:
+//
+//   using Schema = schema::PacketSchema<PlayPacketID::GameEvent,
+//       schema::Field<schema::UByte, &GameEvent::m_event>,
+//       schema::Field<schema::Float, &GameEvent::m_value>>;
+//
+// and the exact size, the writer and the bounds checked reader all come from that list, so they
+// can't disagree. A field reads a data member or calls a const member function, Constant writes
+// a fixed value
+namespace mc::schema
+{
+    // ##############
+    // # Wire types #
+    // ##############
+
+    // Fixed size, big endian
+    template<typename T>
+    struct BigEndian {};
+
+    using Bool   = BigEndian<bool>;
+    using Byte   = BigEndian<std::int8_t>;
+    using UByte  = BigEndian<std::uint8_t>;
+    using Short  = BigEndian<std::int16_t>;
+    using UShort = BigEndian<std::uint16_t>;
+    using Int    = BigEndian<std::int32_t>;
+    using Long   = BigEndian<std::int64_t>;
+    using Float  = BigEndian<float>;
+    using Double = BigEndian<double>;
+
+    struct VarInt {};
+    struct VarLong {};
+    // VarInt length then the bytes
+    struct String {};
+    struct Identifier {};
+    struct UUID {};
+    struct Position {};
+    // VarInt count then the elements
+    template<typename Wire>
+    struct Array {};
+    // Bool then the value when it is true
+    template<typename Wire>
+    struct Optional {};
+    // The fields of T::Schema inline
+    template<typename T>
+    struct Struct {};
+
+    // ##########
+    // # Reader #
+    // ##########
+
+    // Every read is checked against the end of the packet, a short or lying packet throws
+    // std::runtime_error instead of reading past it
+    class Reader
+    {
+    public:
+        explicit Reader(std::span<const std::uint8_t> data) noexcept
+            : m_data(data),
+            m_position(0)
+        {}
+
+        std::span<const std::uint8_t> Take(size_t size)
+        {
+            if (size > Remaining())
+                throw std::runtime_error("Packet ends before its fields do");
+            const auto bytes = m_data.subspan(m_position, size);
+            m_position += size;
+            return bytes;
+        }
+
+        inline std::int32_t ReadVarInt() { return util::readVarInt(m_data, m_position); }
+        inline std::int64_t ReadVarLong() { return util::readVarLong(m_data, m_position); }
+
+        // Counts and lengths, a negative one is as malformed as a too long one
+        size_t ReadLength()
+        {
+            const std::int32_t length = ReadVarInt();
+            if (length < 0 || size_t(length) > Remaining())
+                throw std::runtime_error("Packet announces " + std::to_string(length) + " elements past its end");
+            return length;
+        }
+
+        inline size_t Remaining() const noexcept { return m_data.size() - m_position; }
+
+    private:
+        std::span<const std::uint8_t> m_data;
+        size_t m_position;
+    };
+
+    // ##########
+    // # Codecs #
+    // ##########
+
+    // Size(value), Write(out, value) returning the end of what it wrote, Read(reader)
+    template<typename Wire>
+    struct Codec;
+
+    template<typename T>
+    struct Codec<BigEndian<T>>
+    {
+        constexpr static size_t Size(const auto&) noexcept { return sizeof(T); }
+
+        static std::uint8_t* Write(std::uint8_t* out, const auto& value) noexcept
+        {
+            util::storeBigEndian(out, static_cast<T>(value));
+            return out + sizeof(T);
+        }
+
+        static T Read(Reader& reader)
+        {
+            if constexpr (std::same_as<T, bool>)
+                return reader.Take(1)[0] != 0;
+            else
+                return util::loadBigEndian<T>(reader.Take(sizeof(T)).data());
+        }
+    };
+
+    template<>
+    struct Codec<VarInt>
+    {
+        constexpr static size_t Size(const auto& value) noexcept { return util::sizeOfVarInt(value); }
+        static std::uint8_t* Write(std::uint8_t* out, const auto& value) noexcept { return out + util::encodeVarInt(out, value); }
+        static std::int32_t Read(Reader& reader) { return reader.ReadVarInt(); }
+    };
+
+    template<>
+    struct Codec<VarLong>
+    {
+        constexpr static size_t Size(const auto& value) noexcept { return util::sizeOfVarLong(value); }
+        static std::uint8_t* Write(std::uint8_t* out, const auto& value) noexcept { return out + util::encodeVarLong(out, value); }
+        static std::int64_t Read(Reader& reader) { return reader.ReadVarLong(); }
+    };
+
+    template<>
+    struct Codec<String>
+    {
+        static size_t Size(std::string_view value) noexcept { return util::sizeOfString(value); }
+
+        static std::uint8_t* Write(std::uint8_t* out, std::string_view value) noexcept
+        {
+            out += util::encodeVarInt(out, value.size());
+            std::memcpy(out, value.data(), value.size());
+            return out + value.size();
+        }
+
+        static std::string Read(Reader& reader)
+        {
+            const auto bytes = reader.Take(reader.ReadLength());
+            return std::string(bytes.begin(), bytes.end());
+        }
+    };
+
+    template<>
+    struct Codec<Identifier>
+    {
+        static size_t Size(const mc::Identifier& value) noexcept { return value.Encoded().size(); }
+
+        static std::uint8_t* Write(std::uint8_t* out, const mc::Identifier& value) noexcept
+        {
+            const auto encoded = value.Encoded();
+            std::memcpy(out, encoded.data(), encoded.size());
+            return out + encoded.size();
+        }
+
+        // Packets come from clients, a name that was never interned or isn't valid is empty instead
+        // of growing the table. Trusted data interns the String itself
+        static std::optional<mc::Identifier> Read(Reader& reader)
+        {
+            const auto bytes = reader.Take(reader.ReadLength());
+            return mc::Identifier::Find(std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size()));
+        }
+    };
+
+    template<>
+    struct Codec<UUID>
+    {
+        constexpr static size_t Size(const util::uuid&) noexcept { return 16; }
+
+        static std::uint8_t* Write(std::uint8_t* out, const util::uuid& value) noexcept
+        {
+            std::memcpy(out, value.begin(), 16);
+            return out + 16;
+        }
+
+        static util::uuid Read(Reader& reader)
+        {
+            auto bytes = reader.Take(16).begin();
+            return util::uuid(bytes);
+        }
+    };
+
+    template<>
+    struct Codec<Position>
+    {
+        constexpr static size_t Size(const mc::Position&) noexcept { return sizeof(std::int64_t); }
+
+        static std::uint8_t* Write(std::uint8_t* out, const mc::Position& value) noexcept
+        {
+            return Codec<Long>::Write(out, value.Get());
+        }
+
+        static mc::Position Read(Reader& reader)
+        {
+            const std::int64_t packed = Codec<Long>::Read(reader);
+            return mc::Position(packed >> 38, packed << 26 >> 38, packed << 52 >> 52);
+        }
+    };
+
+    template<typename Wire>
+    struct Codec<Array<Wire>>
+    {
+        template<typename T>
+        static size_t Size(const std::vector<T>& values)
+        {
+            size_t size = util::sizeOfVarInt(values.size());
+            for (const auto& value : values)
+                size += Codec<Wire>::Size(value);
+            return size;
+        }
+
+        template<typename T>
+        static std::uint8_t* Write(std::uint8_t* out, const std::vector<T>& values)
+        {
+            out += util::encodeVarInt(out, values.size());
+            for (const auto& value : values)
+                out = Codec<Wire>::Write(out, value);
+            return out;
+        }
+
+        static auto Read(Reader& reader)
+        {
+            // Every element is at least a byte, so the count can't reserve more than the packet holds
+            const size_t count = reader.ReadLength();
+            std::vector<decltype(Codec<Wire>::Read(reader))> values;
+            values.reserve(count);
+            for (size_t i = 0; i < count; ++i)
+                values.push_back(Codec<Wire>::Read(reader));
+            return values;
+        }
+    };
+
+    // Numbers stored as the wire type are copied and swapped in bulk
+    template<typename T>
+    struct Codec<Array<BigEndian<T>>>
+    {
+        template<typename U>
+        static size_t Size(const std::vector<U>& values) noexcept
+        {
+            return util::sizeOfVarInt(values.size()) + values.size() * sizeof(T);
+        }
+
+        template<typename U>
+        static std::uint8_t* Write(std::uint8_t* out, const std::vector<U>& values) noexcept
+        {
+            out += util::encodeVarInt(out, values.size());
+            if constexpr (std::same_as<U, T> && !std::same_as<T, bool>)
+            {
+                if (!values.empty())
+                    std::memcpy(out, values.data(), values.size() * sizeof(T));
+                util::nativeToBigEndian<T>(out, values.size());
+                return out + values.size() * sizeof(T);
+            }
+            else
+            {
+                for (const auto& value : values)
+                    out = Codec<BigEndian<T>>::Write(out, value);
+                return out;
+            }
+        }
+
+        static std::vector<T> Read(Reader& reader)
+        {
+            const size_t count = reader.ReadLength();
+            std::vector<T> values(count);
+            if constexpr (std::same_as<T, bool>)
+            {
+                for (auto&& value : values)
+                    value = Codec<BigEndian<T>>::Read(reader);
+            }
+            else
+                util::readBigEndian(reader.Take(count * sizeof(T)), std::span(values));
+            return values;
+        }
+    };
+
+    template<typename Wire>
+    struct Codec<Optional<Wire>>
+    {
+        template<typename T>
+        static size_t Size(const std::optional<T>& value)
+        {
+            return 1 + (value.has_value() ? Codec<Wire>::Size(*value) : 0);
+        }
+
+        template<typename T>
+        static std::uint8_t* Write(std::uint8_t* out, const std::optional<T>& value)
+        {
+            out = Codec<Bool>::Write(out, value.has_value());
+            return value.has_value() ? Codec<Wire>::Write(out, *value) : out;
+        }
+
+        static auto Read(Reader& reader)
+        {
+            std::optional<decltype(Codec<Wire>::Read(reader))> value;
+            if (Codec<Bool>::Read(reader))
+                value.emplace(Codec<Wire>::Read(reader));
+            return value;
+        }
+    };
+
+    template<typename T>
+    struct Codec<Struct<T>>
+    {
+        static size_t Size(const T& value) { return T::Schema::Size(value); }
+        static std::uint8_t* Write(std::uint8_t* out, const T& value) { return T::Schema::Write(out, value); }
+
+        static T Read(Reader& reader)
+        {
+            T value{};
+            T::Schema::Read(reader, value);
+            return value;
+        }
+    };
+
+    // ##########
+    // # Fields #
+    // ##########
+
+    // Accessor is a data member pointer, or a const member function for values computed when written
+    template<typename WireType, auto Accessor>
+    struct Field
+    {
+        using Wire = WireType;
+
+        template<typename T>
+        static decltype(auto) Get(const T& object) { return std::invoke(Accessor, object); }
+
+        template<typename T>
+        static void Read(Reader& reader, T& object)
+        {
+            using Member = std::remove_reference_t<decltype(object.*Accessor)>;
+            object.*Accessor = static_cast<Member>(Codec<Wire>::Read(reader));
+        }
+    };
+
+    // Always writes Value, read and dropped
+    template<typename WireType, auto Value>
+    struct Constant
+    {
+        using Wire = WireType;
+
+        template<typename T>
+        constexpr static auto Get(const T&) noexcept { return Value; }
+
+        template<typename T>
+        static void Read(Reader& reader, T&) { Codec<Wire>::Read(reader); }
+    };
+
+    template<typename... Fields>
+    struct FieldList
+    {
+        template<typename T>
+        static size_t Size(const T& object)
+        {
+            return (Codec<typename Fields::Wire>::Size(Fields::Get(object)) + ... + size_t(0));
+        }
+
+        // out has room for Size(object) bytes
+        template<typename T>
+        static std::uint8_t* Write(std::uint8_t* out, const T& object)
+        {
+            ((out = Codec<typename Fields::Wire>::Write(out, Fields::Get(object))), ...);
+            return out;
+        }
+
+        template<typename T>
+        static void Read(Reader& reader, T& object)
+        {
+            (Fields::Read(reader, object), ...);
+        }
+    };
+
+    // A whole packet, the id followed by the fields
+    template<auto Id, typename... Fields>
+    struct PacketSchema
+    {
+        constexpr static auto ID = Id;
+
+        // Packet id and fields, what the length prefix counts
+        template<typename T>
+        static size_t PayloadSize(const T& object)
+        {
+            return util::sizeOfVarInt(int(Id)) + FieldList<Fields...>::Size(object);
+        }
+
+        // Appends the frame, length prefix included. Every field is read from object once and the
+        // buffer grows once, to the exact size
+        template<typename T>
+        static void Serialize(std::vector<std::uint8_t>& buffer, const T& object)
+        {
+            const std::tuple<decltype(Fields::Get(object))...> values(Fields::Get(object)...);
+            [&]<size_t... I>(std::index_sequence<I...>)
+            {
+                const size_t payload = util::sizeOfVarInt(int(Id)) +
+                    (Codec<typename Fields::Wire>::Size(std::get<I>(values)) + ... + size_t(0));
+
+                const size_t start = buffer.size();
+                buffer.resize(start + util::sizeOfVarInt(payload) + payload);
+
+                std::uint8_t* out = buffer.data() + start;
+                out += util::encodeVarInt(out, payload);
+                out += util::encodeVarInt(out, int(Id));
+                ((out = Codec<typename Fields::Wire>::Write(out, std::get<I>(values))), ...);
+            }(std::index_sequence_for<Fields...>{});
+        }
+
+        // data is what follows the packet id, throws std::runtime_error if it ends early
+        template<typename T>
+        static void Deserialize(std::span<const std::uint8_t> data, T& object)
+        {
+            Reader reader(data);
+            FieldList<Fields...>::Read(reader, object);
+        }
+    };
+
+    template<typename T>
+    concept Packet = requires { T::Schema::ID; };
+}
+
+template<mc::schema::Packet T>
+struct iu::Serializer<T>
+{
+    size_t GetSize(const T& object)
+    {
+        const size_t payload = T::Schema::PayloadSize(object);
+        return mc::util::sizeOfVarInt(payload) + payload;
+    }
+
+    void Serialize(std::vector<uint8_t>& buffer, const T& toSerialize)
+    {
+        T::Schema::Serialize(buffer, toSerialize);
+    }
+};
+
+#endif //PACKET_SCHEMA_H
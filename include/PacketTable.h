@@ -0,0 +1,43 @@
+#ifndef PACKET_TABLE_H
+#define PACKET_TABLE_H
+
+#include <cstdint>
+#include <span>
+
+#include "PacketSchema.h"
+
+namespace mc
+{
+    // Compile time map from packet id to packet type for one connection state, the id of each
+    // packet is the one in its Schema.
+    // Dispatch decodes the packet on the stack and calls the handler overload for its concrete
+    // type, so a packet costs no allocation and no virtual call. The id checks are a fold the
+    // compiler turns into a switch
+    template<schema::Packet... Packets>
+    class PacketTable
+    {
+    public:
+        // payload is what follows the packet id. Returns false when no packet has that id,
+        // throws std::runtime_error when the payload is too short for the packet
+        template<typename Handler>
+        static bool Dispatch(int id, std::span<const std::uint8_t> payload, Handler&& handler)
+        {
+            return (TryPacket<Packets>(id, payload, handler) || ...);
+        }
+
+    private:
+        template<typename Type, typename Handler>
+        static bool TryPacket(int id, std::span<const std::uint8_t> payload, Handler& handler)
+        {
+            if (id != int(Type::Schema::ID))
+                return false;
+
+            Type packet;
+            Type::Schema::Deserialize(payload, packet);
+            handler(static_cast<const Type&>(packet));
+            return true;
+        }
+    };
+}
+
+#endif //PACKET_TABLE_H
@@ -0,0 +1,164 @@
+#ifndef PALETTED_CONTAINER_H
+#define PALETTED_CONTAINER_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "DataTypes/NBTLazyDocument.h"
+
+namespace mc
+{
+    class BlockStateRegistry;
+
+    // Block states (16x16x16) or biomes (4x4x4) of one chunk section, in the layout the Chunk Data
+    // packet and the region files use: entries are packed into longs, as many as fit, never split
+    // over two of them, lowest bits first.
+    // It moves between three palettes as values are added:
+    //  single value - bits is 0, no data at all
+    //  indirect     - data holds indices into a palette of up to 2^maxBits ids
+    //  direct       - data holds the ids themselves, directBits each
+    // When the palette outgrows the current width every entry is unpacked and packed again at
+    // the next one in a single pass. The palette never shrinks on its own, Assign rebuilds it
+    class PalettedContainer
+    {
+    public:
+        constexpr static size_t BLOCK_STATE_COUNT = 4096;
+        constexpr static size_t BIOME_COUNT       = 64;
+        constexpr static unsigned MAX_BITS        = 31;
+        // Of an indirect palette, maxBits is at most 8
+        constexpr static size_t MAX_PALETTE_SIZE  = 256;
+
+        PalettedContainer(size_t size, unsigned minBits, unsigned maxBits, unsigned directBits, int value);
+        ~PalettedContainer() = default;
+
+        // directBits is BitsFor(number of ids) of the registry the values come from
+        static inline PalettedContainer BlockStates(unsigned directBits, int value = 0)
+        {
+            return PalettedContainer(BLOCK_STATE_COUNT, 4, 8, directBits, value);
+        }
+        static inline PalettedContainer Biomes(unsigned directBits, int value = 0)
+        {
+            return PalettedContainer(BIOME_COUNT, 1, 3, directBits, value);
+        }
+
+        // Bits needed to tell that many values apart, 0 for a single one
+        static constexpr unsigned BitsFor(size_t count) noexcept
+        {
+            unsigned bits = 0;
+            while (count > (size_t(1) << bits))
+                ++bits;
+            return bits;
+        }
+
+        // Section local coordinates, 0 to 15 for blocks and 0 to 3 for biomes
+        static constexpr size_t BlockIndex(int x, int y, int z) noexcept { return size_t(y) << 8 | size_t(z) << 4 | size_t(x); }
+        static constexpr size_t BiomeIndex(int x, int y, int z) noexcept { return size_t(y) << 4 | size_t(z) << 2 | size_t(x); }
+
+        // Section compound's "block_states", palette entries are looked up in the registry.
+        // Throws std::runtime_error if it is malformed or names a block the registry doesn't know
+        static PalettedContainer LoadBlockStates(const NBT::LazyTag& blockStates, const BlockStateRegistry& registry);
+        // Section compound's "biomes", resolve maps a biome name to its id (std::optional<int>)
+        template<typename Resolve>
+        static PalettedContainer LoadBiomes(const NBT::LazyTag& biomes, unsigned directBits, Resolve&& resolve)
+        {
+            std::vector<int> palette;
+            for (const NBT::LazyTag& entry : PaletteOf(biomes))
+            {
+                const std::string_view name = entry.Get<NBT::String>();
+                const std::optional<int> id = resolve(name);
+                if (!id.has_value())
+                    throw std::runtime_error("Unknown biome " + std::string(name));
+                palette.push_back(*id);
+            }
+            PalettedContainer container = Biomes(directBits);
+            container.Load(std::move(palette), biomes);
+            return container;
+        }
+
+        inline int Get(size_t index) const
+        {
+            if (m_bits == 0)
+                return m_palette.front();
+            const std::uint32_t raw = GetRaw(index);
+            return m_palette.empty() ? int(raw) : m_palette[raw];
+        }
+        // Returns the value that was replaced
+        int Set(size_t index, int value);
+        // Back to a single value palette
+        void Fill(int value);
+
+        // Every entry at once, out has to hold Size() values
+        void Unpack(std::span<int> out) const;
+        // Replaces every entry with the smallest palette that holds them, values has to hold Size() values
+        void Assign(std::span<const int> values);
+
+        // Entries whose value satisfies predicate, which is asked once per palette entry.
+        // Direct palettes ask it once per entry
+        template<typename Predicate>
+        size_t CountIf(Predicate&& predicate) const
+        {
+            if (m_bits == 0)
+                return predicate(m_palette.front()) ? m_size : 0;
+
+            if (IsDirect())
+            {
+                std::array<int, BLOCK_STATE_COUNT> values;
+                const auto entries = std::span(values).first(m_size);
+                Unpack(entries);
+                return std::ranges::count_if(entries, predicate);
+            }
+
+            std::array<std::uint8_t, MAX_PALETTE_SIZE> matches{};
+            for (size_t i = 0; i < m_palette.size(); ++i)
+                matches[i] = predicate(m_palette[i]) ? 1 : 0;
+            return CountMatching(matches);
+        }
+
+        inline size_t Size() const noexcept { return m_size; }
+        inline unsigned Bits() const noexcept { return m_bits; }
+        inline bool IsSingleValue() const noexcept { return m_bits == 0; }
+        inline bool IsDirect() const noexcept { return m_bits != 0 && m_palette.empty(); }
+        // The value of a single value palette, ids of an indirect one, empty for direct
+        inline std::span<const int> Palette() const noexcept { return m_palette; }
+        // Packed entries, empty for a single value palette
+        inline std::span<const std::uint64_t> Data() const noexcept { return m_data; }
+
+    private:
+        static std::vector<NBT::LazyTag> PaletteOf(const NBT::LazyTag& container);
+
+        // Entries whose palette index is flagged in matches
+        size_t CountMatching(std::span<const std::uint8_t, MAX_PALETTE_SIZE> matches) const;
+
+        // Takes the resolved palette of a "block_states" or "biomes" compound plus its data
+        void Load(std::vector<int> palette, const NBT::LazyTag& container);
+        // Repacks every entry at bits, the palette is dropped once bits is past maxBits
+        void Resize(unsigned bits);
+
+        inline std::uint32_t GetRaw(size_t index) const
+        {
+            const size_t perLong = 64 / m_bits;
+            return std::uint32_t(m_data[index / perLong] >> (index % perLong * m_bits)) & m_mask;
+        }
+        // Returns the raw value that was replaced
+        std::uint32_t SetRaw(size_t index, std::uint32_t raw);
+
+        size_t m_size;
+        unsigned m_minBits;
+        unsigned m_maxBits;
+        unsigned m_directBits;
+        unsigned m_bits;
+        std::uint32_t m_mask;
+        std::vector<int> m_palette;
+        std::vector<std::uint64_t> m_data;
+    };
+}
+
+#endif //PALETTED_CONTAINER_H
@@ -1,10 +1,16 @@
 #ifndef PLAYER_HANDLER_H
 #define PLAYER_HANDLER_H
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <mutex>
+#include <span>
 #include <spdlog/spdlog.h>
 #include <nlohmann/json.hpp>
-#include <SFW/Connection.h>
 
+#include "ChunkBatcher.h"
+#include "ChunkView.h"
+#include "ClientConnection.h"
 #include "Packet.h"
 #include "ClientPackets.h"
 #include "SFW/LoggerManager.h"
@@ -26,6 +32,8 @@ namespace mc
     class PlayerHandler
     {
     public:
+        constexpr static auto TICK_INTERVAL = std::chrono::milliseconds(50);
+
         PlayerHandler() = delete;
         PlayerHandler(const PlayerHandler&) = delete;
         PlayerHandler(PlayerHandler&&) = delete;
@@ -33,140 +41,77 @@ namespace mc
         PlayerHandler& operator=(const PlayerHandler&) = delete;
         PlayerHandler& operator=(PlayerHandler&&) = delete;
 
-        PlayerHandler(iu::Connection& client, const ServerContext& context);
+        PlayerHandler(ClientConnection& client, const ServerContext& context);
         ~PlayerHandler() = default;
 
-        void Execute(const std::vector<uint8_t>& data);
+        inline PlayerHandlerState GetState() const noexcept { return m_state; }
 
-        void OnIdle(Packet::PacketPtr&& genericPacket);
-        void OnStatus(Packet::PacketPtr&& genericPacket);
-        void OnLogin(Packet::PacketPtr&& genericPacket);
-        void OnConfig(Packet::PacketPtr&& genericPacket);
-        void OnPlay(Packet::PacketPtr&& genericPacket);
+        // Handles one frame (packet id + payload) as produced by FrameDecoder
+        void Execute(std::span<const uint8_t> frame);
 
-        void PlayLoop();
+        // Periodic work that isn't triggered by a packet, safe to call as often as wanted.
+        // Chunks are paced per game tick, so transports should call it about every TICK_INTERVAL
+        void Tick();
+        // Blocking alternative to Tick for transports that own a thread per player. Runs on a thread
+        // of its own while the connection's thread keeps reading, mutex is held around every tick
+        // and has to be held around Execute too. Returns once stop is set or the player left PLAY
+        void PlayLoop(const std::atomic_bool& stop, std::mutex& mutex);
 
     private:
-        template<util::IteratorU8 Iter>
-        Packet::PacketPtr NextPacketIdle(Iter& dataIter)
-        {
-            using namespace mc::client;
-            int packetSize = util::readVarInt(dataIter);
-            int packetID;
-
-            if (packetSize == 0)
-                return nullptr;
-            packetID = util::readVarInt(dataIter);
-
-            switch (static_cast<IdlePacketID>(packetID)) {
-                case IdlePacketID::HANDSHAKE:
-                    return std::make_unique<HandshakePacket>(dataIter);
-                default:
-                    //maybe needs to throw
-                    SFW_LOG_WARN("PlayerHandler", "Invalid idle packetID: {:0x}", packetID);
-                    return nullptr;
-            }
-        }
-
-        template<util::IteratorU8 Iter>
-        Packet::PacketPtr NextPacketStatus(Iter& dataIter)
+        constexpr static auto POSITION_SYNC_INTERVAL = std::chrono::seconds(10);
+        constexpr static int VIEW_DISTANCE            = 16;
+        constexpr static double SPAWN_X               = 30;
+        constexpr static double SPAWN_Y               = 320;
+        constexpr static double SPAWN_Z               = 30;
+        // Queued chunks a batch may look at per chunk it is allowed to send, missing ones are free
+        // so this bounds the lookups of a tick past the edge of the world
+        constexpr static size_t LOOKUPS_PER_CHUNK     = 2;
+
+        // Everything goes through these so frames are rewritten once compression is on
+        template<typename T>
+        void Send(const T& packet)
         {
-            using namespace mc::client;
-            int packetSize = util::readVarInt(dataIter);
-            int packetID;
-
-            if(packetSize == 0)
-                return nullptr;
-
-            packetID = util::readVarInt(dataIter);
-
-            switch (static_cast<StatusPacketID>(packetID)) {
-                case StatusPacketID::STATUS:
-                    return std::make_unique<StatusRequestPacket>();
-                case StatusPacketID::PING:
-                    return std::make_unique<PingRequest>(dataIter);
-                default:
-                    //maybe needs to throw
-                        SFW_LOG_WARN("PlayerHandler", "Invalid status packetID: {:0x}", packetID);
-                    return nullptr; 
-            }
-        }
-
-        template<util::IteratorU8 Iter>
-        Packet::PacketPtr NextPacketLogin(Iter& dataIter)
-        {
-            using namespace mc::client;
-            int packetSize = util::readVarInt(dataIter);
-            int packetID;
-
-            if(packetSize == 0)
-                return nullptr;
-
-            packetID = util::readVarInt(dataIter);
-
-            switch(static_cast<LoginPacketID>(packetID))
-            {
-                case LoginPacketID::START:
-                    return std::make_unique<LoginStartPacket>(dataIter);
-                case LoginPacketID::LoginAcknowledged:
-                    return std::make_unique<LoginAckPacket>();
-                default:
-                    //maybe needs to throw
-                    SFW_LOG_WARN("PlayerHandler", "Invalid login packetID: {:0x}", packetID);
-                    return nullptr; 
-            }
+            Send(pool::serialize(packet));
         }
-
-        template<util::IteratorU8 Iter>
-        Packet::PacketPtr NextPacketConfig(Iter& dataIter)
-        {
-            using namespace mc::client;
-            int packetSize = util::readVarInt(dataIter);
-            int packetID;
-
-            if(packetSize == 0)
-                return nullptr;
-
-            packetID = util::readVarInt(dataIter);
-
-            switch(static_cast<ConfigPacketID>(packetID))
-            {
-                case mc::client::ConfigPacketID::AcknowledgeConfigEnd:
-                    return std::make_unique<AcknowledgeConfig>();
-                case mc::client::ConfigPacketID::KnownPacks:
-                    return std::make_unique<KnownPacksPacket>(dataIter);
-                default:
-                    //maybe needs to throw
-                    SFW_LOG_WARN("PlayerHandler", "Invalid config packetID: {:0x}", packetID);
-                    return nullptr; 
-            }
-        }
-
-        template<util::IteratorU8 Iter>
-        Packet::PacketPtr NextPacketPlay(Iter& dataIter)
-        {
-            using namespace mc::client;
-            int packetSize = util::readVarInt(dataIter);
-            int packetID;
-
-            if(packetSize == 0)
-                return nullptr;
-
-            packetID = util::readVarInt(dataIter);
-
-            switch(static_cast<PlayPacketID>(packetID))
-            {
-
-                default:
-                    //SFW_LOG_WARN("PlayerHandler", "Invalid play packetID: {:0x}", packetID);
-                    return nullptr;
-            }
-        }
-
-        iu::Connection& m_client;
+        void Send(std::vector<std::uint8_t>&& frames);
+        void SendRegistryPackets();
+        // False if the chunk doesn't exist, nothing was sent
+        bool SendChunk(int x, int z);
+        // As many queued chunks of the view as the batcher allows, framed as one batch
+        void SendChunkBatch();
+        void SendPositionSync();
+        // Follows the player to the chunk they are in, forgets what left the view and queues what entered it
+        void UpdateView();
+        void OnMove(double x, double y, double z);
+
+        // One overload per packet of the client::*Packets tables, called by Execute with the
+        // packet decoded on its stack
+        void OnPacket(const client::HandshakePacket& packet);
+        void OnPacket(const client::StatusRequestPacket& packet);
+        void OnPacket(const client::PingRequest& packet);
+        void OnPacket(const client::LoginStartPacket& packet);
+        void OnPacket(const client::LoginAckPacket& packet);
+        void OnPacket(const client::KnownPacksPacket& packet);
+        void OnPacket(const client::AcknowledgeConfig& packet);
+        void OnPacket(const client::ChunkBatchReceived& packet);
+        void OnPacket(const client::SetPlayerPosition& packet);
+        void OnPacket(const client::SetPlayerPositionAndRotation& packet);
+
+        ClientConnection& m_client;
         PlayerHandlerState m_state;
+        // Set once Set Compression went out, both directions use the compressed format from then on
+        bool m_compressed;
+        // Holds the last inflated frame
+        std::vector<std::uint8_t> m_inflated;
         const ServerContext& m_context;
         server::StatusPacket m_statusMessage;
+        std::chrono::steady_clock::time_point m_lastPositionSync;
+        // Last position the client reported
+        double m_x;
+        double m_y;
+        double m_z;
+        ChunkView m_view;
+        ChunkBatcher m_batcher;
     };
 }
 #endif //PLAYER_HANDLER_H
\ No newline at end of file
@@ -0,0 +1,129 @@
+#ifndef REGION_MANAGER_H
+#define REGION_MANAGER_H
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+
+#include "DataTypes/NBTLazyDocument.h"
+#include "MappedFile.h"
+
+namespace mc
+{
+    // Read only memory mapping of one Anvil .mca file.
+    // Only the pages of the offset table entries and chunks that are asked for ever get read
+    class RegionFile
+    {
+    public:
+        constexpr static int CHUNKS_PER_SIDE    = 32;
+        constexpr static size_t SECTOR_SIZE     = 4096;
+        // Offset table followed by the timestamp table
+        constexpr static size_t HEADER_SIZE     = 2 * SECTOR_SIZE;
+
+        // nullptr if the file does not exist, throws std::system_error if it can't be mapped
+        static std::unique_ptr<RegionFile> Open(const std::filesystem::path& path);
+
+        RegionFile(const RegionFile&) = delete;
+        RegionFile& operator=(const RegionFile&) = delete;
+        ~RegionFile() = default;
+
+        // Compressed payload of the chunk at local coordinates (0..31) and its compression type,
+        // empty if the chunk was never generated
+        std::optional<std::pair<std::uint8_t, std::span<const std::uint8_t>>> ChunkData(int localX, int localZ) const;
+
+        inline const std::filesystem::path& Path() const noexcept { return m_path; }
+
+    private:
+        RegionFile(std::filesystem::path path, std::unique_ptr<MappedFile> file);
+
+        std::filesystem::path m_path;
+        std::unique_ptr<MappedFile> m_file;
+        const std::uint8_t* m_data;
+        size_t m_size;
+    };
+
+    // Chunks of every region file in a world directory, loaded on demand by chunk coordinate.
+    // Region files are mapped the first time one of their chunks is needed and inflated chunks
+    // sit in an LRU bounded by chunk count, only the fields that are asked for ever get decoded. Handles keep a chunk alive after it was evicted.
+    // The cache is split into shards by the packed chunk coordinate, each with its own lock and
+    // LRU, so threads working on different chunks rarely wait on each other. Region files, mapped
+    // or found missing, sit in their own small LRU so players wandering around can't make it grow
+    // without bound, an evicted region is unmapped once no load still reads from it.
+    // Safe to use from every I/O thread
+    class RegionManager
+    {
+    public:
+        using ChunkHandle = std::shared_ptr<const NBT::LazyDocument>;
+
+        constexpr static size_t DEFAULT_CACHE_CAPACITY = 1024;
+        // Region files, including the ones that don't exist
+        constexpr static size_t REGION_CACHE_CAPACITY  = 256;
+        // Power of two, the capacity is split evenly between them
+        constexpr static size_t SHARD_COUNT            = 16;
+
+        RegionManager(std::filesystem::path directory, size_t cacheCapacity = DEFAULT_CACHE_CAPACITY);
+        RegionManager(const RegionManager&) = delete;
+        RegionManager& operator=(const RegionManager&) = delete;
+        ~RegionManager() = default;
+
+        // nullptr if the chunk was never generated or can't be decoded
+        ChunkHandle GetChunk(int x, int z) const;
+
+        // Drops the decoded chunk, the next GetChunk reads it from disk again. A load that was
+        // running meanwhile still hands its chunk to its caller but never caches it
+        void Evict(int x, int z);
+
+        size_t CachedChunks() const;
+
+    private:
+        using LruList = std::list<std::pair<std::uint64_t, ChunkHandle>>;
+        // nullptr for region files that don't exist so they are only looked up once while cached
+        using RegionHandle = std::shared_ptr<const RegionFile>;
+        using RegionLruList = std::list<std::pair<std::uint64_t, RegionHandle>>;
+
+        struct Shard
+        {
+            std::mutex mutex;
+            // Most recently used first
+            LruList lru;
+            std::unordered_map<std::uint64_t, LruList::iterator> chunks;
+            // Bumped by every eviction, a load that started before one doesn't get inserted
+            std::uint64_t generation = 0;
+        };
+
+        static inline std::uint64_t Key(int x, int z)
+        {
+            return (std::uint64_t(std::uint32_t(x)) << 32) | std::uint32_t(z);
+        }
+
+        // Fibonacci hashing so neighbouring chunks land in different shards
+        inline Shard& ShardOf(std::uint64_t key) const noexcept
+        {
+            return m_shards[(key * 0x9e3779b97f4a7c15ull) >> (64 - std::countr_zero(SHARD_COUNT))];
+        }
+
+        RegionHandle Region(int regionX, int regionZ) const;
+        ChunkHandle Load(int x, int z) const;
+
+        std::filesystem::path m_directory;
+        // Per shard
+        size_t m_shardCapacity;
+
+        mutable std::mutex m_regionsMutex;
+        // Most recently used first
+        mutable RegionLruList m_regionLru;
+        mutable std::unordered_map<std::uint64_t, RegionLruList::iterator> m_regions;
+
+        mutable std::array<Shard, SHARD_COUNT> m_shards;
+    };
+}
+
+#endif //REGION_MANAGER_H
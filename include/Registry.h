@@ -2,28 +2,65 @@
 #define REGITSTRY_H
 
 #include "BlockState.h"
+#include "MappedFile.h"
 #include "SFW/utils.h"
+#include <cstdint>
 #include <filesystem>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 namespace mc
 {
     //For now this shouldn't require thread safety
     //The class is written to at initialization
     //then threads only perform reads (or should)
+    //
+    //States follow the vanilla layout: every block owns a contiguous range of ids starting at its
+    //base id, its properties are mixed radix digits of the offset with the last one varying fastest.
+    //Converting between a BlockState and its id is arithmetic over the block's property tables and
+    //per state data lives in arrays indexed by state id
+    //
+    //Parsing the json report is slow so the result is cached in a binary snapshot next to it
+    //(blocks.json -> blocks.snapshot). The snapshot records a hash of the json it was built from and
+    //is rebuilt whenever they stop matching, its state arrays are used straight from the mapping.
+    //Every build also carries a report compiled in (generated/Blocks.h), InitBuiltin skips the file
+    //altogether. Without data/registries/blocks.json that is the trimmed one in tools/, which stops at
+    //deepslate_coal_ore
     class BlockStateRegistry
     {
     public:
+        constexpr static std::uint8_t AIR_FLAG    = 1 << 0;
+        constexpr static std::uint8_t OPAQUE_FLAG = 1 << 1;
 
         ~BlockStateRegistry()= default;
 
-        void MapState(BlockState state, int stateId);
-
         std::optional<int> GetBlockStateId(const BlockState& state)const;
         std::optional<BlockState> GetBlockState(int id)const;
 
+        std::optional<int> GetDefaultStateId(const Identifier& block)const;
+        // Id of the same state with one property changed, nothing is looked up by name but the property
+        std::optional<int> WithProperty(int stateId, std::string_view property, const BlockState::PropertyValue& value)const;
+
+        inline bool IsValidState(int id) const noexcept
+        {
+            return id >= 0 && size_t(id) < m_stateBlocks.size() && m_stateBlocks[id] != NO_BLOCK;
+        }
+        inline bool IsAir(int id) const noexcept { return IsValidState(id) && (m_stateFlags[id] & AIR_FLAG); }
+        inline bool IsOpaque(int id) const noexcept { return IsValidState(id) && (m_stateFlags[id] & OPAQUE_FLAG); }
+        inline std::uint8_t GetLightEmission(int id) const noexcept { return IsValidState(id) ? m_lightEmission[id] : 0; }
+        inline size_t StateCount() const noexcept { return m_stateBlocks.size(); }
+
+        // Bumped whenever the snapshot layout changes, older snapshots are then rebuilt
+        constexpr static std::uint32_t SNAPSHOT_VERSION = 1;
+        constexpr static const char* SNAPSHOT_EXTENSION = ".snapshot";
+
         static void Init(std::filesystem::path registryPath);
+        static void InitBuiltin();
         static void Deinit();
         static const BlockStateRegistry& Instance() noexcept
         {
@@ -31,15 +68,58 @@ namespace mc
             return *s_registryInstance;
         }
     private:
+        // Interned through BlockState, so matching a state's properties compares ids
+        struct Property
+        {
+            std::uint16_t name;
+            std::vector<std::uint16_t> values;
+            // How many ids apart two neighbouring values are
+            int stride;
+        };
+
+        struct Block
+        {
+            Identifier id;
+            int baseStateId;
+            int stateCount;
+            int defaultStateId;
+            // In the report's order, the last one varies fastest
+            std::vector<Property> properties;
+        };
+
+        // Marks ids no block claimed
+        constexpr static std::uint32_t NO_BLOCK = std::numeric_limits<std::uint32_t>::max();
+
         BlockStateRegistry();
 
-        std::unordered_map<BlockState, int> m_stateToIdMap;
-        std::unordered_map<int, BlockState> m_idToBlockState;
+        void AddBlock(Block block, std::span<const std::uint8_t> flags, std::span<const std::uint8_t> lightEmission);
+        const Block* FindBlock(const Identifier& id) const;
 
-        static inline std::unique_ptr<BlockStateRegistry> s_registryInstance = nullptr;
+        void LoadJson(std::string_view json);
+        // False if the snapshot is missing, stale or damaged, the registry is left empty then
+        bool LoadSnapshot(const std::filesystem::path& path, std::uint64_t sourceHash, std::uint64_t sourceSize);
+        void ReadSnapshot(std::span<const std::uint8_t> data, std::uint64_t sourceHash, std::uint64_t sourceSize);
+        // Written to a temporary file and renamed over the old one, failures are only logged
+        void WriteSnapshot(const std::filesystem::path& path, std::uint64_t sourceHash, std::uint64_t sourceSize) const;
+        void LoadBuiltin();
+        void Clear();
 
-        static void LoadRegistryFile(std::filesystem::path registryPath);
+        std::vector<Block> m_blocks;
+        std::unordered_map<Identifier, std::uint32_t> m_blockIndices;
+
+        // Filled while parsing the json, a registry loaded from a snapshot leaves them empty
+        std::vector<std::uint32_t> m_stateBlockStorage;
+        std::vector<std::uint8_t> m_stateFlagStorage;
+        std::vector<std::uint8_t> m_lightEmissionStorage;
+        std::unique_ptr<MappedFile> m_snapshot;
+
+        // Indexed by state id, point either into the storage above or into the snapshot
+        std::span<const std::uint32_t> m_stateBlocks;
+        std::span<const std::uint8_t> m_stateFlags;
+        std::span<const std::uint8_t> m_lightEmission;
+
+        static inline std::unique_ptr<BlockStateRegistry> s_registryInstance = nullptr;
     };
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,71 @@
+#ifndef REGISTRY_TABLES_H
+#define REGISTRY_TABLES_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <string_view>
+#include <utility>
+
+// Types of the tables the registry generator (tools/RegistryGenerator.cpp) emits into
+// generated/Blocks.h and generated/Registries.h at build time
+namespace mc::generated
+{
+    // Per state flags, shared with BlockStateRegistry
+    constexpr std::uint8_t AIR_FLAG    = 1 << 0;
+    constexpr std::uint8_t OPAQUE_FLAG = 1 << 1;
+    // Marks state ids no block claimed
+    constexpr std::uint32_t NO_BLOCK = 0xffffffff;
+
+    struct BlockProperty
+    {
+        std::string_view name;
+        // As written in the report, booleans and numbers included ("true", "5")
+        std::span<const std::string_view> values;
+        // How many ids apart two neighbouring values are
+        int stride;
+    };
+
+    struct BlockType
+    {
+        std::string_view name;
+        int baseStateId;
+        int stateCount;
+        int defaultStateId;
+        // In the report's order, the last one varies fastest
+        std::span<const BlockProperty> properties;
+
+        // WATER.State({ { "level", "0" } }), properties that are left out keep the default state's value.
+        // An unknown property or value fails to compile
+        consteval int State(std::initializer_list<std::pair<std::string_view, std::string_view>> values) const
+        {
+            int stateId = defaultStateId;
+            for (const auto& [name, value] : values)
+            {
+                const BlockProperty* property = nullptr;
+                for (const BlockProperty& candidate : properties)
+                {
+                    if (candidate.name == name)
+                        property = &candidate;
+                }
+                if (property == nullptr)
+                    throw "Unknown block property";
+
+                int index = -1;
+                for (size_t i = 0; i < property->values.size(); ++i)
+                {
+                    if (property->values[i] == value)
+                        index = i;
+                }
+                if (index < 0)
+                    throw "Unknown block property value";
+
+                const int current = (stateId - baseStateId) / property->stride % property->values.size();
+                stateId += (index - current) * property->stride;
+            }
+            return stateId;
+        }
+    };
+}
+
+#endif //REGISTRY_TABLES_H
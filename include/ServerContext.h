@@ -3,19 +3,36 @@
 #include <vector>
 #include <array>
 #include <stdint.h>
-#include "DataTypes/nbt.h"
+#include "ChunkPacketCache.h"
+#include "ChunkPacketEncoder.h"
+#include "RegionManager.h"
 
 
 namespace mc
 {
-    using ChunkRegion = std::array<std::array<std::optional<NBT::NBT>, 32>, 32>;
-
+    //Shared by every connection of a server backend, read only once Load returns
     struct ServerContext
     {
+        //World the chunks are read from, one r.<x>.<z>.mca per 32x32 chunks
+        constexpr static const char* REGION_DIRECTORY = "map";
+
         //Registry packets are prebuilt from the json
         std::array<std::vector<std::uint8_t>, 22> registry_packets;
-        ChunkRegion chunk_region;
+        //Same packets in the compressed format, empty when compression is disabled
+        std::array<std::vector<std::uint8_t>, 22> compressed_registry_packets;
+        //Maps region files and decodes chunks the first time they are asked for
+        RegionManager regions;
+        //Biome ids are taken from the worldgen/biome registry packet by Load
+        ChunkPacketEncoder chunk_encoder;
+        //Internally synchronized, the only part that keeps changing after Load
+        mutable ChunkPacketCache chunk_packets;
+
+        ServerContext();
+        void Load();
+    private:
+        void BuildRegistryPackets();
+        void LoadBiomes();
     };
 }
 
-#endif //SERVER_CONTEXT_H
\ No newline at end of file
+#endif //SERVER_CONTEXT_H
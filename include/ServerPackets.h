@@ -5,6 +5,7 @@
 #include "DataTypes/Identifier.h"
 #include "DataTypes/nbt.h"
 #include "Packet.h"
+#include "PacketSchema.h"
 #include "DataTypes/Position.h"
 #include <nlohmann/json.hpp>
 #include "SFW/Serializer.h"
@@ -24,13 +25,15 @@ namespace mc::server
     enum class StatusPacketID : int
     {
         UNKNOWN = -1,
-        STATUS  = 0
+        STATUS  = 0,
+        PONG    = 1
     };
 
     enum class LoginPacketID : int
     {
         UNKNOWN = -1,
-        SUCCESS = 0x02
+        SUCCESS = 0x02,
+        SetCompression = 0x03
     };
 
     enum class ConfigPacketID : int
@@ -43,9 +46,13 @@ namespace mc::server
     enum class PlayPacketID : int
     {
         UNKNOWN   = -1,
+        ChunkBatchFinished = 0x0B,
+        ChunkBatchStart = 0x0C,
+        ForgetLevelChunk = 0x21,
         GameEvent = 0x22,
         LoginPlay = 0x2b,
-        SynchronisePlayerPosition = 0x41
+        SynchronisePlayerPosition = 0x41,
+        SetCenterChunk = 0x57
     };
 
     // ****************
@@ -66,16 +73,34 @@ namespace mc::server
         }
 
         inline constexpr std::string PacketName() const override { return "LoginSuccessPacket"; }
-        inline size_t Size() const override 
-        {
-            return sizeof(util::uuid) +
-            util::sizeOfString(m_name) +
-            util::sizeOfVarInt(m_numOfElements);
-        }
+        inline size_t Size() const override { return Schema::PayloadSize(*this); }
     private:
         util::uuid m_uuid;
         std::string m_name;
         util::varInt m_numOfElements;
+    public:
+        using Schema = schema::PacketSchema<LoginPacketID::SUCCESS,
+            schema::Field<schema::UUID, &LoginSuccessPacket::m_uuid>,
+            schema::Field<schema::String, &LoginSuccessPacket::m_name>,
+            schema::Field<schema::VarInt, &LoginSuccessPacket::m_numOfElements>>;
+    };
+
+    class SetCompressionPacket : public Packet
+    {
+    public:
+        SetCompressionPacket(util::varInt threshold);
+        ~SetCompressionPacket() = default;
+
+        inline util::varInt GetThreshold() const { return m_threshold; }
+
+        inline std::string AsString() const override { return std::format("{{ threshold: {} }}", m_threshold); }
+        inline constexpr std::string PacketName() const override { return "SetCompression"; }
+        inline size_t Size() const override { return Schema::PayloadSize(*this); }
+    private:
+        util::varInt m_threshold;
+    public:
+        using Schema = schema::PacketSchema<LoginPacketID::SetCompression,
+            schema::Field<schema::VarInt, &SetCompressionPacket::m_threshold>>;
     };
 
     // *****************
@@ -96,11 +121,37 @@ namespace mc::server
 
         inline constexpr std::string PacketName() const override { return "StatusPacket"; }
 
-        inline size_t Size() const override { return 1 + util::sizeOfString(m_payload.dump());}
+        inline size_t Size() const override { return Schema::PayloadSize(*this); }
 
     private:
+        // Dumped when the packet is written, once per Serialize
+        inline std::string Text() const { return m_payload.dump(); }
+
         nlohmann::json m_payload;
+    public:
+        using Schema = schema::PacketSchema<StatusPacketID::STATUS,
+            schema::Field<schema::String, &StatusPacket::Text>>;
+    };
+
+    // Answers a client::PingRequest with its payload
+    class PongPacket : public Packet
+    {
+    public:
+        PongPacket(std::int64_t payload);
+        ~PongPacket() = default;
+
+        inline std::int64_t GetPayload() const { return m_payload; }
+
+        inline std::string AsString() const override { return std::format("{{ payload:{} }}", m_payload); }
+        inline constexpr std::string PacketName() const override { return "PongPacket"; }
+        inline size_t Size() const override { return Schema::PayloadSize(*this); }
+    private:
+        std::int64_t m_payload;
+    public:
+        using Schema = schema::PacketSchema<StatusPacketID::PONG,
+            schema::Field<schema::Long, &PongPacket::m_payload>>;
     };
+
     // *****************
     // * ConfigPackets *
     // *****************
@@ -110,11 +161,19 @@ namespace mc::server
     public:
         KnownPacksPacket(std::string nspace, std::string id, std::string version);
         ~KnownPacksPacket() = default;
+
+        inline size_t Size() const override { return Schema::PayloadSize(*this); }
     private:
-        friend iu::Serializer<KnownPacksPacket>;
         std::string m_namespace;
         std::string m_id;
         std::string m_version;
+    public:
+        //A single pack
+        using Schema = schema::PacketSchema<ConfigPacketID::KnownPacks,
+            schema::Constant<schema::VarInt, 1>,
+            schema::Field<schema::String, &KnownPacksPacket::m_namespace>,
+            schema::Field<schema::String, &KnownPacksPacket::m_id>,
+            schema::Field<schema::String, &KnownPacksPacket::m_version>>;
     };
 
     class FinishConfiguration : public Packet
@@ -125,7 +184,9 @@ namespace mc::server
 
         inline std::string AsString() const override { return std::format("FinishConfig");}
         inline constexpr std::string PacketName() const override { return "FinishConfiguration";}
-        inline size_t Size() const override { return 1;}
+        inline size_t Size() const override { return Schema::PayloadSize(*this); }
+
+        using Schema = schema::PacketSchema<ConfigPacketID::FinishConfiguration>;
     };
 
 
@@ -136,7 +197,7 @@ namespace mc::server
     class LoginPlayPacket : public Packet
     {
     public:
-        LoginPlayPacket();
+        LoginPlayPacket(util::varInt viewDistance);
 
         inline std::string AsString() const override
         {
@@ -170,47 +231,24 @@ namespace mc::server
                 m_previousGameMode,
                 m_isDebug,
                 m_isFlat,
-                m_hasDeathLocation,
+                m_deathLocation.has_value(),
                 m_seaLevel,
                 m_portalCooldown);
         }
 
         inline constexpr std::string PacketName() const override { return "LoginPlay"; }
-        inline size_t Size() const override
-        {
-            const size_t deathLocationSize =
-                m_hasDeathLocation ? (util::sizeOfString(m_deathDimension->AsString()) + sizeof(*m_deathDimension)) : 0;
-
-            size_t idendtifiers_size = util::sizeOfVarInt(m_dimensionIdentifiers.size());
-            for (const auto& identifier: m_dimensionIdentifiers)
-                idendtifiers_size += util::sizeOfString(identifier.AsString());
-
-            return 1 + //ID
-                sizeof(m_entityID) +
-                sizeof(m_isHardcore) +
-                idendtifiers_size +
-                util::sizeOfVarInt(m_maxPlayers) +
-                util::sizeOfVarInt(m_viewDistance) +
-                util::sizeOfVarInt(m_simulationDistance) +
-                sizeof(m_reducedDebugInfo) +
-                sizeof(m_enableRespawnScreen) +
-                sizeof(m_limitedCrafting) +
-                util::sizeOfVarInt(m_dimensionType) +
-                util::sizeOfString(m_dimensionName.AsString()) +
-                sizeof(m_seedHash) +
-                sizeof(m_gameMode) +
-                sizeof(m_previousGameMode) +
-                sizeof(m_isDebug) +
-                sizeof(m_isFlat) +
-                sizeof(m_hasDeathLocation) +
-                deathLocationSize +
-                util::sizeOfVarInt(m_portalCooldown) +
-                util::sizeOfVarInt(m_seaLevel) +
-                sizeof(m_enforceSecureChat);
-        }
+        inline size_t Size() const override { return Schema::PayloadSize(*this); }
 
     private:
-        friend iu::Serializer<mc::server::LoginPlayPacket>;
+        struct DeathLocation
+        {
+            Identifier dimension;
+            Position position;
+
+            using Schema = schema::FieldList<
+                schema::Field<schema::Identifier, &DeathLocation::dimension>,
+                schema::Field<schema::Position, &DeathLocation::position>>;
+        };
 
         int32_t m_entityID;
         bool m_isHardcore;
@@ -228,12 +266,32 @@ namespace mc::server
         int8_t m_previousGameMode;
         bool m_isDebug;
         bool m_isFlat;
-        bool m_hasDeathLocation;
-        std::optional<Identifier> m_deathDimension;
-        std::optional<Position> m_deathPosition;
+        std::optional<DeathLocation> m_deathLocation;
         util::varInt m_portalCooldown;
         util::varInt m_seaLevel;
         bool m_enforceSecureChat;
+    public:
+        using Schema = schema::PacketSchema<PlayPacketID::LoginPlay,
+            schema::Field<schema::Int, &LoginPlayPacket::m_entityID>,
+            schema::Field<schema::Bool, &LoginPlayPacket::m_isHardcore>,
+            schema::Field<schema::Array<schema::Identifier>, &LoginPlayPacket::m_dimensionIdentifiers>,
+            schema::Field<schema::VarInt, &LoginPlayPacket::m_maxPlayers>,
+            schema::Field<schema::VarInt, &LoginPlayPacket::m_viewDistance>,
+            schema::Field<schema::VarInt, &LoginPlayPacket::m_simulationDistance>,
+            schema::Field<schema::Bool, &LoginPlayPacket::m_reducedDebugInfo>,
+            schema::Field<schema::Bool, &LoginPlayPacket::m_enableRespawnScreen>,
+            schema::Field<schema::Bool, &LoginPlayPacket::m_limitedCrafting>,
+            schema::Field<schema::VarInt, &LoginPlayPacket::m_dimensionType>,
+            schema::Field<schema::Identifier, &LoginPlayPacket::m_dimensionName>,
+            schema::Field<schema::Long, &LoginPlayPacket::m_seedHash>,
+            schema::Field<schema::UByte, &LoginPlayPacket::m_gameMode>,
+            schema::Field<schema::Byte, &LoginPlayPacket::m_previousGameMode>,
+            schema::Field<schema::Bool, &LoginPlayPacket::m_isDebug>,
+            schema::Field<schema::Bool, &LoginPlayPacket::m_isFlat>,
+            schema::Field<schema::Optional<schema::Struct<DeathLocation>>, &LoginPlayPacket::m_deathLocation>,
+            schema::Field<schema::VarInt, &LoginPlayPacket::m_portalCooldown>,
+            schema::Field<schema::VarInt, &LoginPlayPacket::m_seaLevel>,
+            schema::Field<schema::Bool, &LoginPlayPacket::m_enforceSecureChat>>;
     };
 
     class GameEvent : public Packet
@@ -261,11 +319,14 @@ namespace mc::server
 
         inline std::string AsString() const override { return std::format("GameEvent{{ Event: {}, Value: {}}}", (int)m_event, m_value);}
         inline constexpr std::string PacketName() const override { return "GameEvent";}
-        inline size_t Size() const override { return 1 + sizeof(Event) + sizeof(float);}
+        inline size_t Size() const override { return Schema::PayloadSize(*this); }
     private:
-        friend iu::Serializer<mc::server::GameEvent>;
         Event m_event;
         float m_value; //depends on event
+    public:
+        using Schema = schema::PacketSchema<PlayPacketID::GameEvent,
+            schema::Field<schema::UByte, &GameEvent::m_event>,
+            schema::Field<schema::Float, &GameEvent::m_value>>;
     };
 
     class SynchronisePlayerPosition : public Packet
@@ -299,23 +360,8 @@ namespace mc::server
         }
 
         inline constexpr std::string PacketName() const override { return "SynchronisePlayerPosition"; }
-        inline size_t Size() const override
-        {
-            return 1 + //ID
-                   util::sizeOfVarInt(m_teleportID) +
-                   sizeof(m_x) +
-                   sizeof(m_y) +
-                   sizeof(m_z) +
-                   sizeof(m_velocity_x) +
-                   sizeof(m_velocity_y) +
-                   sizeof(m_velocity_z) +
-                   sizeof(m_yaw) +
-                   sizeof(m_pitch) +
-                   sizeof(m_relativeMask);
-        }
+        inline size_t Size() const override { return Schema::PayloadSize(*this); }
     private:
-        friend iu::Serializer<mc::server::SynchronisePlayerPosition>;
-
         util::varInt m_teleportID;
 
         double m_x;
@@ -330,164 +376,92 @@ namespace mc::server
         float m_pitch;
 
         int m_relativeMask;
+    public:
+        using Schema = schema::PacketSchema<PlayPacketID::SynchronisePlayerPosition,
+            schema::Field<schema::VarInt, &SynchronisePlayerPosition::m_teleportID>,
+            schema::Field<schema::Double, &SynchronisePlayerPosition::m_x>,
+            schema::Field<schema::Double, &SynchronisePlayerPosition::m_y>,
+            schema::Field<schema::Double, &SynchronisePlayerPosition::m_z>,
+            schema::Field<schema::Double, &SynchronisePlayerPosition::m_velocity_x>,
+            schema::Field<schema::Double, &SynchronisePlayerPosition::m_velocity_y>,
+            schema::Field<schema::Double, &SynchronisePlayerPosition::m_velocity_z>,
+            schema::Field<schema::Float, &SynchronisePlayerPosition::m_yaw>,
+            schema::Field<schema::Float, &SynchronisePlayerPosition::m_pitch>,
+            schema::Field<schema::Int, &SynchronisePlayerPosition::m_relativeMask>>;
     };
 
-} // namespace mc::server
-
-template<>
-struct iu::Serializer<mc::server::LoginSuccessPacket>
-{
-    void Serialize(std::vector<uint8_t>& buffer, const mc::server::LoginSuccessPacket& toSerialize)
-    {
-        using namespace mc::util;
-        Serializer<uuid> uuidSerializer;
-
-        writeVarInt(buffer, toSerialize.Size() + 1);
-        writeVarInt(buffer, toSerialize.GetId<int>());
-        uuidSerializer.Serialize(buffer, toSerialize.GetUUID());
-        writeStringToBuff(buffer, toSerialize.GetName());
-        writeVarInt(buffer, 0);
-    }
-};
-
-template<>
-struct iu::Serializer<mc::server::StatusPacket>
-{
-    void Serialize(std::vector<uint8_t>& buffer, const mc::server::StatusPacket& toSerialize)
-    {
-        using namespace mc::util;
-        writeVarInt(buffer, toSerialize.Size());
-        writeVarInt(buffer, toSerialize.GetId<int>());
-        writeStringToBuff(buffer, toSerialize.Json().dump());
-    }
-};
-
-template<>
-struct iu::Serializer<mc::server::FinishConfiguration>
-{
-    void Serialize(std::vector<uint8_t>& buffer, const mc::server::FinishConfiguration& toSerialize)
-    {
-        using namespace mc::util;
-        writeVarInt(buffer, toSerialize.Size());
-        writeVarInt(buffer, toSerialize.GetId<int>());
-    }
-};
-
-template<>
-struct iu::Serializer<mc::server::LoginPlayPacket>
-{
-    size_t GetSize(const mc::server::LoginPlayPacket& object) { return object.Size();}
-
-    void Serialize(std::vector<uint8_t>& buffer, const mc::server::LoginPlayPacket& toSerialize)
+    // Chunks are only rendered around this one, has to follow the player across chunk borders
+    class SetCenterChunk : public Packet
     {
-        using namespace mc::util;
-
-        IntSerializer intSerializer;
-        LongSerializer int64Serializer;
-        ByteSerializer byteSerialier;
-        BoolSerializer boolSerializer;
-        Serializer<mc::Identifier> identifierSerializer;
-        Serializer<mc::Position> positionSerializer;
-        Serializer<std::vector<mc::Identifier>> identifierVecSerializer;
-
-        writeVarInt(buffer, toSerialize.Size());
-        writeVarInt(buffer, toSerialize.GetId<int>());
-        intSerializer.Serialize(buffer, toSerialize.m_entityID);
-        boolSerializer.Serialize(buffer, toSerialize.m_isHardcore);
-        writeVarInt(buffer, toSerialize.m_dimensionIdentifiers.size());
-        identifierVecSerializer.Serialize(buffer, toSerialize.m_dimensionIdentifiers);
-        writeVarInt(buffer, toSerialize.m_maxPlayers);
-        writeVarInt(buffer, toSerialize.m_viewDistance);
-        writeVarInt(buffer, toSerialize.m_simulationDistance);
-        boolSerializer.Serialize(buffer, toSerialize.m_reducedDebugInfo);
-        boolSerializer.Serialize(buffer, toSerialize.m_enableRespawnScreen);
-        boolSerializer.Serialize(buffer, toSerialize.m_limitedCrafting);
-        writeVarInt(buffer, toSerialize.m_dimensionType);
-        identifierSerializer.Serialize(buffer, toSerialize.m_dimensionName);
-        int64Serializer.Serialize(buffer, toSerialize.m_seedHash);
-        byteSerialier.Serialize(buffer, toSerialize.m_gameMode);
-        byteSerialier.Serialize(buffer, toSerialize.m_previousGameMode);
-        boolSerializer.Serialize(buffer, toSerialize.m_isDebug);
-        boolSerializer.Serialize(buffer, toSerialize.m_isFlat);
-        boolSerializer.Serialize(buffer, toSerialize.m_deathDimension.has_value() && toSerialize.m_deathPosition.has_value());
-
-        if(toSerialize.m_deathDimension.has_value() && toSerialize.m_deathPosition.has_value())
-        {
-            identifierSerializer.Serialize(buffer, toSerialize.m_deathDimension.value().AsString());
-            positionSerializer.Serialize(buffer, toSerialize.m_deathPosition.value());
-        }
+    public:
+        SetCenterChunk(util::varInt x, util::varInt z);
+        ~SetCenterChunk() = default;
 
-        writeVarInt(buffer, toSerialize.m_portalCooldown);
-        writeVarInt(buffer, toSerialize.m_seaLevel);
-        boolSerializer.Serialize(buffer, toSerialize.m_enforceSecureChat);
-    }
-};
+        inline std::string AsString() const override { return std::format("{{ x: {}, z: {} }}", m_x, m_z); }
+        inline constexpr std::string PacketName() const override { return "SetCenterChunk"; }
+        inline size_t Size() const override { return Schema::PayloadSize(*this); }
+    private:
+        util::varInt m_x;
+        util::varInt m_z;
+    public:
+        using Schema = schema::PacketSchema<PlayPacketID::SetCenterChunk,
+            schema::Field<schema::VarInt, &SetCenterChunk::m_x>,
+            schema::Field<schema::VarInt, &SetCenterChunk::m_z>>;
+    };
 
-template<>
-struct iu::Serializer<mc::server::GameEvent>
-{
-    size_t GetSize(const mc::server::GameEvent& object)
+    // Unload Chunk, the client drops the chunk and everything in it
+    class ForgetLevelChunk : public Packet
     {
-        return object.Size();
-    }
+    public:
+        ForgetLevelChunk(std::int32_t x, std::int32_t z);
+        ~ForgetLevelChunk() = default;
 
-    void Serialize(std::vector<uint8_t>& buffer, const mc::server::GameEvent& toSerialize)
+        inline std::string AsString() const override { return std::format("{{ x: {}, z: {} }}", m_x, m_z); }
+        inline constexpr std::string PacketName() const override { return "ForgetLevelChunk"; }
+        inline size_t Size() const override { return Schema::PayloadSize(*this); }
+    private:
+        std::int32_t m_x;
+        std::int32_t m_z;
+    public:
+        // Z comes first
+        using Schema = schema::PacketSchema<PlayPacketID::ForgetLevelChunk,
+            schema::Field<schema::Int, &ForgetLevelChunk::m_z>,
+            schema::Field<schema::Int, &ForgetLevelChunk::m_x>>;
+    };
+
+    // Chunk packets up to the matching ChunkBatchFinished form one batch
+    class ChunkBatchStart : public Packet
     {
-        using namespace mc::util;
+    public:
+        ChunkBatchStart();
+        ~ChunkBatchStart() = default;
 
-        writeVarInt(buffer, GetSize(toSerialize));
-        writeVarInt(buffer, toSerialize.GetId<int>());
-        ByteSerializer().Serialize(buffer, (std::uint8_t)toSerialize.m_event);
-        FloatSerializer().Serialize(buffer, toSerialize.m_value);
-    }
-};
+        inline std::string AsString() const override { return "ChunkBatchStart"; }
+        inline constexpr std::string PacketName() const override { return "ChunkBatchStart"; }
+        inline size_t Size() const override { return Schema::PayloadSize(*this); }
 
+        using Schema = schema::PacketSchema<PlayPacketID::ChunkBatchStart>;
+    };
 
-template<>
-struct iu::Serializer<mc::server::SynchronisePlayerPosition>
-{
-    size_t GetSize(const mc::server::SynchronisePlayerPosition& object)
+    // The client measures how long batchSize chunks took and answers with client::ChunkBatchReceived
+    class ChunkBatchFinished : public Packet
     {
-        return object.Size();
-    }
+    public:
+        ChunkBatchFinished(util::varInt batchSize);
+        ~ChunkBatchFinished() = default;
 
-    void Serialize(std::vector<uint8_t>& buffer, const mc::server::SynchronisePlayerPosition& toSerialize)
-    {
-        using namespace mc::util;
-
-        writeVarInt(buffer, GetSize(toSerialize));
-        writeVarInt(buffer, toSerialize.GetId<mc::NBT::Int>());
-        writeVarInt(buffer, toSerialize.m_teleportID);
-        DoubleSerializer().Serialize(buffer, toSerialize.m_x);
-        DoubleSerializer().Serialize(buffer, toSerialize.m_y);
-        DoubleSerializer().Serialize(buffer, toSerialize.m_z);
-        DoubleSerializer().Serialize(buffer, toSerialize.m_velocity_x);
-        DoubleSerializer().Serialize(buffer, toSerialize.m_velocity_y);
-        DoubleSerializer().Serialize(buffer, toSerialize.m_velocity_z);
-        FloatSerializer().Serialize(buffer, toSerialize.m_yaw);
-        FloatSerializer().Serialize(buffer, toSerialize.m_pitch);
-        IntSerializer().Serialize(buffer, toSerialize.m_relativeMask);
-    }
-};
-
-template<>
-struct iu::Serializer<mc::server::KnownPacksPacket>
-{
-    void Serialize(std::vector<uint8_t>& buffer, const mc::server::KnownPacksPacket& toSerialize)
-    {
-        using namespace mc::util;
-        const int packetSize = 2 +
-                                  sizeOfString(toSerialize.m_namespace) +
-                                  sizeOfString(toSerialize.m_id) +
-                                  sizeOfString(toSerialize.m_version);
-
-        writeVarInt(buffer, packetSize);
-        writeVarInt(buffer, toSerialize.GetId<int>());
-        writeVarInt(buffer, 1);
-        writeStringToBuff(buffer, toSerialize.m_namespace);
-        writeStringToBuff(buffer, toSerialize.m_id);
-        writeStringToBuff(buffer, toSerialize.m_version);
-    }
-};
+        inline util::varInt GetBatchSize() const { return m_batchSize; }
+
+        inline std::string AsString() const override { return std::format("{{ batchSize: {} }}", m_batchSize); }
+        inline constexpr std::string PacketName() const override { return "ChunkBatchFinished"; }
+        inline size_t Size() const override { return Schema::PayloadSize(*this); }
+    private:
+        util::varInt m_batchSize;
+    public:
+        using Schema = schema::PacketSchema<PlayPacketID::ChunkBatchFinished,
+            schema::Field<schema::VarInt, &ChunkBatchFinished::m_batchSize>>;
+    };
+
+} // namespace mc::server
 
 #endif // SERVER_PACKETS_H
\ No newline at end of file
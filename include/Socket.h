@@ -0,0 +1,21 @@
+#ifndef SOCKET_H
+#define SOCKET_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+// Plain POSIX socket helpers shared by the reactor backends
+namespace mc::net
+{
+    // Bound, listening, non blocking TCP socket. Throws std::system_error
+    int openListenSocket(const std::string& address, std::uint16_t port);
+    void setNoDelay(int fd);
+    std::pair<std::string, int> peerAddress(int fd);
+    // Shuts down both directions of the socket of this process connected to address:port, so a
+    // thread blocked reading it wakes up. For transports that don't hand out their descriptor.
+    // False if no such socket is open
+    bool shutdownPeer(const std::string& address, int port);
+}
+
+#endif //SOCKET_H
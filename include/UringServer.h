@@ -0,0 +1,45 @@
+#ifndef URING_SERVER_H
+#define URING_SERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ServerContext.h"
+
+namespace mc
+{
+    class UringWorker;
+
+    // io_uring flavour of EpollServer. Every I/O thread owns a ring with a multishot accept
+    // on the shared listening socket and receives land in a provided buffer ring. Everything a
+    // connection queued, the prebuilt registry packets included, goes out with one sendmsg. Completions and new submissions are batched, one io_uring_enter per loop turn.
+    // Use IoUring::IsSupported first, EpollServer is the fallback
+    class UringServer
+    {
+    public:
+        constexpr static size_t DEFAULT_IO_THREADS = 4;
+
+        UringServer(std::string address, std::uint16_t port, size_t ioThreads = DEFAULT_IO_THREADS);
+        UringServer(const UringServer&) = delete;
+        UringServer& operator=(const UringServer&) = delete;
+        ~UringServer();
+
+        // Blocks until Stop is called, the calling thread serves as the first I/O thread
+        void Run();
+        void Stop();
+
+    private:
+        std::string m_address;
+        std::uint16_t m_port;
+        size_t m_ioThreads;
+        int m_listenSocket;
+        std::atomic_bool m_stop;
+        ServerContext m_context;
+        std::vector<std::unique_ptr<UringWorker>> m_workers;
+    };
+}
+
+#endif //URING_SERVER_H
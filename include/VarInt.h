@@ -0,0 +1,180 @@
+#ifndef VAR_INT_H
+#define VAR_INT_H
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+// VarInt and VarLong as the protocol uses them: 7 bits per byte, least significant group first,
+// the high bit set on every byte but the last. Negative numbers take the full 5 or 10 bytes.
+// On little endian machines a whole VarInt is decoded from one 64 bit word instead of a branch
+// per byte
+namespace mc::util
+{
+    constexpr inline size_t MAX_VARINT_SIZE  = 5;
+    constexpr inline size_t MAX_VARLONG_SIZE = 10;
+
+    constexpr size_t sizeOfVarInt(std::int32_t value) noexcept
+    {
+        return (std::bit_width(std::uint32_t(value) | 1) + 6) / 7;
+    }
+
+    constexpr size_t sizeOfVarLong(std::int64_t value) noexcept
+    {
+        return (std::bit_width(std::uint64_t(value) | 1) + 6) / 7;
+    }
+
+    // Writes exactly sizeOfVarInt(value) bytes to out, returns that size. A byte at a time, packing
+    // the groups into one word measured slower since its store has a variable length
+    inline size_t encodeVarInt(std::uint8_t* out, std::int32_t value) noexcept
+    {
+        std::uint32_t bits = value;
+        size_t size        = 0;
+        for (; bits >= 0x80; bits >>= 7)
+            out[size++] = std::uint8_t(bits) | 0x80;
+        out[size++] = std::uint8_t(bits);
+        return size;
+    }
+
+    inline size_t encodeVarLong(std::uint8_t* out, std::int64_t value) noexcept
+    {
+        std::uint64_t bits = value;
+        const size_t size  = sizeOfVarLong(value);
+        for (size_t i = 0; i + 1 < size; ++i, bits >>= 7)
+            out[i] = std::uint8_t(bits) | 0x80;
+        out[size - 1] = std::uint8_t(bits);
+        return size;
+    }
+
+    // Returns the bytes the VarInt took, 0 if data ends before it does.
+    // Throws std::runtime_error if it runs longer than 5 bytes
+    inline size_t decodeVarInt(std::span<const std::uint8_t> data, std::int32_t& value)
+    {
+        if constexpr (std::endian::native == std::endian::little)
+        {
+            if (data.size() >= sizeof(std::uint64_t))
+            {
+                std::uint64_t word;
+                std::memcpy(&word, data.data(), sizeof(word));
+
+                // The first byte of the 5 without a continuation bit ends it
+                const std::uint64_t ends = ~word & 0x8080808080ull;
+                if (ends == 0)
+                    throw std::runtime_error("VarInt too big");
+
+                const size_t size = (std::countr_zero(ends) >> 3) + 1;
+                word &= (std::uint64_t(1) << (8 * size)) - 1;
+                value = std::uint32_t((word & 0x7f) | (word & 0x7f00) >> 1 | (word & 0x7f0000) >> 2 |
+                    (word & 0x7f000000) >> 3 | (word & 0x7f00000000) >> 4);
+                return size;
+            }
+        }
+
+        std::uint32_t bits = 0;
+        for (size_t i = 0; i < MAX_VARINT_SIZE; ++i)
+        {
+            if (i >= data.size())
+                return 0;
+            bits |= std::uint32_t(data[i] & 0x7f) << (7 * i);
+            if ((data[i] & 0x80) == 0)
+            {
+                value = bits;
+                return i + 1;
+            }
+        }
+        throw std::runtime_error("VarInt too big");
+    }
+
+    // Same for VarLong, at most 10 bytes
+    inline size_t decodeVarLong(std::span<const std::uint8_t> data, std::int64_t& value)
+    {
+        std::uint64_t bits = 0;
+        for (size_t i = 0; i < MAX_VARLONG_SIZE; ++i)
+        {
+            if (i >= data.size())
+                return 0;
+            bits |= std::uint64_t(data[i] & 0x7f) << (7 * i);
+            if ((data[i] & 0x80) == 0)
+            {
+                value = bits;
+                return i + 1;
+            }
+        }
+        throw std::runtime_error("VarLong too big");
+    }
+
+    // Reads at position and moves it past the VarInt, throws std::runtime_error if data ends first
+    inline std::int32_t readVarInt(std::span<const std::uint8_t> data, size_t& position)
+    {
+        std::int32_t value = 0;
+        const size_t size  = position <= data.size() ? decodeVarInt(data.subspan(position), value) : 0;
+        if (size == 0)
+            throw std::runtime_error("Truncated VarInt");
+        position += size;
+        return value;
+    }
+
+    inline std::int64_t readVarLong(std::span<const std::uint8_t> data, size_t& position)
+    {
+        std::int64_t value = 0;
+        const size_t size  = position <= data.size() ? decodeVarLong(data.subspan(position), value) : 0;
+        if (size == 0)
+            throw std::runtime_error("Truncated VarLong");
+        position += size;
+        return value;
+    }
+
+    // Appended a byte at a time, growing the vector by the exact size first is slower
+    inline void writeVarInt(std::vector<std::uint8_t>& buffer, std::int32_t value)
+    {
+        std::uint32_t bits = value;
+        for (; bits >= 0x80; bits >>= 7)
+            buffer.push_back(std::uint8_t(bits) | 0x80);
+        buffer.push_back(std::uint8_t(bits));
+    }
+
+    inline void writeVarLong(std::vector<std::uint8_t>& buffer, std::int64_t value)
+    {
+        const size_t end = buffer.size();
+        buffer.resize(end + sizeOfVarLong(value));
+        encodeVarLong(buffer.data() + end, value);
+    }
+
+    // Inserts the VarInt at pos, everything after it moves once
+    inline void writeVarInt(std::vector<std::uint8_t>& buffer, size_t pos, std::int32_t value)
+    {
+        std::uint8_t bytes[MAX_VARINT_SIZE];
+        const size_t size = encodeVarInt(bytes, value);
+        buffer.insert(buffer.begin() + pos, bytes, bytes + size);
+    }
+
+    // Length prefix whose value is only known once the payload behind it is written:
+    //   const size_t prefix = reserveVarInt(buffer);
+    //   ...write the payload...
+    //   backfillVarInt(buffer, prefix);
+    // Room for the largest VarInt is reserved up front, the backfill writes the exact size and
+    // closes the gap with a single move of the payload
+    inline size_t reserveVarInt(std::vector<std::uint8_t>& buffer)
+    {
+        const size_t position = buffer.size();
+        buffer.resize(position + MAX_VARINT_SIZE);
+        return position;
+    }
+
+    // Writes the size of everything after the reserved bytes as the prefix
+    inline void backfillVarInt(std::vector<std::uint8_t>& buffer, size_t position)
+    {
+        const size_t payload = buffer.size() - position - MAX_VARINT_SIZE;
+        const size_t size    = sizeOfVarInt(payload);
+        const size_t gap     = MAX_VARINT_SIZE - size;
+
+        encodeVarInt(buffer.data() + position + gap, payload);
+        if (gap != 0)
+            buffer.erase(buffer.begin() + position, buffer.begin() + position + gap);
+    }
+}
+
+#endif //VAR_INT_H
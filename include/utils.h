@@ -5,6 +5,7 @@
 #include <SFW/LoggerManager.h>
 #include <concepts>
 #include <cstdint>
+#include <cstring>
 #include <nlohmann/json.hpp>
 
 #include <bits/iterator_concepts.h>
@@ -13,12 +14,15 @@
 #include <stdexcept>
 #include <ranges>
 #include <map>
+#include <span>
 #include <string_view>
 #include <iterator>
 #include <vector>
 #include <variant>
 #include <format>
 
+#include "VarInt.h"
+
 namespace mc
 {
 
@@ -28,6 +32,7 @@ namespace mc
         enum class StatusPacketID;
         enum class ConfigPacketID;
         enum class LoginPacketID;
+        enum class PlayPacketID;
     } // namespace server
 
     namespace client
@@ -54,7 +59,8 @@ namespace mc
             std::same_as<T, server::IdlePacketID> || std::same_as<T, client::StatusPacketID>   ||
             std::same_as<T, server::StatusPacketID> || std::same_as<T, client::LoginPacketID>  ||
             std::same_as<T, server::ConfigPacketID> || std::same_as<T, client::ConfigPacketID> ||
-            std::same_as<T, server::LoginPacketID> || std::same_as<T, client::PlayPacketID>;
+            std::same_as<T, server::LoginPacketID> || std::same_as<T, client::PlayPacketID> ||
+            std::same_as<T, server::PlayPacketID>;
 
         template<typename T>
         concept Numeric = std::integral<T> || std::floating_point<T>;
@@ -85,9 +91,7 @@ namespace mc
             uint8_t m_data[16];
         };
 
-        inline constexpr int sizeOfVarInt(const int i) { return (i < 127 ? 1 : (i / 127)); }
-
-        inline constexpr int sizeOfString(std::string_view s)
+        inline constexpr size_t sizeOfString(std::string_view s)
         {
             return sizeOfVarInt(s.size()) + s.size();
         }
@@ -95,12 +99,12 @@ namespace mc
         template<IteratorU8 Iter>
         int readVarInt(Iter& begin)
         {
-            int value        = 0;
+            uint32_t value   = 0;
             uint8_t position = 0;
 
             while(true)
             {
-                value |= (*begin & SEGMENT_BIT) << position;
+                value |= uint32_t(*begin & SEGMENT_BIT) << position;
 
                 if((*begin & CONTINUE_BIT) == 0)
                 {
@@ -131,12 +135,13 @@ namespace mc
             return out;
         }
 
-        void writeVarInt(std::vector<uint8_t>& buffer, int value);
-        void writeVarInt(std::vector<uint8_t>& buffer, size_t pos, int value);
         void writeStringToBuff(std::vector<uint8_t>& buffer, std::string_view str);
 
         void toLower(std::string& s);
 
+        // Throws std::system_error built from errno
+        [[noreturn]] void throwErrno(const char* what);
+
         
         template<std::integral T>
         constexpr T byteswap(T value) noexcept
@@ -147,6 +152,88 @@ namespace mc
             std::ranges::reverse(value_representation);
             return std::bit_cast<T>(value_representation);
         }
+
+        // Reverse the byte order of count 2, 4 or 8 byte values in place.
+        // Picks AVX2 or SSSE3 once at runtime when the cpu has them, plain bswap otherwise
+        void byteswap16(void* data, size_t count) noexcept;
+        void byteswap32(void* data, size_t count) noexcept;
+        void byteswap64(void* data, size_t count) noexcept;
+
+        template<std::integral T>
+        inline void byteswapArray(std::span<T> values) noexcept
+        {
+            if constexpr (sizeof(T) == 2)
+                byteswap16(values.data(), values.size());
+            else if constexpr (sizeof(T) == 4)
+                byteswap32(values.data(), values.size());
+            else if constexpr (sizeof(T) == 8)
+                byteswap64(values.data(), values.size());
+        }
+
+        // Same size unsigned integer, what a Numeric is byte swapped as
+        template<Numeric T>
+        using WordOf = std::conditional_t<sizeof(T) == 1, std::uint8_t,
+                       std::conditional_t<sizeof(T) == 2, std::uint16_t,
+                       std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>>>;
+
+        // Converts count values of T between native and big endian order in place
+        template<Numeric T>
+        inline void nativeToBigEndian(void* data, size_t count) noexcept
+        {
+            if constexpr (std::endian::native == std::endian::little && sizeof(T) > 1)
+            {
+                if constexpr (sizeof(T) == 2)
+                    byteswap16(data, count);
+                else if constexpr (sizeof(T) == 4)
+                    byteswap32(data, count);
+                else
+                    byteswap64(data, count);
+            }
+        }
+
+        template<Numeric T>
+        inline void storeBigEndian(std::uint8_t* out, T value) noexcept
+        {
+            auto word = std::bit_cast<WordOf<T>>(value);
+            if constexpr (std::endian::native == std::endian::little)
+                word = byteswap(word);
+            std::memcpy(out, &word, sizeof(T));
+        }
+
+        template<Numeric T>
+        inline T loadBigEndian(const std::uint8_t* data) noexcept
+        {
+            WordOf<T> word;
+            std::memcpy(&word, data, sizeof(T));
+            if constexpr (std::endian::native == std::endian::little)
+                word = byteswap(word);
+            return std::bit_cast<T>(word);
+        }
+
+        // Appends the whole range in big endian order, the buffer grows once and the bytes are
+        // swapped in one SIMD pass instead of pushed one at a time
+        template<Numeric T>
+        void writeBigEndian(std::vector<std::uint8_t>& buffer, std::span<const T> values)
+        {
+            if (values.empty())
+                return;
+            const size_t start = buffer.size();
+            buffer.resize(start + values.size_bytes());
+            std::memcpy(buffer.data() + start, values.data(), values.size_bytes());
+            nativeToBigEndian<T>(buffer.data() + start, values.size());
+        }
+
+        // Fills out from bytes holding out.size() big endian values
+        template<Numeric T>
+        void readBigEndian(std::span<const std::uint8_t> bytes, std::span<T> out)
+        {
+            if (bytes.size() != out.size_bytes())
+                throw std::out_of_range(std::format("{} bytes don't hold {} values of {} bytes", bytes.size(), out.size(), sizeof(T)));
+            if (out.empty())
+                return;
+            std::memcpy(out.data(), bytes.data(), bytes.size());
+            nativeToBigEndian<T>(out.data(), out.size());
+        }
     } // namespace util
 
 } // namespace mc
@@ -253,12 +340,28 @@ struct iu::Serializer<T>
 {
     void Serialize(std::vector<uint8_t>& buffer, T toSerialize)
     {
-        uint8_t* data = reinterpret_cast<uint8_t*>(&toSerialize);
-        constexpr size_t container_end = -1;
-        for(size_t i = sizeof(toSerialize) - 1; i != container_end; --i)
-        {
-            buffer.push_back(data[i]);
-        }
+        const size_t start = buffer.size();
+        buffer.resize(start + sizeof(T));
+        mc::util::storeBigEndian(buffer.data() + start, toSerialize);
+    }
+};
+
+// Contiguous numbers go out in bulk, see writeBigEndian
+template<iu::Serializable S> requires (mc::util::Numeric<S> && !std::same_as<S, bool>)
+struct iu::Serializer<std::vector<S>>
+{
+    void Serialize(std::vector<uint8_t>& buffer, const std::vector<S>& toSerialize)
+    {
+        mc::util::writeBigEndian(buffer, std::span<const S>(toSerialize));
+    }
+};
+
+template<mc::util::Numeric T, size_t Extent>
+struct iu::Serializer<std::span<const T, Extent>>
+{
+    void Serialize(std::vector<uint8_t>& buffer, std::span<const T, Extent> toSerialize)
+    {
+        mc::util::writeBigEndian(buffer, std::span<const T>(toSerialize));
     }
 };
 
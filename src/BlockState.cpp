@@ -0,0 +1,155 @@
+#include "BlockState.h"
+
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <stdexcept>
+
+#include "InternTable.h"
+
+namespace mc
+{
+    namespace
+    {
+        struct NoPayload {};
+
+        using NameTable  = util::InternTable<NoPayload>;
+        using ValueTable = util::InternTable<BlockState::PropertyValue>;
+
+        // Never destroyed so states stay usable while other statics shut down
+        NameTable& names()
+        {
+            static NameTable* instance = new NameTable();
+            return *instance;
+        }
+
+        ValueTable& values()
+        {
+            static ValueTable* instance = new ValueTable();
+            return *instance;
+        }
+
+        std::string valueText(const BlockState::PropertyValue& value)
+        {
+            if (const auto* text = std::get_if<std::string>(&value))
+                return *text;
+            if (const auto* flag = std::get_if<bool>(&value))
+                return *flag ? "true" : "false";
+            return std::to_string(std::get<int>(value));
+        }
+
+        // Inverse of valueText, the typed value is what ValueOf hands back
+        BlockState::PropertyValue parseValue(std::string_view text)
+        {
+            if (text == "true" || text == "false")
+                return text == "true";
+
+            int number = 0;
+            const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+            if (!text.empty() && error == std::errc() && end == text.data() + text.size())
+                return number;
+            return std::string(text);
+        }
+
+        std::uint16_t narrow(std::uint32_t handle)
+        {
+            if (handle > std::numeric_limits<std::uint16_t>::max())
+                throw std::length_error("Too many distinct block state properties");
+            return handle;
+        }
+    }
+
+    // ################
+    // # PropertyView #
+    // ################
+
+    BlockState::PropertyView::Iterator BlockState::PropertyView::find(std::string_view name) const noexcept
+    {
+        const auto id = FindName(name);
+        if (!id.has_value())
+            return end();
+
+        const auto property = std::ranges::find(m_properties, *id, &PackedProperty::name);
+        return m_properties.data() + (property - m_properties.begin());
+    }
+
+    bool BlockState::PropertyView::operator==(const PropertyView& other) const noexcept
+    {
+        return std::ranges::equal(m_properties, other.m_properties);
+    }
+
+    // ##############
+    // # BlockState #
+    // ##############
+
+    BlockState::BlockState()
+        : m_ID(),
+        m_size(0),
+        m_properties()
+    {}
+
+    BlockState::BlockState(Identifier blockIdentifier)
+        : m_ID(std::move(blockIdentifier)),
+        m_size(0),
+        m_properties()
+    {}
+
+    BlockState::BlockState(Identifier blockIdentifier, std::initializer_list<Property> properties)
+        : BlockState(std::move(blockIdentifier))
+    {
+        for (const auto& [name, value] : properties)
+            AddProperty(name, value);
+    }
+
+    void BlockState::AddProperty(std::string_view name, const PropertyValue& value)
+    {
+        AddProperty({ InternName(name), InternValue(value) });
+    }
+
+    void BlockState::AddProperty(PackedProperty property)
+    {
+        // Sorted by name id so equal states hold equal arrays
+        size_t position = 0;
+        while (position < m_size && m_properties[position].name < property.name)
+            ++position;
+        if (position < m_size && m_properties[position].name == property.name)
+            return;
+
+        if (m_size == MAX_PROPERTIES)
+            throw std::length_error(std::format("{} has more than {} properties", m_ID, MAX_PROPERTIES));
+
+        std::move_backward(m_properties.begin() + position, m_properties.begin() + m_size, m_properties.begin() + m_size + 1);
+        m_properties[position] = property;
+        ++m_size;
+    }
+
+    std::uint16_t BlockState::InternName(std::string_view name)
+    {
+        return narrow(names().Intern(name, [](std::string_view) { return NoPayload{}; }));
+    }
+
+    std::uint16_t BlockState::InternValue(const PropertyValue& value)
+    {
+        return narrow(values().Intern(valueText(value), parseValue));
+    }
+
+    std::optional<std::uint16_t> BlockState::FindName(std::string_view name) noexcept
+    {
+        return names().Find(name);
+    }
+
+    std::optional<std::uint16_t> BlockState::FindValue(const PropertyValue& value)
+    {
+        return values().Find(valueText(value));
+    }
+
+    std::string_view BlockState::NameOf(std::uint16_t name) noexcept
+    {
+        return names().Get(name).text;
+    }
+
+    const BlockState::PropertyValue& BlockState::ValueOf(std::uint16_t value) noexcept
+    {
+        return values().Get(value).payload;
+    }
+}
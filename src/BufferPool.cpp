@@ -0,0 +1,102 @@
+#include "BufferPool.h"
+
+#include <array>
+#include <bit>
+
+namespace mc::pool
+{
+    namespace
+    {
+        constexpr size_t MIN_CLASS_SHIFT = std::countr_zero(MIN_CLASS_SIZE);
+        constexpr size_t CLASS_COUNT     = std::countr_zero(MAX_CLASS_SIZE) - MIN_CLASS_SHIFT + 1;
+
+        struct Cache
+        {
+            std::array<std::vector<std::vector<std::uint8_t>>, CLASS_COUNT> free;
+            Stats stats;
+        };
+
+        Cache& cache() noexcept
+        {
+            thread_local Cache cache{};
+            return cache;
+        }
+
+        constexpr size_t classSize(size_t index)
+        {
+            return MIN_CLASS_SIZE << index;
+        }
+
+        // Smallest class that fits capacity
+        constexpr size_t classFor(size_t capacity)
+        {
+            if (capacity <= MIN_CLASS_SIZE)
+                return 0;
+            return std::bit_width(capacity - 1) - MIN_CLASS_SHIFT;
+        }
+
+        // Largest class a buffer of that capacity can serve
+        constexpr size_t classOf(size_t capacity)
+        {
+            return std::bit_width(capacity) - 1 - MIN_CLASS_SHIFT;
+        }
+    }
+
+    std::vector<std::uint8_t> acquire(size_t capacity)
+    {
+        Cache& local = cache();
+        std::vector<std::uint8_t> buffer;
+        if (capacity > MAX_CLASS_SIZE)
+        {
+            ++local.stats.misses;
+            buffer.reserve(capacity);
+            return buffer;
+        }
+
+        const size_t index = classFor(capacity);
+        auto& list = local.free[index];
+        if (list.empty())
+        {
+            ++local.stats.misses;
+            buffer.reserve(classSize(index));
+            return buffer;
+        }
+
+        ++local.stats.hits;
+        buffer = std::move(list.back());
+        list.pop_back();
+        local.stats.cachedBytes -= buffer.capacity();
+        return buffer;
+    }
+
+    void release(std::vector<std::uint8_t>&& buffer) noexcept
+    {
+        const size_t capacity = buffer.capacity();
+        if (capacity < MIN_CLASS_SIZE || capacity > MAX_CLASS_SIZE)
+            return;
+
+        Cache& local = cache();
+        auto& list = local.free[classOf(capacity)];
+        if (list.size() >= MAX_PER_CLASS || local.stats.cachedBytes + capacity > MAX_CACHED_BYTES)
+            return;
+
+        // The list keeps MAX_PER_CLASS slots once it got there, push_back can't throw after that
+        // and before that a failed allocation only means the buffer is freed
+        try
+        {
+            if (list.capacity() == 0)
+                list.reserve(MAX_PER_CLASS);
+            buffer.clear();
+            list.push_back(std::move(buffer));
+            local.stats.cachedBytes += capacity;
+        }
+        catch (...)
+        {
+        }
+    }
+
+    Stats stats() noexcept
+    {
+        return cache().stats;
+    }
+}
@@ -0,0 +1,51 @@
+#include "ChunkBatcher.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mc
+{
+    ChunkBatcher::ChunkBatcher(Clock::time_point now)
+        : m_chunksPerTick(INITIAL_CHUNKS_PER_TICK),
+        m_tokens(INITIAL_CHUNKS_PER_TICK),
+        m_lastRefill(now),
+        m_unacknowledged(0),
+        m_maxUnacknowledged(1)
+    {
+    }
+
+    size_t ChunkBatcher::Available(Clock::time_point now)
+    {
+        const float elapsed = std::chrono::duration_cast<Ticks>(now - m_lastRefill).count();
+        if (elapsed > 0)
+        {
+            m_tokens     = std::min(m_tokens + elapsed * m_chunksPerTick, Capacity());
+            m_lastRefill = now;
+        }
+
+        if (m_unacknowledged >= m_maxUnacknowledged || m_tokens < 1)
+            return 0;
+        return size_t(m_tokens);
+    }
+
+    void ChunkBatcher::OnBatchSent(size_t count)
+    {
+        m_tokens = std::max(m_tokens - float(count), 0.0f);
+        ++m_unacknowledged;
+    }
+
+    void ChunkBatcher::OnBatchReceived(float chunksPerTick)
+    {
+        m_chunksPerTick = std::isnan(chunksPerTick) ? MIN_CHUNKS_PER_TICK
+            : std::clamp(chunksPerTick, MIN_CHUNKS_PER_TICK, MAX_CHUNKS_PER_TICK);
+        m_tokens = std::min(m_tokens, Capacity());
+
+        if (m_unacknowledged > 0)
+            --m_unacknowledged;
+        // Caught up, a client asking for almost nothing still gets a chunk at a time
+        if (m_unacknowledged == 0)
+            m_tokens = std::max(m_tokens, 1.0f);
+        // The client showed it answers, let more batches be in flight
+        m_maxUnacknowledged = MAX_UNACKNOWLEDGED;
+    }
+}
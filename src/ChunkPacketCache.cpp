@@ -0,0 +1,121 @@
+#include "ChunkPacketCache.h"
+
+#include <SFW/LoggerManager.h>
+#include <algorithm>
+#include <mutex>
+
+#include "Compression.h"
+
+namespace mc
+{
+    ChunkPacketCache::ChunkPacketCache(RegionManager& regions, const ChunkPacketEncoder& encoder, size_t capacity)
+        : m_regions(regions),
+        m_encoder(encoder),
+        m_shardCapacity(std::max<size_t>((capacity + SHARD_COUNT - 1) / SHARD_COUNT, 1)),
+        m_shards()
+    {
+    }
+
+    ChunkPacketCache::Entry ChunkPacketCache::Get(int x, int z)
+    {
+        const std::uint64_t key = Key(x, z);
+        Shard& shard = ShardOf(key);
+        std::uint64_t generation = 0;
+        {
+            std::lock_guard lock(shard.mutex);
+            if (const auto it = shard.entries.find(key); it != shard.entries.end())
+            {
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                return it->second->second;
+            }
+            generation = shard.generation;
+        }
+
+        // Encoded without holding the lock, if two threads race the first one to insert wins
+        Entry entry = Encode(x, z);
+        if (entry == nullptr)
+            return nullptr;
+
+        std::lock_guard lock(shard.mutex);
+        if (const auto it = shard.entries.find(key); it != shard.entries.end())
+            return it->second->second;
+        // Invalidated while encoding, it may be built from the chunk as it was before
+        if (shard.generation != generation)
+            return entry;
+
+        shard.lru.emplace_front(key, entry);
+        shard.entries.emplace(key, shard.lru.begin());
+        while (shard.lru.size() > m_shardCapacity)
+        {
+            shard.entries.erase(shard.lru.back().first);
+            shard.lru.pop_back();
+        }
+        return entry;
+    }
+
+    void ChunkPacketCache::Invalidate(int x, int z)
+    {
+        // Evicted first, an encode that reads the generation after the bump gets the new chunk
+        m_regions.Evict(x, z);
+
+        const std::uint64_t key = Key(x, z);
+        Shard& shard = ShardOf(key);
+        std::lock_guard lock(shard.mutex);
+        ++shard.generation;
+        if (const auto it = shard.entries.find(key); it != shard.entries.end())
+        {
+            shard.lru.erase(it->second);
+            shard.entries.erase(it);
+        }
+    }
+
+    void ChunkPacketCache::Clear()
+    {
+        for (Shard& shard : m_shards)
+        {
+            std::lock_guard lock(shard.mutex);
+            ++shard.generation;
+            shard.entries.clear();
+            shard.lru.clear();
+        }
+    }
+
+    size_t ChunkPacketCache::Size() const
+    {
+        size_t count = 0;
+        for (Shard& shard : m_shards)
+        {
+            std::lock_guard lock(shard.mutex);
+            count += shard.lru.size();
+        }
+        return count;
+    }
+
+    //Private
+
+    ChunkPacketCache::Entry ChunkPacketCache::Encode(int x, int z) const
+    {
+        const auto chunk = m_regions.GetChunk(x, z);
+        if (chunk == nullptr)
+            return nullptr;
+
+        auto entry   = std::make_shared<EncodedChunk>();
+        entry->x     = x;
+        entry->z     = z;
+        // Chunk fields are only decoded here, a malformed or not fully generated chunk shows up now
+        try
+        {
+            entry->frame = m_encoder.Encode(x, z, *chunk);
+        }
+        catch (const std::exception& e)
+        {
+            SFW_LOG_WARN("ChunkPacketCache", "Can't encode chunk {} {}: {}", x, z, e.what());
+            return nullptr;
+        }
+        if (compression::enabled())
+            entry->compressed = compression::compressFrames(entry->frame);
+
+        SFW_LOG_DEBUG("ChunkPacketCache", "Encoded chunk {} {}, {} bytes", x, z, entry->frame.size());
+        return entry;
+    }
+}
@@ -0,0 +1,328 @@
+#include "ChunkPacketEncoder.h"
+
+#include <SFW/LoggerManager.h>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+#include "BufferPool.h"
+#include "VarInt.h"
+#include "generated/Registries.h"
+#include "utils.h"
+
+namespace mc
+{
+    namespace
+    {
+        struct HeightmapType
+        {
+            std::string_view name;
+            int type;
+        };
+
+        // The ones the client uses, with their Heightmap.Types ordinal
+        constexpr std::array<HeightmapType, 3> HEIGHTMAP_TYPES = { {
+            { "WORLD_SURFACE", 1 },
+            { "MOTION_BLOCKING", 4 },
+            { "MOTION_BLOCKING_NO_LEAVES", 5 },
+        } };
+
+        // Biome palettes never use fewer than 4 bits once they are direct
+        constexpr unsigned MIN_BIOME_DIRECT_BITS = 4;
+
+        size_t containerSize(const PalettedContainer& container)
+        {
+            size_t size = 1 + container.Data().size_bytes();
+            if (container.IsSingleValue())
+                return size + util::sizeOfVarInt(container.Palette().front());
+
+            if (!container.IsDirect())
+            {
+                size += util::sizeOfVarInt(container.Palette().size());
+                for (const int id : container.Palette())
+                    size += util::sizeOfVarInt(id);
+            }
+            return size;
+        }
+
+        inline size_t bitSetSize(std::uint64_t mask)
+        {
+            return mask == 0 ? 1 : 1 + sizeof(std::uint64_t);
+        }
+
+        inline std::uint8_t* writeVarInt(std::uint8_t* out, std::int32_t value)
+        {
+            return out + util::encodeVarInt(out, value);
+        }
+
+        template<util::Numeric T>
+        inline std::uint8_t* writeBigEndian(std::uint8_t* out, T value)
+        {
+            util::storeBigEndian(out, value);
+            return out + sizeof(T);
+        }
+
+        inline std::uint8_t* writeBytes(std::uint8_t* out, std::span<const std::uint8_t> bytes)
+        {
+            std::memcpy(out, bytes.data(), bytes.size());
+            return out + bytes.size();
+        }
+
+        // Bits per entry, the palette and the longs, which since 1.21.5 carry no length
+        std::uint8_t* writeContainer(std::uint8_t* out, const PalettedContainer& container)
+        {
+            *out++ = std::uint8_t(container.Bits());
+            if (container.IsSingleValue())
+                return writeVarInt(out, container.Palette().front());
+
+            if (!container.IsDirect())
+            {
+                out = writeVarInt(out, container.Palette().size());
+                for (const int id : container.Palette())
+                    out = writeVarInt(out, id);
+            }
+
+            const auto data = container.Data();
+            std::memcpy(out, data.data(), data.size_bytes());
+            util::nativeToBigEndian<std::uint64_t>(out, data.size());
+            return out + data.size_bytes();
+        }
+
+        // A BitSet on the wire is its longs with a length, no long at all when it is empty
+        std::uint8_t* writeBitSet(std::uint8_t* out, std::uint64_t mask)
+        {
+            if (mask == 0)
+                return writeVarInt(out, 0);
+            out = writeVarInt(out, 1);
+            return writeBigEndian(out, mask);
+        }
+
+        std::span<const std::uint8_t> lightArray(const NBT::LazyTag& tag)
+        {
+            const auto bytes = tag.Get<NBT::ByteArray>();
+            if (bytes.size() != ChunkPacketEncoder::LIGHT_ARRAY_SIZE)
+                throw std::runtime_error(std::format("Light array of {} bytes", bytes.size()));
+            return { reinterpret_cast<const std::uint8_t*>(bytes.data()), bytes.size() };
+        }
+    }
+
+    ChunkPacketEncoder::ChunkPacketEncoder(const BlockStateRegistry& blocks)
+        : m_blocks(blocks),
+        m_air(blocks.GetDefaultStateId(Identifier("air")).value_or(0)),
+        m_blockBits(PalettedContainer::BitsFor(blocks.StateCount())),
+        m_biomeBits(MIN_BIOME_DIRECT_BITS),
+        m_biomes(),
+        m_blockEntityTypes()
+    {
+        const auto& names = generated::registries::block_entity_type::NAMES;
+        for (size_t id = 0; id < names.size(); ++id)
+        {
+            if (!names[id].empty())
+                m_blockEntityTypes.emplace(Identifier(names[id]), int(id));
+        }
+    }
+
+    void ChunkPacketEncoder::SetBiomes(std::span<const Identifier> biomes)
+    {
+        m_biomes.clear();
+        for (size_t id = 0; id < biomes.size(); ++id)
+            m_biomes.emplace(biomes[id], int(id));
+        m_biomeBits = std::max(PalettedContainer::BitsFor(biomes.size()), MIN_BIOME_DIRECT_BITS);
+    }
+
+    std::vector<std::uint8_t> ChunkPacketEncoder::Encode(int x, int z, const NBT::LazyDocument& chunk) const
+    {
+        const auto sectionTags = chunk.Find("sections");
+        if (!sectionTags.has_value() || sectionTags->Type() != NBT::TagType::LIST)
+            throw std::runtime_error("Chunk has no sections");
+
+        // Sections the chunk doesn't store are air
+        std::vector<Section> sections;
+        sections.reserve(SECTION_COUNT);
+        for (int i = 0; i < SECTION_COUNT; ++i)
+            sections.push_back({ PalettedContainer::BlockStates(m_blockBits, m_air), PalettedContainer::Biomes(m_biomeBits, 0), 0 });
+
+        // Light reaches one section past the world on both ends, sections without an array are left
+        // out of both masks so the client keeps computing them
+        std::array<std::span<const std::uint8_t>, SECTION_COUNT + 2> skyLight{};
+        std::array<std::span<const std::uint8_t>, SECTION_COUNT + 2> blockLight{};
+        for (const NBT::LazyTag& tag : sectionTags->Children())
+        {
+            const auto y = tag.Find("Y");
+            if (!y.has_value())
+                throw std::runtime_error("Section without Y");
+            const int light = y->Get<NBT::Byte>() - MIN_SECTION + 1;
+            if (light < 0 || light >= SECTION_COUNT + 2)
+                continue;
+
+            if (const auto sky = tag.Find("SkyLight"); sky.has_value())
+                skyLight[light] = lightArray(*sky);
+            if (const auto block = tag.Find("BlockLight"); block.has_value())
+                blockLight[light] = lightArray(*block);
+            if (light >= 1 && light <= SECTION_COUNT)
+                sections[light - 1] = ReadSection(tag);
+        }
+
+        std::array<Heightmap, HEIGHTMAP_TYPES.size()> heightmaps;
+        size_t heightmapCount = 0;
+        for (const auto& [name, type] : HEIGHTMAP_TYPES)
+        {
+            if (const auto tag = chunk.Find(std::format("Heightmaps/{}", name)); tag.has_value())
+                heightmaps[heightmapCount++] = { type, tag->RawArray() };
+        }
+
+        const std::vector<BlockEntity> blockEntities = ReadBlockEntities(chunk);
+
+        // Light arrays that are all 0 only get a bit in the empty mask
+        const auto lightOf = [](std::span<const std::span<const std::uint8_t>> arrays)
+        {
+            Light light{ 0, 0, {} };
+            for (size_t i = 0; i < arrays.size(); ++i)
+            {
+                if (arrays[i].empty())
+                    continue;
+                if (std::ranges::all_of(arrays[i], [](std::uint8_t level) { return level == 0; }))
+                    light.emptyMask |= std::uint64_t(1) << i;
+                else
+                {
+                    light.mask |= std::uint64_t(1) << i;
+                    light.arrays.push_back(arrays[i]);
+                }
+            }
+            return light;
+        };
+        const Light sky   = lightOf(skyLight);
+        const Light block = lightOf(blockLight);
+
+        // ###########
+        // # Measure #
+        // ###########
+
+        size_t sectionsSize = 0;
+        for (const Section& section : sections)
+            sectionsSize += sizeof(std::int16_t) + containerSize(section.blocks) + containerSize(section.biomes);
+
+        size_t payload = util::sizeOfVarInt(CHUNK_DATA_ID) + 2 * sizeof(std::int32_t);
+        payload += util::sizeOfVarInt(heightmapCount);
+        for (const Heightmap& heightmap : std::span(heightmaps).first(heightmapCount))
+            payload += util::sizeOfVarInt(heightmap.type) + util::sizeOfVarInt(heightmap.data.size() / sizeof(std::int64_t)) + heightmap.data.size();
+        payload += util::sizeOfVarInt(sectionsSize) + sectionsSize;
+
+        payload += util::sizeOfVarInt(blockEntities.size());
+        for (const BlockEntity& entity : blockEntities)
+            payload += 1 + sizeof(std::int16_t) + util::sizeOfVarInt(entity.type) + 1 + entity.nbt.size();
+
+        payload += bitSetSize(sky.mask) + bitSetSize(block.mask) + bitSetSize(sky.emptyMask) + bitSetSize(block.emptyMask);
+        for (const Light* light : { &sky, &block })
+            payload += util::sizeOfVarInt(light->arrays.size()) + light->arrays.size() * (util::sizeOfVarInt(LIGHT_ARRAY_SIZE) + LIGHT_ARRAY_SIZE);
+
+        // #########
+        // # Write #
+        // #########
+
+        const size_t frameSize = util::sizeOfVarInt(payload) + payload;
+        auto frame = pool::acquire(frameSize);
+        frame.resize(frameSize);
+
+        std::uint8_t* out = frame.data();
+        out = writeVarInt(out, payload);
+        out = writeVarInt(out, CHUNK_DATA_ID);
+        out = writeBigEndian<std::int32_t>(out, x);
+        out = writeBigEndian<std::int32_t>(out, z);
+
+        out = writeVarInt(out, heightmapCount);
+        for (const Heightmap& heightmap : std::span(heightmaps).first(heightmapCount))
+        {
+            out = writeVarInt(out, heightmap.type);
+            out = writeVarInt(out, heightmap.data.size() / sizeof(std::int64_t));
+            out = writeBytes(out, heightmap.data);
+        }
+
+        out = writeVarInt(out, sectionsSize);
+        for (const Section& section : sections)
+        {
+            out = writeBigEndian<std::int16_t>(out, section.nonAir);
+            out = writeContainer(out, section.blocks);
+            out = writeContainer(out, section.biomes);
+        }
+
+        out = writeVarInt(out, blockEntities.size());
+        for (const BlockEntity& entity : blockEntities)
+        {
+            *out++ = entity.packedXZ;
+            out = writeBigEndian(out, entity.y);
+            out = writeVarInt(out, entity.type);
+            // Network NBT, a compound without a name
+            *out++ = std::uint8_t(NBT::TagType::COMPOUND);
+            out = writeBytes(out, entity.nbt);
+        }
+
+        out = writeBitSet(out, sky.mask);
+        out = writeBitSet(out, block.mask);
+        out = writeBitSet(out, sky.emptyMask);
+        out = writeBitSet(out, block.emptyMask);
+        for (const Light* light : { &sky, &block })
+        {
+            out = writeVarInt(out, light->arrays.size());
+            for (const auto array : light->arrays)
+            {
+                out = writeVarInt(out, LIGHT_ARRAY_SIZE);
+                out = writeBytes(out, array);
+            }
+        }
+        return frame;
+    }
+
+    //Private
+
+    ChunkPacketEncoder::Section ChunkPacketEncoder::ReadSection(const NBT::LazyTag& tag) const
+    {
+        Section section{ PalettedContainer::BlockStates(m_blockBits, m_air), PalettedContainer::Biomes(m_biomeBits, 0), 0 };
+        if (const auto blocks = tag.Find("block_states"); blocks.has_value())
+            section.blocks = PalettedContainer::LoadBlockStates(*blocks, m_blocks);
+        if (const auto biomes = tag.Find("biomes"); biomes.has_value())
+        {
+            section.biomes = PalettedContainer::LoadBiomes(*biomes, m_biomeBits, [this](std::string_view name) -> std::optional<int>
+            {
+                const auto it = m_biomes.find(Identifier(name));
+                return it == m_biomes.end() ? std::nullopt : std::optional<int>(it->second);
+            });
+        }
+
+        // Uniform sections are answered from their one palette entry without touching any data
+        section.nonAir = section.blocks.CountIf([this](int id) { return !m_blocks.IsAir(id); });
+        return section;
+    }
+
+    std::vector<ChunkPacketEncoder::BlockEntity> ChunkPacketEncoder::ReadBlockEntities(const NBT::LazyDocument& chunk) const
+    {
+        std::vector<BlockEntity> out;
+        const auto list = chunk.Find("block_entities");
+        if (!list.has_value() || list->Type() != NBT::TagType::LIST || list->ElementType() != NBT::TagType::COMPOUND)
+            return out;
+
+        for (const NBT::LazyTag& entity : list->Children())
+        {
+            const auto id = entity.Find("id");
+            const auto x  = entity.Find("x");
+            const auto y  = entity.Find("y");
+            const auto z  = entity.Find("z");
+            if (!id.has_value() || !x.has_value() || !y.has_value() || !z.has_value())
+                throw std::runtime_error("Block entity without id or position");
+
+            const auto type = m_blockEntityTypes.find(Identifier(id->Get<NBT::String>()));
+            if (type == m_blockEntityTypes.end())
+            {
+                SFW_LOG_DEBUG("ChunkPacketEncoder", "Skipping block entity of unknown type {}", id->Get<NBT::String>());
+                continue;
+            }
+
+            const std::uint8_t packedXZ = std::uint8_t((x->Get<NBT::Int>() & 15) << 4 | (z->Get<NBT::Int>() & 15));
+            out.push_back({ packedXZ, std::int16_t(y->Get<NBT::Int>()), type->second, entity.Raw() });
+        }
+        return out;
+    }
+}
@@ -0,0 +1,111 @@
+#include "ChunkView.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+
+namespace mc
+{
+    namespace
+    {
+        inline std::uint64_t key(ChunkPos chunk)
+        {
+            return (std::uint64_t(std::uint32_t(chunk.x)) << 32) | std::uint32_t(chunk.z);
+        }
+
+        // Every chunk of from that isn't in other. Rows outside of other are walked whole, the rows
+        // they share only left and right of it, so it costs the size of the difference
+        template<typename Square, typename Callback>
+        void forEachOutside(const Square& from, const Square& other, Callback&& callback)
+        {
+            for (int z = from.minZ; z <= from.maxZ; ++z)
+            {
+                if (z < other.minZ || z > other.maxZ)
+                {
+                    for (int x = from.minX; x <= from.maxX; ++x)
+                        callback(ChunkPos{x, z});
+                    continue;
+                }
+                for (int x = from.minX; x <= std::min(from.maxX, other.minX - 1); ++x)
+                    callback(ChunkPos{x, z});
+                for (int x = std::max(from.minX, other.maxX + 1); x <= from.maxX; ++x)
+                    callback(ChunkPos{x, z});
+            }
+        }
+    }
+
+    ChunkView::ChunkView(int viewDistance)
+        : m_viewDistance(viewDistance),
+        m_centered(false),
+        m_center{0, 0},
+        m_pending()
+    {
+    }
+
+    std::vector<ChunkPos> ChunkView::Move(ChunkPos center)
+    {
+        std::vector<ChunkPos> unload;
+        if (m_centered && center == m_center)
+            return unload;
+
+        // Nothing is in range before the first move
+        const Square before = m_centered ? SquareAround(m_center) : Square{0, 0, -1, -1};
+        const Square after  = SquareAround(center);
+
+        // Never sent, the client doesn't know about them
+        std::vector<std::uint64_t> dropped;
+        std::erase_if(m_pending, [&](ChunkPos chunk)
+        {
+            if (after.Contains(chunk))
+                return false;
+            dropped.push_back(key(chunk));
+            return true;
+        });
+        std::ranges::sort(dropped);
+
+        forEachOutside(before, after, [&](ChunkPos chunk)
+        {
+            if (!std::ranges::binary_search(dropped, key(chunk)))
+                unload.push_back(chunk);
+        });
+        forEachOutside(after, before, [&](ChunkPos chunk) { m_pending.push_back(chunk); });
+
+        m_center   = center;
+        m_centered = true;
+        std::ranges::sort(m_pending, std::greater{}, [this](ChunkPos chunk) { return Distance(chunk); });
+        return unload;
+    }
+
+    std::optional<ChunkPos> ChunkView::Next()
+    {
+        if (m_pending.empty())
+            return std::nullopt;
+        const ChunkPos chunk = m_pending.back();
+        m_pending.pop_back();
+        return chunk;
+    }
+
+    bool ChunkView::Contains(ChunkPos chunk) const noexcept
+    {
+        return m_centered && SquareAround(m_center).Contains(chunk);
+    }
+
+    //Private
+
+    ChunkView::Square ChunkView::SquareAround(ChunkPos center) const noexcept
+    {
+        return {
+            center.x - m_viewDistance,
+            center.z - m_viewDistance,
+            center.x + m_viewDistance,
+            center.z + m_viewDistance
+        };
+    }
+
+    std::uint64_t ChunkView::Distance(ChunkPos chunk) const noexcept
+    {
+        const std::uint64_t dx = std::abs(chunk.x - m_center.x);
+        const std::uint64_t dz = std::abs(chunk.z - m_center.z);
+        return std::max(dx, dz) << 32 | (dx * dx + dz * dz);
+    }
+}
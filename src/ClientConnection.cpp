@@ -0,0 +1,38 @@
+#include "ClientConnection.h"
+
+namespace mc
+{
+    void SFWClientConnection::Send(const std::vector<std::uint8_t>& data)
+    {
+        if (m_corks > 0)
+            m_corked.insert(m_corked.end(), data.begin(), data.end());
+        else
+            m_connection.Send(data);
+    }
+
+    void SFWClientConnection::Send(std::vector<std::uint8_t>&& data)
+    {
+        if (m_corks > 0 && m_corked.empty())
+            m_corked = std::move(data);
+        else
+        {
+            Send(static_cast<const std::vector<std::uint8_t>&>(data));
+            pool::release(std::move(data));
+        }
+    }
+
+    void SFWClientConnection::Cork()
+    {
+        ++m_corks;
+    }
+
+    // SFW writes every Send on its own, so a step worth of frames goes out as one buffer
+    void SFWClientConnection::Uncork()
+    {
+        if (m_corks == 0 || --m_corks > 0 || m_corked.empty())
+            return;
+
+        m_connection.Send(m_corked);
+        m_corked.clear();
+    }
+}
@@ -0,0 +1,195 @@
+#include "Compression.h"
+
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+#include <zlib.h>
+
+#include "BufferPool.h"
+#include "utils.h"
+
+namespace mc::compression
+{
+    namespace
+    {
+        int s_threshold = DEFAULT_THRESHOLD;
+        int s_level     = DEFAULT_LEVEL;
+
+        // One of each per thread, reset instead of reallocated for every packet
+        struct Deflater
+        {
+            z_stream stream;
+            int level;
+            // deflate output, reused between packets
+            std::vector<std::uint8_t> buffer;
+
+            Deflater() : stream(), level(compression::level()), buffer()
+            {
+                if (deflateInit(&stream, level) != Z_OK)
+                    throw std::runtime_error("deflateInit failed");
+            }
+            ~Deflater() { deflateEnd(&stream); }
+        };
+
+        // Window bits of a stream that may carry either a zlib or a gzip header
+        constexpr int AUTO_DETECT_WINDOW = 15 + 32;
+
+        struct Inflater
+        {
+            z_stream stream;
+
+            Inflater(int windowBits = MAX_WBITS) : stream()
+            {
+                if (inflateInit2(&stream, windowBits) != Z_OK)
+                    throw std::runtime_error("inflateInit failed");
+            }
+            ~Inflater() { inflateEnd(&stream); }
+        };
+
+        Deflater& threadDeflater()
+        {
+            thread_local Deflater deflater;
+            deflateReset(&deflater.stream);
+            // Only takes effect right away on a stream that has not produced anything yet
+            if (deflater.level != s_level)
+            {
+                if (deflateParams(&deflater.stream, s_level, Z_DEFAULT_STRATEGY) != Z_OK)
+                    throw std::runtime_error("deflateParams failed");
+                deflater.level = s_level;
+            }
+            return deflater;
+        }
+
+        Inflater& threadInflater()
+        {
+            thread_local Inflater inflater;
+            inflateReset(&inflater.stream);
+            return inflater;
+        }
+
+        Inflater& threadStreamInflater()
+        {
+            thread_local Inflater inflater(AUTO_DETECT_WINDOW);
+            inflateReset(&inflater.stream);
+            return inflater;
+        }
+
+        std::span<const std::uint8_t> deflate(std::span<const std::uint8_t> data)
+        {
+            Deflater& deflater = threadDeflater();
+            deflater.buffer.resize(deflateBound(&deflater.stream, data.size()));
+
+            deflater.stream.next_in   = const_cast<Bytef*>(data.data());
+            deflater.stream.avail_in  = data.size();
+            deflater.stream.next_out  = deflater.buffer.data();
+            deflater.stream.avail_out = deflater.buffer.size();
+
+            // The output is sized with deflateBound so a single call always finishes
+            if (::deflate(&deflater.stream, Z_FINISH) != Z_STREAM_END)
+                throw std::runtime_error("deflate failed");
+            return { deflater.buffer.data(), deflater.stream.total_out };
+        }
+    }
+
+    void configure(int threshold, int level)
+    {
+        if (threshold < DISABLED)
+            throw std::out_of_range(std::format("Compression threshold {} is below {}", threshold, DISABLED));
+        // zlib takes -1 as its default level
+        if (level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION)
+            throw std::out_of_range(std::format("Compression level {} is not within {}..{}", level, Z_DEFAULT_COMPRESSION, Z_BEST_COMPRESSION));
+        s_threshold = threshold;
+        s_level     = level;
+    }
+
+    int threshold() noexcept
+    {
+        return s_threshold;
+    }
+
+    int level() noexcept
+    {
+        return s_level;
+    }
+
+    void compressFrames(std::span<const std::uint8_t> frames, std::vector<std::uint8_t>& out)
+    {
+        size_t position = 0;
+        while (position < frames.size())
+        {
+            const size_t length = std::uint32_t(util::readVarInt(frames, position));
+            const auto data     = frames.subspan(position, length);
+            position += length;
+
+            if (length < size_t(s_threshold))
+            {
+                util::writeVarInt(out, length + 1);
+                out.push_back(0);
+                out.insert(out.end(), data.begin(), data.end());
+                continue;
+            }
+
+            const auto compressed = deflate(data);
+            util::writeVarInt(out, util::sizeOfVarInt(length) + compressed.size());
+            util::writeVarInt(out, length);
+            out.insert(out.end(), compressed.begin(), compressed.end());
+        }
+    }
+
+    std::vector<std::uint8_t> compressFrames(std::span<const std::uint8_t> frames)
+    {
+        auto out = pool::acquire(frames.size() + 16);
+        compressFrames(frames, out);
+        return out;
+    }
+
+    std::span<const std::uint8_t> decompressFrame(std::span<const std::uint8_t> frame, std::vector<std::uint8_t>& scratch)
+    {
+        size_t position          = 0;
+        const size_t dataLength  = std::uint32_t(util::readVarInt(frame, position));
+        const auto data          = frame.subspan(position);
+
+        if (dataLength == 0)
+            return data;
+
+        if (dataLength > MAX_DATA_LENGTH)
+            throw std::runtime_error("Compressed packet announces " + std::to_string(dataLength) + " bytes");
+        if (dataLength < size_t(s_threshold))
+            throw std::runtime_error("Compressed packet below the compression threshold");
+
+        Inflater& inflater = threadInflater();
+        scratch.resize(dataLength);
+        inflater.stream.next_in   = const_cast<Bytef*>(data.data());
+        inflater.stream.avail_in  = data.size();
+        inflater.stream.next_out  = scratch.data();
+        inflater.stream.avail_out = scratch.size();
+
+        if (::inflate(&inflater.stream, Z_FINISH) != Z_STREAM_END || inflater.stream.total_out != dataLength)
+            throw std::runtime_error("Compressed packet does not match its data length");
+        return scratch;
+    }
+    std::vector<std::uint8_t> inflateStream(std::span<const std::uint8_t> data)
+    {
+        Inflater& inflater = threadStreamInflater();
+        inflater.stream.next_in  = const_cast<Bytef*>(data.data());
+        inflater.stream.avail_in = data.size();
+
+        // Chunks usually inflate to a few times their compressed size, grow from there
+        std::vector<std::uint8_t> out(std::max<size_t>(data.size() * 4, 4096));
+        while (true)
+        {
+            inflater.stream.next_out  = out.data() + inflater.stream.total_out;
+            inflater.stream.avail_out = out.size() - inflater.stream.total_out;
+
+            const int result = ::inflate(&inflater.stream, Z_NO_FLUSH);
+            if (result == Z_STREAM_END)
+                break;
+            if (result != Z_OK && !(result == Z_BUF_ERROR && inflater.stream.avail_out == 0))
+                throw std::runtime_error("Malformed or truncated zlib stream");
+            if (inflater.stream.avail_out == 0)
+                out.resize(out.size() * 2);
+        }
+        out.resize(inflater.stream.total_out);
+        return out;
+    }
+}
@@ -1,31 +1,138 @@
 #include "DataTypes/Identifier.h"
 
+#include <stdexcept>
+
+#include "InternTable.h"
+
 namespace mc
 {
-        std::regex Identifier::s_allowedNamespaceCharacters{"[a-z0-9.-_]"};
-        std::regex Identifier::s_allowedValueCharacters{"[a-z0-9.-_/]"};
+    namespace
+    {
+        struct IdentifierData
+        {
+            std::uint32_t separator;
+            // Length prefixed text as it goes on the wire
+            std::vector<std::uint8_t> encoded;
+        };
 
-        Identifier::Identifier(const std::string& category, const std::string& value)
+        using IdentifierTable = util::InternTable<IdentifierData>;
+
+        // Never destroyed so identifiers stay usable while other statics shut down
+        IdentifierTable& table()
         {
-            m_value = value;
-            m_category = category;
-
-            util::toLower(m_value);
-            util::toLower(m_category);
-            //This regex shit needs to be redone it does not work :)
-            if (!std::regex_match(m_value, s_allowedValueCharacters))
-                throw std::runtime_error("Value does not respect character restrictions");
-            if (!std::regex_match(m_category, s_allowedNamespaceCharacters))
-                throw std::runtime_error("Category does not respect character restrictions");
+            static IdentifierTable* instance = []()
+            {
+                auto* table = new IdentifierTable();
+                // Handle 0 is the empty identifier
+                table->Intern(":", [](std::string_view) { return IdentifierData{ 0, { 1, ':' } }; });
+                return table;
+            }();
+            return *instance;
         }
 
-        Identifier::Identifier(const std::string& value)
-            :m_category("minecraft")
+        // "stone" and ":stone" are both in the default namespace
+        std::string_view namespaceOf(std::string_view text)
         {
-            m_value = value;
-            util::toLower(m_value);
+            const size_t separator = text.find(':');
+            return separator == std::string_view::npos || separator == 0 ? Identifier::DEFAULT_NAMESPACE : text.substr(0, separator);
+        }
 
-            if (std::regex_match(m_value, s_allowedValueCharacters))
-                throw std::runtime_error("Value does not respect character restrictions");
+        std::string_view valueOf(std::string_view text)
+        {
+            const size_t separator = text.find(':');
+            return separator == std::string_view::npos ? text : text.substr(separator + 1);
         }
-}
\ No newline at end of file
+
+        // Lowercases into storage only when there is something to lowercase
+        std::string_view lowered(std::string_view text, std::string& storage)
+        {
+            for (const char c : text)
+            {
+                if (c >= 'A' && c <= 'Z')
+                {
+                    storage = text;
+                    util::toLower(storage);
+                    return storage;
+                }
+            }
+            return text;
+        }
+    }
+
+    Identifier::Identifier(std::string_view category, std::string_view value)
+    {
+        std::string categoryStorage;
+        std::string valueStorage;
+        category = lowered(category, categoryStorage);
+        value    = lowered(value, valueStorage);
+
+        if (!IsValidValue(value))
+            throw std::runtime_error("Value does not respect character restrictions");
+        if (!IsValidNamespace(category))
+            throw std::runtime_error("Category does not respect character restrictions");
+
+        std::string text;
+        text.reserve(category.size() + 1 + value.size());
+        text.append(category).append(1, ':').append(value);
+        m_handle = table().Intern(text, [separator = category.size()](std::string_view text)
+        {
+            IdentifierData entry{ std::uint32_t(separator), {} };
+            util::writeVarInt(entry.encoded, text.size());
+            entry.encoded.insert(entry.encoded.end(), text.begin(), text.end());
+            return entry;
+        });
+    }
+
+    Identifier::Identifier(std::string_view value)
+        : Identifier(namespaceOf(value), valueOf(value))
+    {
+    }
+
+    std::optional<Identifier> Identifier::Find(std::string_view value)
+    {
+        std::string categoryStorage;
+        std::string valueStorage;
+        const std::string_view category = lowered(namespaceOf(value), categoryStorage);
+        value = lowered(valueOf(value), valueStorage);
+        if (!IsValidValue(value) || !IsValidNamespace(category))
+            return std::nullopt;
+
+        std::string text;
+        text.reserve(category.size() + 1 + value.size());
+        text.append(category).append(1, ':').append(value);
+        const auto handle = table().Find(text);
+        if (!handle.has_value())
+            return std::nullopt;
+
+        Identifier identifier;
+        identifier.m_handle = *handle;
+        return identifier;
+    }
+
+    std::string_view Identifier::GetCategory() const noexcept
+    {
+        const auto& entry = table().Get(m_handle);
+        return std::string_view(entry.text).substr(0, entry.payload.separator);
+    }
+
+    std::string_view Identifier::GetValue() const noexcept
+    {
+        const auto& entry = table().Get(m_handle);
+        return std::string_view(entry.text).substr(entry.payload.separator + 1);
+    }
+
+    std::string_view Identifier::View() const noexcept
+    {
+        return table().Get(m_handle).text;
+    }
+
+    std::span<const std::uint8_t> Identifier::Encoded() const noexcept
+    {
+        return table().Get(m_handle).payload.encoded;
+    }
+
+    std::uint64_t Identifier::Hash() const noexcept
+    {
+        return table().Get(m_handle).hash;
+    }
+}
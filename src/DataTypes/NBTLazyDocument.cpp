@@ -0,0 +1,299 @@
+#include "DataTypes/NBTLazyDocument.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace mc::NBT
+{
+    namespace
+    {
+        // Payload size of the tags that don't carry a length, 0 for the others
+        size_t fixedSize(TagType type)
+        {
+            switch (type)
+            {
+                case TagType::BYTE:
+                    return sizeof(Byte);
+                case TagType::SHORT:
+                    return sizeof(Short);
+                case TagType::INT:
+                case TagType::FLOAT:
+                    return sizeof(Int);
+                case TagType::LONG:
+                case TagType::DOUBLE:
+                    return sizeof(Long);
+                default:
+                    return 0;
+            }
+        }
+
+        void skipPayload(Reader& reader, TagType type, int depth);
+
+        // Leaves the reader on the first element
+        std::pair<TagType, size_t> readListHeader(Reader& reader)
+        {
+            const TagType elementType = reader.ReadTagType();
+            const Int size            = reader.Read<Int>();
+            return { elementType, elementType == TagType::END || size < 0 ? 0 : size };
+        }
+
+        void skipCompound(Reader& reader, int depth)
+        {
+            while (true)
+            {
+                const TagType type = reader.ReadTagType();
+                if (type == TagType::END)
+                    return;
+                reader.ReadString();
+                skipPayload(reader, type, depth + 1);
+            }
+        }
+
+        void skipPayload(Reader& reader, TagType type, int depth)
+        {
+            if (depth > MAX_DEPTH)
+                throw std::runtime_error("NBT nested deeper than " + std::to_string(MAX_DEPTH));
+
+            if (const size_t size = fixedSize(type); size != 0)
+            {
+                reader.Skip(size);
+                return;
+            }
+
+            switch (type)
+            {
+                case TagType::STRING:
+                    reader.ReadString();
+                    break;
+                case TagType::BYTE_ARRAY:
+                case TagType::INT_ARRAY:
+                case TagType::LONG_ARRAY:
+                {
+                    const Int size = reader.Read<Int>();
+                    if (size < 0)
+                        throw std::runtime_error("Negative array length " + std::to_string(size));
+                    const size_t element = type == TagType::BYTE_ARRAY ? 1 : type == TagType::INT_ARRAY ? 4 : 8;
+                    reader.Skip(size * element);
+                    break;
+                }
+                case TagType::LIST:
+                {
+                    const auto [elementType, size] = readListHeader(reader);
+                    if (const size_t element = fixedSize(elementType); element != 0)
+                    {
+                        reader.Skip(size * element);
+                        break;
+                    }
+                    for (size_t i = 0; i < size; ++i)
+                        skipPayload(reader, elementType, depth + 1);
+                    break;
+                }
+                case TagType::COMPOUND:
+                    skipCompound(reader, depth);
+                    break;
+                default:
+                    throw std::runtime_error("Unknown tag type" + std::to_string((int)type));
+            }
+        }
+
+        // Splits "a/b/c" into "a" and "b/c"
+        std::pair<std::string_view, std::string_view> splitPath(std::string_view path)
+        {
+            const size_t separator = path.find('/');
+            if (separator == std::string_view::npos)
+                return { path, {} };
+            return { path.substr(0, separator), path.substr(separator + 1) };
+        }
+    }
+
+    // ###########
+    // # LazyTag #
+    // ###########
+
+    LazyTag::LazyTag(std::span<const std::uint8_t> source, TagType type, std::string_view name, size_t offset)
+        : m_source(source),
+        m_type(type),
+        m_name(name),
+        m_offset(offset)
+    {
+    }
+
+    std::optional<LazyTag> LazyTag::Find(std::string_view path) const
+    {
+        if (path.empty())
+            return *this;
+
+        const auto [segment, rest] = splitPath(path);
+        const auto child = Child(segment);
+        if (!child.has_value())
+            return {};
+        return child->Find(rest);
+    }
+
+    std::vector<LazyTag> LazyTag::Children() const
+    {
+        std::vector<LazyTag> out;
+        Reader reader(m_source);
+        reader.Seek(m_offset);
+
+        if (m_type == TagType::COMPOUND)
+        {
+            while (true)
+            {
+                const TagType type = reader.ReadTagType();
+                if (type == TagType::END)
+                    return out;
+                const std::string_view name = reader.ReadString();
+                out.emplace_back(m_source, type, name, reader.Position());
+                skipPayload(reader, type, 0);
+            }
+        }
+
+        if (m_type == TagType::LIST)
+        {
+            const auto [elementType, size] = readListHeader(reader);
+            out.reserve(std::min(size, reader.Remaining()));
+            for (size_t i = 0; i < size; ++i)
+            {
+                out.emplace_back(m_source, elementType, std::string_view(), reader.Position());
+                skipPayload(reader, elementType, 0);
+            }
+        }
+        return out;
+    }
+
+    size_t LazyTag::Size() const
+    {
+        Reader reader(m_source);
+        reader.Seek(m_offset);
+        switch (m_type)
+        {
+            case TagType::STRING:
+                return reader.ReadString().size();
+            case TagType::BYTE_ARRAY:
+            case TagType::INT_ARRAY:
+            case TagType::LONG_ARRAY:
+                return ArrayLength(reader);
+            case TagType::LIST:
+                return readListHeader(reader).second;
+            case TagType::COMPOUND:
+                return Children().size();
+            default:
+                return 1;
+        }
+    }
+
+    TagType LazyTag::ElementType() const
+    {
+        if (m_type != TagType::LIST)
+            throw std::runtime_error(std::format("{} is not a list", m_name));
+
+        Reader reader(m_source);
+        reader.Seek(m_offset);
+        return reader.ReadTagType();
+    }
+
+    std::span<const std::uint8_t> LazyTag::Raw() const
+    {
+        Reader reader(m_source);
+        reader.Seek(m_offset);
+        skipPayload(reader, m_type, 0);
+        return m_source.subspan(m_offset, reader.Position() - m_offset);
+    }
+
+    std::span<const std::uint8_t> LazyTag::RawArray() const
+    {
+        if (m_type != TagType::INT_ARRAY && m_type != TagType::LONG_ARRAY)
+            throw std::runtime_error(std::format("{} is not an int or long array", m_name));
+
+        Reader reader(m_source);
+        reader.Seek(m_offset);
+        const size_t size = ArrayLength(reader);
+        return reader.ReadBytes(size * (m_type == TagType::INT_ARRAY ? sizeof(Int) : sizeof(Long)));
+    }
+
+    //Private
+
+    size_t LazyTag::ArrayLength(Reader& reader)
+    {
+        const Int size = reader.Read<Int>();
+        if (size < 0)
+            throw std::runtime_error("Negative array length " + std::to_string(size));
+        return size;
+    }
+
+    std::optional<LazyTag> LazyTag::Child(std::string_view segment) const
+    {
+        Reader reader(m_source);
+        reader.Seek(m_offset);
+
+        if (m_type == TagType::COMPOUND)
+        {
+            while (true)
+            {
+                const TagType type = reader.ReadTagType();
+                if (type == TagType::END)
+                    return {};
+                const std::string_view name = reader.ReadString();
+                if (name == segment)
+                    return LazyTag(m_source, type, name, reader.Position());
+                skipPayload(reader, type, 0);
+            }
+        }
+
+        if (m_type == TagType::LIST)
+        {
+            size_t index = 0;
+            const auto [end, error] = std::from_chars(segment.data(), segment.data() + segment.size(), index);
+            if (error != std::errc() || end != segment.data() + segment.size())
+                return {};
+
+            const auto [elementType, size] = readListHeader(reader);
+            if (index >= size)
+                return {};
+
+            // Numbers sit at a known distance, anything else has to be stepped over
+            if (const size_t element = fixedSize(elementType); element != 0)
+                reader.Skip(index * element);
+            else
+            {
+                for (size_t i = 0; i < index; ++i)
+                    skipPayload(reader, elementType, 0);
+            }
+            return LazyTag(m_source, elementType, std::string_view(), reader.Position());
+        }
+        return {};
+    }
+
+    // ################
+    // # LazyDocument #
+    // ################
+
+    LazyDocument::LazyDocument(std::vector<std::uint8_t> data)
+        : m_source(std::move(data)),
+        m_rootName(),
+        m_root()
+    {
+        Reader reader(m_source);
+        if (reader.ReadTagType() != TagType::COMPOUND)
+            throw std::runtime_error("Root component is not Compund tag");
+
+        m_rootName = reader.ReadString();
+        m_root     = LazyTag(m_source, TagType::COMPOUND, m_rootName, reader.Position()).Children();
+        std::ranges::stable_sort(m_root, {}, &LazyTag::Name);
+    }
+
+    std::optional<LazyTag> LazyDocument::Find(std::string_view path) const
+    {
+        const auto [segment, rest] = splitPath(path);
+        const auto it = std::ranges::lower_bound(m_root, segment, {}, &LazyTag::Name);
+        if (it == m_root.end() || it->Name() != segment)
+            return {};
+        return it->Find(rest);
+    }
+
+    size_t LazyDocument::MemoryUsage() const noexcept
+    {
+        return m_source.capacity() + m_root.capacity() * sizeof(LazyTag);
+    }
+}
@@ -103,179 +103,157 @@ namespace mc::NBT
   
     /******************** Other ********************/
 
-    TagType parseTagType(std::istream& data)
+    namespace
     {
-        char tag = (char)TagType::UNKNOWN;
-        data.read(&tag, 1);
-        return tag < -2 || tag >> 12 ? TagType::UNKNOWN : (TagType)tag;
-    }
-
-    template<mc::util::Numeric T>
-    T parseNumeric(std::istream& data)
-    {
-        T out = 0;
-        data.read((char*)&out, sizeof(T));
-        char* asBytes = (char*)&out;
-
-        for (size_t k = 0; k < sizeof(T)/2; k++)
-            std::swap(asBytes[k], asBytes[sizeof(T) - k - 1]);
-
-        return out;
-    }
-
-    std::string parseString(std::istream& data)
-    {
-        Short stringSize = parseNumeric<Short>(data);
-        std::string out(stringSize, ' ');
-        data.read(out.data(), stringSize);
-        return out;
-    }
-
-    template<typename T>
-    Array<T> parseArray(std::istream& data)
-    {
-        Array<T> out;
-        Int  size = parseNumeric<Int>(data);
-        out.reserve(size);
-        for(Int i = 0; i < size; i++)
-            out.push_back(parseNumeric<T>(data));
-        return out;
-    }
+        NBTList parseList(Reader& data, int depth);
+        NBTCompound parseCompound(Reader& data, int depth);
 
-    NBTList parseList(std::istream& data);
-
-    //Probably will require more error checking in the future
-    NBTCompound parseCompound(std::istream& data)
-    {
-        NBTCompound obj;
-        while(data.good())
+        void checkDepth(int depth)
         {
-            TagType nextTag = parseTagType(data);
-
-            if(nextTag == TagType::END)
-            {
-                return obj;
-            }
+            if (depth > MAX_DEPTH)
+                throw std::runtime_error("NBT nested deeper than " + std::to_string(MAX_DEPTH));
+        }
 
-            std::string tagName = parseString(data);
-            switch(nextTag)
+        NBTCompound parseCompound(Reader& data, int depth)
+        {
+            checkDepth(depth);
+            NBTCompound obj;
+            while(true)
             {
-                case TagType::BYTE:
-                    obj.Insert(tagName, parseNumeric<Byte>(data));
-                    break;
-                case TagType::SHORT:
-                    obj.Insert(tagName, parseNumeric<Short>(data));
-                    break;
-                case TagType::INT:
-                    obj.Insert(tagName, parseNumeric<Int>(data));
-                    break;
-                case TagType::LONG:
-                    obj.Insert(tagName, parseNumeric<Long>(data));
-                    break;
-                case TagType::FLOAT:
-                    obj.Insert(tagName, parseNumeric<Float>(data));
-                    break;
-                case TagType::DOUBLE:
-                    obj.Insert(tagName, parseNumeric<Double>(data));
-                    break;
-                case TagType::BYTE_ARRAY:
-                    obj.Insert(tagName, parseArray<Byte>(data));
-                    break;
-                case TagType::STRING:
-                    obj.Insert(tagName, parseString(data));
-                    break;
-                case TagType::LIST:
-                    obj.Insert(tagName, parseList(data));
-                    break;
-                case TagType::COMPOUND:
-                    obj.Insert(tagName, parseCompound(data));
-                    break;
-                case TagType::INT_ARRAY:
-                    obj.Insert(tagName, parseArray<Int>(data));
-                    break;
-                case TagType::LONG_ARRAY:
-                    obj.Insert(tagName, parseArray<Long>(data));
-                    break;
-                default:
-                    throw std::runtime_error("Unknown tag type" + std::to_string((int)nextTag));
+                TagType nextTag = data.ReadTagType();
+
+                if(nextTag == TagType::END)
+                {
+                    return obj;
+                }
+
+                const std::string tagName(data.ReadString());
+                switch(nextTag)
+                {
+                    case TagType::BYTE:
+                        obj.Insert(tagName, data.Read<Byte>());
+                        break;
+                    case TagType::SHORT:
+                        obj.Insert(tagName, data.Read<Short>());
+                        break;
+                    case TagType::INT:
+                        obj.Insert(tagName, data.Read<Int>());
+                        break;
+                    case TagType::LONG:
+                        obj.Insert(tagName, data.Read<Long>());
+                        break;
+                    case TagType::FLOAT:
+                        obj.Insert(tagName, data.Read<Float>());
+                        break;
+                    case TagType::DOUBLE:
+                        obj.Insert(tagName, data.Read<Double>());
+                        break;
+                    case TagType::BYTE_ARRAY:
+                        obj.Insert(tagName, data.ReadArray<Byte>());
+                        break;
+                    case TagType::STRING:
+                        obj.Insert(tagName, String(data.ReadString()));
+                        break;
+                    case TagType::LIST:
+                        obj.Insert(tagName, parseList(data, depth + 1));
+                        break;
+                    case TagType::COMPOUND:
+                        obj.Insert(tagName, parseCompound(data, depth + 1));
+                        break;
+                    case TagType::INT_ARRAY:
+                        obj.Insert(tagName, data.ReadArray<Int>());
+                        break;
+                    case TagType::LONG_ARRAY:
+                        obj.Insert(tagName, data.ReadArray<Long>());
+                        break;
+                    default:
+                        throw std::runtime_error("Unknown tag type" + std::to_string((int)nextTag));
+                }
             }
         }
 
-        return obj;
-    }
-
-    //Probably will require more error checking in the future
-    NBTList parseList(std::istream& data)
-    {
-        NBTList out;
-        TagType containedType = parseTagType(data);
-        Int size = parseNumeric<Int>(data);
-        Int count = 0;
-        while(data.good())
+        NBTList parseList(Reader& data, int depth)
         {
+            checkDepth(depth);
+            TagType containedType = data.ReadTagType();
+            const Int size = data.Read<Int>();
+            // Typed even when empty so it serializes back to the same bytes
+            NBTList out(containedType);
 
-            if (containedType == TagType::END || count >= size)
-            {
+            if (containedType == TagType::END)
                 return out;
-            }
 
-            switch(containedType)
+            for (Int count = 0; count < size; ++count)
             {
-                case TagType::BYTE:
-                    out.Insert(parseNumeric<Byte>(data));
-                    break;
-                case TagType::SHORT:
-                    out.Insert(parseNumeric<Short>(data));
-                    break;
-                case TagType::INT:
-                    out.Insert(parseNumeric<Int>(data));
-                    break;
-                case TagType::LONG:
-                    out.Insert(parseNumeric<Long>(data));
-                    break;
-                case TagType::FLOAT:
-                    out.Insert(parseNumeric<Float>(data));
-                    break;
-                case TagType::DOUBLE:
-                    out.Insert(parseNumeric<Double>(data));
-                    break;
-                case TagType::BYTE_ARRAY:
-                    out.Insert(parseArray<Byte>(data));
-                    break;
-                case TagType::STRING:
-                    out.Insert(parseString(data));
-                    break;
-                case TagType::LIST:
-                    out.Insert(parseList(data));
-                    break;
-                case TagType::COMPOUND:
-                    out.Insert(parseCompound(data));
-                    break;
-                case TagType::INT_ARRAY:
-                    out.Insert(parseArray<Int>(data));
-                    break;
-                case TagType::LONG_ARRAY:
-                    out.Insert(parseArray<Long>(data));
-                    break;
-                default:
-                    throw std::runtime_error("Unknown tag type" + std::to_string((int)containedType));
+                switch(containedType)
+                {
+                    case TagType::BYTE:
+                        out.Insert(data.Read<Byte>());
+                        break;
+                    case TagType::SHORT:
+                        out.Insert(data.Read<Short>());
+                        break;
+                    case TagType::INT:
+                        out.Insert(data.Read<Int>());
+                        break;
+                    case TagType::LONG:
+                        out.Insert(data.Read<Long>());
+                        break;
+                    case TagType::FLOAT:
+                        out.Insert(data.Read<Float>());
+                        break;
+                    case TagType::DOUBLE:
+                        out.Insert(data.Read<Double>());
+                        break;
+                    case TagType::BYTE_ARRAY:
+                        out.Insert(data.ReadArray<Byte>());
+                        break;
+                    case TagType::STRING:
+                        out.Insert(String(data.ReadString()));
+                        break;
+                    case TagType::LIST:
+                        out.Insert(parseList(data, depth + 1));
+                        break;
+                    case TagType::COMPOUND:
+                        out.Insert(parseCompound(data, depth + 1));
+                        break;
+                    case TagType::INT_ARRAY:
+                        out.Insert(data.ReadArray<Int>());
+                        break;
+                    case TagType::LONG_ARRAY:
+                        out.Insert(data.ReadArray<Long>());
+                        break;
+                    default:
+                        throw std::runtime_error("Unknown tag type" + std::to_string((int)containedType));
+                }
             }
-            ++count;
+            return out;
         }
-        return out;
     }
 
-
-    NBT parse(std::istream& data)
+    NBT parse(std::span<const std::uint8_t> data)
     {
-        if (parseTagType(data) != TagType::COMPOUND)
+        Reader reader(data);
+        if (reader.ReadTagType() != TagType::COMPOUND)
         {
             throw std::runtime_error("Root component is not Compund tag");
         }
 
-        std::string name = parseString(data);
-        NBT root(name, parseCompound(data));
+        const std::string name(reader.ReadString());
+        return NBT(name, parseCompound(reader, 0));
+    }
 
-        return root;
+    NBT parse(std::istream& data)
+    {
+        constexpr size_t READ_SIZE = 64 * 1024;
+        std::vector<std::uint8_t> buffer;
+        while (data)
+        {
+            const size_t offset = buffer.size();
+            buffer.resize(offset + READ_SIZE);
+            data.read(reinterpret_cast<char*>(buffer.data() + offset), READ_SIZE);
+            buffer.resize(offset + data.gcount());
+        }
+        return parse(std::span<const std::uint8_t>(buffer));
     }
 }
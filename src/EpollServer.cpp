@@ -0,0 +1,449 @@
+#include "EpollServer.h"
+
+#include <SFW/LoggerManager.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+
+#include "ClientConnection.h"
+#include "FrameDecoder.h"
+#include "OutboundQueue.h"
+#include "PlayerHandler.h"
+#include "Socket.h"
+#include "utils.h"
+
+namespace mc
+{
+    namespace
+    {
+        // Idle connections only need room for a handshake, the decoder grows on demand
+        constexpr size_t IDLE_BUFFER_SIZE = 512;
+        constexpr size_t READ_SIZE        = 512;
+        constexpr int MAX_EVENTS          = 256;
+        constexpr auto TICK_INTERVAL      = PlayerHandler::TICK_INTERVAL;
+
+        void wake(int eventFd)
+        {
+            const std::uint64_t value = 1;
+            [[maybe_unused]] const ssize_t written = ::write(eventFd, &value, sizeof(value));
+        }
+
+        void drainWakeup(int eventFd)
+        {
+            std::uint64_t value;
+            [[maybe_unused]] const ssize_t received = ::read(eventFd, &value, sizeof(value));
+        }
+    }
+
+    // ###################
+    // # EpollConnection #
+    // ###################
+
+    class EpollConnection : public ClientConnection
+    {
+    public:
+        EpollConnection(int fd, std::string address, int port, const ServerContext& context)
+            : m_fd(fd),
+            m_address(std::move(address)),
+            m_port(port),
+            m_broken(false),
+            m_readPaused(false),
+            m_outbound(),
+            m_decoder(IDLE_BUFFER_SIZE),
+            m_handler(*this, context)
+        {
+        }
+
+        ~EpollConnection() override { ::close(m_fd); }
+
+        using ClientConnection::Send;
+
+        // Queued, whatever the kernel doesn't take right away waits for EPOLLOUT
+        void Send(const std::vector<std::uint8_t>& data) override
+        {
+            if (!m_broken)
+                Queued(m_outbound.Push(std::span<const std::uint8_t>(data)));
+        }
+
+        void Send(std::vector<std::uint8_t>&& data) override
+        {
+            if (!m_broken)
+                Queued(m_outbound.Push(std::move(data)));
+        }
+
+        void SendPrebuilt(std::span<const std::uint8_t> data) override
+        {
+            if (!m_broken)
+                Queued(m_outbound.PushBorrowed(data));
+        }
+
+        void SendShared(std::shared_ptr<const std::vector<std::uint8_t>> data) override
+        {
+            if (!m_broken)
+                Queued(m_outbound.PushShared(std::move(data)));
+        }
+
+        inline void Cork() override { m_outbound.Cork(); }
+
+        inline void Uncork() override
+        {
+            m_outbound.Uncork();
+            Flush();
+        }
+
+        inline std::string GetAdress() const override { return m_address; }
+        inline int GetPort() const override { return m_port; }
+
+        inline int Fd() const noexcept { return m_fd; }
+        inline bool IsBroken() const noexcept { return m_broken; }
+
+        // Both return false once the connection has to be closed
+        bool OnReadable()
+        {
+            try
+            {
+                while (!m_broken)
+                {
+                    // Backpressure, the peer gets no more service until it read what it was sent
+                    if (m_outbound.IsFull())
+                    {
+                        m_readPaused = true;
+                        return true;
+                    }
+
+                    const auto buffer = m_decoder.WritableSpan(READ_SIZE);
+                    const ssize_t received = ::recv(m_fd, buffer.data(), buffer.size(), 0);
+
+                    if (received > 0)
+                    {
+                        m_decoder.Commit(received);
+                        Cork();
+                        while (const auto frame = m_decoder.NextFrame())
+                            m_handler.Execute(*frame);
+                        Uncork();
+                        continue;
+                    }
+
+                    if (received == 0)
+                        return false;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                        return true;
+                    if (errno != EINTR)
+                        return false;
+                }
+            }
+            // Whatever one client's bytes made the handler throw, only that connection goes
+            catch (const std::exception& e)
+            {
+                SFW_LOG_WARN("EpollServer", "Dropping connection {}:{}, {}", m_address, m_port, e.what());
+                return false;
+            }
+            return false;
+        }
+
+        bool OnWritable()
+        {
+            Flush();
+            if (m_broken)
+                return false;
+
+            // Edge triggered, whatever arrived while paused won't be announced again
+            if (m_readPaused && !m_outbound.IsFull())
+            {
+                m_readPaused = false;
+                return OnReadable();
+            }
+            return true;
+        }
+
+        // Marks the connection broken if the handler throws
+        void Tick()
+        {
+            try
+            {
+                Cork();
+                m_handler.Tick();
+                Uncork();
+            }
+            catch (const std::exception& e)
+            {
+                SFW_LOG_WARN("EpollServer", "Dropping connection {}:{}, {}", m_address, m_port, e.what());
+                m_broken = true;
+            }
+        }
+
+    private:
+        void Queued(bool belowLimit)
+        {
+            if (!belowLimit && !m_readPaused)
+                SFW_LOG_DEBUG("EpollServer", "Outbound queue of {}:{} full ({} bytes)", m_address, m_port, m_outbound.Size());
+            Flush();
+        }
+
+        void Flush()
+        {
+            if (m_outbound.Flush(m_fd) == OutboundQueue::FlushResult::FAILED)
+                m_broken = true;
+        }
+
+        int m_fd;
+        std::string m_address;
+        int m_port;
+        bool m_broken;
+        bool m_readPaused;
+        OutboundQueue m_outbound;
+        FrameDecoder m_decoder;
+        PlayerHandler m_handler;
+    };
+
+    // ###############
+    // # EpollWorker #
+    // ###############
+
+    class EpollWorker
+    {
+    public:
+        EpollWorker()
+            : m_epoll(::epoll_create1(EPOLL_CLOEXEC)),
+            m_wakeup(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+            m_stop(false)
+        {
+            if (m_epoll < 0 || m_wakeup < 0)
+                util::throwErrno("EpollWorker");
+
+            epoll_event event{};
+            event.events   = EPOLLIN;
+            event.data.ptr = nullptr;
+            if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeup, &event) < 0)
+                util::throwErrno("epoll_ctl");
+        }
+
+        ~EpollWorker()
+        {
+            Stop();
+            m_connections.clear();
+            m_incoming.clear();
+            ::close(m_wakeup);
+            ::close(m_epoll);
+        }
+
+        void Start() { m_thread = std::thread([this]() { Loop(); }); }
+
+        void Stop()
+        {
+            m_stop = true;
+            wake(m_wakeup);
+            if (m_thread.joinable())
+                m_thread.join();
+        }
+
+        // Called from the accepting thread, the connection is registered by the worker itself
+        void Adopt(std::unique_ptr<EpollConnection> connection)
+        {
+            {
+                std::lock_guard lock(m_incomingMutex);
+                m_incoming.push_back(std::move(connection));
+            }
+            wake(m_wakeup);
+        }
+
+    private:
+        void Loop()
+        {
+            std::array<epoll_event, MAX_EVENTS> events;
+            auto lastTick = std::chrono::steady_clock::now();
+
+            while (!m_stop)
+            {
+                const int ready = ::epoll_wait(m_epoll, events.data(), events.size(), TICK_INTERVAL.count());
+                if (ready < 0 && errno != EINTR)
+                {
+                    SFW_LOG_ERROR("EpollServer", "epoll_wait failed: {}", std::strerror(errno));
+                    return;
+                }
+
+                for (int i = 0; i < ready; ++i)
+                {
+                    auto* connection = static_cast<EpollConnection*>(events[i].data.ptr);
+                    if (connection == nullptr)
+                    {
+                        drainWakeup(m_wakeup);
+                        AdoptIncoming();
+                        continue;
+                    }
+
+                    const std::uint32_t mask = events[i].events;
+                    bool open = (mask & (EPOLLERR | EPOLLHUP)) == 0;
+                    if (open && (mask & EPOLLOUT))
+                        open = connection->OnWritable();
+                    if (open && (mask & (EPOLLIN | EPOLLRDHUP)))
+                        open = connection->OnReadable();
+                    if (!open || connection->IsBroken())
+                        m_connections.erase(connection);
+                }
+
+                const auto now = std::chrono::steady_clock::now();
+                if (now - lastTick >= TICK_INTERVAL)
+                {
+                    lastTick = now;
+                    for (auto& [_, connection] : m_connections)
+                        connection->Tick();
+                    std::erase_if(m_connections, [](const auto& entry) { return entry.second->IsBroken(); });
+                }
+            }
+        }
+
+        void AdoptIncoming()
+        {
+            std::vector<std::unique_ptr<EpollConnection>> incoming;
+            {
+                std::lock_guard lock(m_incomingMutex);
+                incoming.swap(m_incoming);
+            }
+
+            for (auto& connection : incoming)
+            {
+                epoll_event event{};
+                event.events   = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                event.data.ptr = connection.get();
+                if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, connection->Fd(), &event) < 0)
+                {
+                    SFW_LOG_WARN("EpollServer", "Failed to register connection: {}", std::strerror(errno));
+                    continue;
+                }
+                EpollConnection* key = connection.get();
+                m_connections.emplace(key, std::move(connection));
+            }
+        }
+
+        int m_epoll;
+        int m_wakeup;
+        std::atomic_bool m_stop;
+        std::thread m_thread;
+
+        std::mutex m_incomingMutex;
+        std::vector<std::unique_ptr<EpollConnection>> m_incoming;
+        // Only touched by the worker thread
+        std::unordered_map<EpollConnection*, std::unique_ptr<EpollConnection>> m_connections;
+    };
+
+    // ###############
+    // # EpollServer #
+    // ###############
+
+    EpollServer::EpollServer(std::string address, std::uint16_t port, size_t ioThreads)
+        : m_address(std::move(address)),
+        m_port(port),
+        m_listenSocket(-1),
+        m_epoll(::epoll_create1(EPOLL_CLOEXEC)),
+        m_wakeup(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+        m_stop(false),
+        m_nextWorker(0)
+    {
+        if (m_epoll < 0 || m_wakeup < 0)
+            util::throwErrno("EpollServer");
+
+        m_context.Load();
+
+        for (size_t i = 0; i < std::max<size_t>(ioThreads, 1); ++i)
+            m_workers.push_back(std::make_unique<EpollWorker>());
+    }
+
+    EpollServer::~EpollServer()
+    {
+        m_workers.clear();
+        if (m_listenSocket >= 0)
+            ::close(m_listenSocket);
+        ::close(m_wakeup);
+        ::close(m_epoll);
+    }
+
+    void EpollServer::Run()
+    {
+        Listen();
+        for (auto& worker : m_workers)
+            worker->Start();
+
+        SFW_LOG_INFO("EpollServer", "Listening on {}:{} with {} I/O threads", m_address, m_port, m_workers.size());
+
+        std::array<epoll_event, 2> events;
+        while (!m_stop)
+        {
+            const int ready = ::epoll_wait(m_epoll, events.data(), events.size(), -1);
+            if (ready < 0 && errno != EINTR)
+            {
+                SFW_LOG_ERROR("EpollServer", "epoll_wait failed: {}", std::strerror(errno));
+                break;
+            }
+
+            for (int i = 0; i < ready; ++i)
+            {
+                if (events[i].data.fd == m_listenSocket)
+                    AcceptAll();
+                else
+                    drainWakeup(m_wakeup);
+            }
+        }
+
+        for (auto& worker : m_workers)
+            worker->Stop();
+    }
+
+    void EpollServer::Stop()
+    {
+        m_stop = true;
+        wake(m_wakeup);
+    }
+
+    //Private
+
+    void EpollServer::Listen()
+    {
+        m_listenSocket = net::openListenSocket(m_address, m_port);
+
+        epoll_event listenEvent{};
+        listenEvent.events  = EPOLLIN;
+        listenEvent.data.fd = m_listenSocket;
+        epoll_event wakeupEvent{};
+        wakeupEvent.events  = EPOLLIN;
+        wakeupEvent.data.fd = m_wakeup;
+        if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_listenSocket, &listenEvent) < 0 ||
+            ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeup, &wakeupEvent) < 0)
+            util::throwErrno("epoll_ctl");
+    }
+
+    void EpollServer::AcceptAll()
+    {
+        while (true)
+        {
+            const int fd = ::accept4(m_listenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+            if (fd < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    SFW_LOG_WARN("EpollServer", "accept failed: {}", std::strerror(errno));
+                return;
+            }
+
+            net::setNoDelay(fd);
+            auto [host, port] = net::peerAddress(fd);
+            SFW_LOG_INFO("EpollServer", "New connection from: {}:{}", host, port);
+
+            m_workers[m_nextWorker]->Adopt(std::make_unique<EpollConnection>(fd, std::move(host), port, m_context));
+            m_nextWorker = (m_nextWorker + 1) % m_workers.size();
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#include "FrameDecoder.h"
+
+#include <SFW/utils.h>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "utils.h"
+
+namespace mc
+{
+    FrameDecoder::FrameDecoder(size_t capacity)
+        : m_buffer(std::bit_ceil(capacity)),
+        m_read(0),
+        m_write(0)
+    {
+    }
+
+    std::span<std::uint8_t> FrameDecoder::WritableSpan(size_t minimum)
+    {
+        if (m_buffer.size() - m_write < minimum)
+        {
+            Compact();
+            if (m_buffer.size() - m_write < minimum)
+                m_buffer.resize(std::bit_ceil(m_write + minimum));
+        }
+        return { m_buffer.data() + m_write, m_buffer.size() - m_write };
+    }
+
+    void FrameDecoder::Commit(size_t bytes)
+    {
+        ASSERT(m_write + bytes <= m_buffer.size(), "Committed more bytes than the writable span");
+        m_write += bytes;
+    }
+
+    void FrameDecoder::Feed(std::span<const std::uint8_t> data)
+    {
+        const auto destination = WritableSpan(data.size());
+        std::memcpy(destination.data(), data.data(), data.size());
+        Commit(data.size());
+    }
+
+    std::optional<std::span<const std::uint8_t>> FrameDecoder::NextFrame()
+    {
+        size_t frameSize  = 0;
+        size_t headerSize = 0;
+
+        if (!PeekLength(frameSize, headerSize))
+            return {};
+
+        if (frameSize == 0 || frameSize > MAX_FRAME_SIZE)
+            throw std::runtime_error("Invalid frame size: " + std::to_string(frameSize));
+
+        if (Buffered() < headerSize + frameSize)
+            return {};
+
+        const std::span<const std::uint8_t> frame(m_buffer.data() + m_read + headerSize, frameSize);
+        m_read += headerSize + frameSize;
+
+        // Everything consumed, rewind for free instead of moving bytes later
+        if (m_read == m_write)
+            m_read = m_write = 0;
+
+        return frame;
+    }
+
+    //Private
+
+    bool FrameDecoder::PeekLength(size_t& length, size_t& headerSize) const
+    {
+        length = 0;
+        for (size_t i = 0; i < MAX_LENGTH_BYTES; ++i)
+        {
+            if (m_read + i >= m_write)
+                return false;
+
+            const std::uint8_t byte = m_buffer[m_read + i];
+            length |= size_t(byte & util::SEGMENT_BIT) << (7 * i);
+
+            if ((byte & util::CONTINUE_BIT) == 0)
+            {
+                headerSize = i + 1;
+                return true;
+            }
+        }
+        throw std::runtime_error("Frame length VarInt too big");
+    }
+
+    void FrameDecoder::Compact()
+    {
+        if (m_read == 0)
+            return;
+
+        const size_t buffered = Buffered();
+        std::memmove(m_buffer.data(), m_buffer.data() + m_read, buffered);
+        m_read  = 0;
+        m_write = buffered;
+    }
+}
@@ -0,0 +1,246 @@
+#include "IoUring.h"
+
+#include <SFW/LoggerManager.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <system_error>
+#include <unistd.h>
+
+#include "utils.h"
+
+namespace mc
+{
+    namespace
+    {
+        int ioUringSetup(unsigned entries, io_uring_params* params)
+        {
+            return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+        }
+
+        int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+        {
+            return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+        }
+
+        int ioUringRegister(int fd, unsigned opcode, const void* arg, unsigned count)
+        {
+            return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+        }
+
+        template<typename T>
+        T* at(void* base, unsigned offset)
+        {
+            return reinterpret_cast<T*>(static_cast<std::uint8_t*>(base) + offset);
+        }
+
+        // The entries start at the ring itself, the tail overlaps the first one. Not going through
+        // io_uring_buf_ring::bufs on purpose, in C++ its flexible array ends up 8 bytes in
+        io_uring_buf& bufferEntry(io_uring_buf_ring* ring, unsigned index)
+        {
+            return reinterpret_cast<io_uring_buf*>(ring)[index];
+        }
+    }
+
+    // ###########
+    // # IoUring #
+    // ###########
+
+    IoUring::IoUring(unsigned entries)
+        : m_fd(-1),
+        m_sqRing(MAP_FAILED),
+        m_sqRingSize(0),
+        m_cqRing(MAP_FAILED),
+        m_cqRingSize(0),
+        m_sqes(static_cast<io_uring_sqe*>(MAP_FAILED)),
+        m_sqesSize(0),
+        m_sqeHead(0),
+        m_sqeTail(0)
+    {
+        io_uring_params params{};
+        m_fd = ioUringSetup(entries, &params);
+        if (m_fd < 0)
+            util::throwErrno("io_uring_setup");
+
+        m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+        const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMmap)
+            m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+
+        m_sqRing = ::mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+        if (m_sqRing == MAP_FAILED)
+        {
+            ::close(m_fd);
+            util::throwErrno("mmap sq ring");
+        }
+
+        m_cqRing = singleMmap ?
+            m_sqRing :
+            ::mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        m_sqes     = static_cast<io_uring_sqe*>(
+            ::mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES));
+
+        if (m_cqRing == MAP_FAILED || m_sqes == MAP_FAILED)
+        {
+            const int error = errno;
+            Release();
+            errno = error;
+            util::throwErrno("mmap io_uring");
+        }
+
+        m_sqHead    = at<unsigned>(m_sqRing, params.sq_off.head);
+        m_sqTail    = at<unsigned>(m_sqRing, params.sq_off.tail);
+        m_sqMask    = at<unsigned>(m_sqRing, params.sq_off.ring_mask);
+        m_sqArray   = at<unsigned>(m_sqRing, params.sq_off.array);
+        m_sqEntries = params.sq_entries;
+
+        m_cqHead = at<unsigned>(m_cqRing, params.cq_off.head);
+        m_cqTail = at<unsigned>(m_cqRing, params.cq_off.tail);
+        m_cqMask = at<unsigned>(m_cqRing, params.cq_off.ring_mask);
+        m_cqes   = at<io_uring_cqe>(m_cqRing, params.cq_off.cqes);
+    }
+
+    IoUring::~IoUring()
+    {
+        Release();
+    }
+
+    bool IoUring::IsSupported()
+    {
+        static const bool supported = []()
+        {
+            try
+            {
+                IoUring ring(4);
+                ProvidedBufferRing probe(ring, 0, 1, 64);
+                return true;
+            }
+            catch (const std::system_error& e)
+            {
+                SFW_LOG_WARN("IoUring", "io_uring unavailable, falling back: {}", e.what());
+                return false;
+            }
+        }();
+        return supported;
+    }
+
+    io_uring_sqe* IoUring::NextSqe()
+    {
+        const unsigned head = std::atomic_ref(*m_sqHead).load(std::memory_order_acquire);
+        if (m_sqeTail - head >= m_sqEntries)
+        {
+            Submit();
+            if (m_sqeTail - std::atomic_ref(*m_sqHead).load(std::memory_order_acquire) >= m_sqEntries)
+                throw std::system_error(EBUSY, std::generic_category(), "io_uring submission queue full");
+        }
+
+        io_uring_sqe* sqe = &m_sqes[m_sqeTail & *m_sqMask];
+        ++m_sqeTail;
+        std::memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    int IoUring::Submit(unsigned waitFor)
+    {
+        unsigned tail          = *m_sqTail;
+        const unsigned pending = m_sqeTail - m_sqeHead;
+        for (; m_sqeHead != m_sqeTail; ++m_sqeHead, ++tail)
+            m_sqArray[tail & *m_sqMask] = m_sqeHead & *m_sqMask;
+        std::atomic_ref(*m_sqTail).store(tail, std::memory_order_release);
+
+        while (true)
+        {
+            const int submitted = ioUringEnter(m_fd, pending, waitFor, waitFor > 0 ? IORING_ENTER_GETEVENTS : 0);
+            if (submitted >= 0)
+                return submitted;
+            if (errno != EINTR)
+                util::throwErrno("io_uring_enter");
+        }
+    }
+
+    //Private
+
+    void IoUring::Release()
+    {
+        if (m_sqes != MAP_FAILED)
+            ::munmap(m_sqes, m_sqesSize);
+        if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing)
+            ::munmap(m_cqRing, m_cqRingSize);
+        if (m_sqRing != MAP_FAILED)
+            ::munmap(m_sqRing, m_sqRingSize);
+        if (m_fd >= 0)
+            ::close(m_fd);
+
+        m_sqes   = static_cast<io_uring_sqe*>(MAP_FAILED);
+        m_cqRing = m_sqRing = MAP_FAILED;
+        m_fd     = -1;
+    }
+
+    // ######################
+    // # ProvidedBufferRing #
+    // ######################
+
+    ProvidedBufferRing::ProvidedBufferRing(IoUring& ring, std::uint16_t group, std::uint16_t count, std::uint32_t bufferSize)
+        : m_ring(ring),
+        m_group(group),
+        m_count(count),
+        m_bufferSize(bufferSize),
+        m_bufRing(nullptr),
+        m_bufRingSize(count * sizeof(io_uring_buf)),
+        m_buffers(size_t(count) * bufferSize)
+    {
+        // The kernel wants a power of two entries in page aligned memory
+        if ((count & (count - 1)) != 0)
+            throw std::system_error(EINVAL, std::generic_category(), "ProvidedBufferRing count must be a power of two");
+
+        void* memory = ::mmap(nullptr, m_bufRingSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+        if (memory == MAP_FAILED)
+            util::throwErrno("mmap buffer ring");
+        m_bufRing = static_cast<io_uring_buf_ring*>(memory);
+
+        io_uring_buf_reg registration{};
+        registration.ring_addr    = reinterpret_cast<std::uint64_t>(m_bufRing);
+        registration.ring_entries = count;
+        registration.bgid         = group;
+        if (ioUringRegister(m_ring.Fd(), IORING_REGISTER_PBUF_RING, &registration, 1) < 0)
+        {
+            const int error = errno;
+            ::munmap(m_bufRing, m_bufRingSize);
+            errno = error;
+            util::throwErrno("io_uring_register buffer ring");
+        }
+
+        for (std::uint16_t id = 0; id < count; ++id)
+        {
+            io_uring_buf& buffer = bufferEntry(m_bufRing, id);
+            buffer.addr = reinterpret_cast<std::uint64_t>(m_buffers.data() + size_t(id) * m_bufferSize);
+            buffer.len  = m_bufferSize;
+            buffer.bid  = id;
+        }
+        std::atomic_ref(m_bufRing->tail).store(count, std::memory_order_release);
+    }
+
+    ProvidedBufferRing::~ProvidedBufferRing()
+    {
+        io_uring_buf_reg registration{};
+        registration.bgid = m_group;
+        ioUringRegister(m_ring.Fd(), IORING_UNREGISTER_PBUF_RING, &registration, 1);
+        ::munmap(m_bufRing, m_bufRingSize);
+    }
+
+    void ProvidedBufferRing::Recycle(std::uint16_t id)
+    {
+        const std::uint16_t tail = m_bufRing->tail;
+        io_uring_buf& buffer = bufferEntry(m_bufRing, tail & (m_count - 1));
+        buffer.addr = reinterpret_cast<std::uint64_t>(m_buffers.data() + size_t(id) * m_bufferSize);
+        buffer.len  = m_bufferSize;
+        buffer.bid  = id;
+        std::atomic_ref(m_bufRing->tail).store(tail + 1, std::memory_order_release);
+    }
+}
@@ -0,0 +1,57 @@
+#include "MappedFile.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+namespace mc
+{
+    std::unique_ptr<MappedFile> MappedFile::Open(const std::filesystem::path& path, int advice)
+    {
+        const int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0)
+        {
+            if (errno == ENOENT)
+                return nullptr;
+            util::throwErrno("open");
+        }
+
+        struct stat info{};
+        if (::fstat(file, &info) < 0)
+        {
+            ::close(file);
+            util::throwErrno("fstat");
+        }
+
+        // Nothing to map, mmap refuses a zero length anyway
+        const size_t size = info.st_size;
+        if (size == 0)
+        {
+            ::close(file);
+            return nullptr;
+        }
+
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+        ::close(file);
+        if (data == MAP_FAILED)
+            util::throwErrno("mmap");
+
+        ::madvise(data, size, advice);
+        return std::unique_ptr<MappedFile>(new MappedFile(static_cast<const std::uint8_t*>(data), size));
+    }
+
+    MappedFile::MappedFile(const std::uint8_t* data, size_t size)
+        : m_data(data),
+        m_size(size)
+    {
+    }
+
+    MappedFile::~MappedFile()
+    {
+        ::munmap(const_cast<std::uint8_t*>(m_data), m_size);
+    }
+}
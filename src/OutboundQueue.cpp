@@ -0,0 +1,149 @@
+#include "OutboundQueue.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+
+#include "BufferPool.h"
+
+namespace mc
+{
+    OutboundQueue::OutboundQueue(size_t limit)
+        : m_segments(),
+        m_offset(0),
+        m_size(0),
+        m_limit(limit),
+        m_corks(0)
+    {
+    }
+
+    bool OutboundQueue::Push(std::span<const std::uint8_t> data)
+    {
+        if (data.empty())
+            return !IsFull();
+
+        if (data.size() >= COALESCE_SIZE)
+        {
+            auto copy = pool::acquire(data.size());
+            copy.assign(data.begin(), data.end());
+            return Push(std::move(copy));
+        }
+
+        // The capacity is reserved up front so appending never moves bytes a gathered iovec points to
+        if (m_segments.empty() || !m_segments.back().open ||
+            m_segments.back().owned.capacity() - m_segments.back().owned.size() < data.size())
+        {
+            Segment segment{ pool::acquire(SEGMENT_SIZE), nullptr, nullptr, 0, true };
+            segment.data = segment.owned.data();
+            m_segments.push_back(std::move(segment));
+        }
+
+        Segment& back = m_segments.back();
+        back.owned.insert(back.owned.end(), data.begin(), data.end());
+        back.size = back.owned.size();
+        m_size += data.size();
+        return !IsFull();
+    }
+
+    bool OutboundQueue::Push(std::vector<std::uint8_t>&& data)
+    {
+        if (data.size() < COALESCE_SIZE)
+        {
+            const bool accepted = Push(std::span<const std::uint8_t>(data));
+            pool::release(std::move(data));
+            return accepted;
+        }
+
+        Segment segment{ std::move(data), nullptr, nullptr, 0, false };
+        segment.data = segment.owned.data();
+        segment.size = segment.owned.size();
+        return Append(std::move(segment));
+    }
+
+    bool OutboundQueue::PushBorrowed(std::span<const std::uint8_t> data)
+    {
+        if (data.empty())
+            return !IsFull();
+        return Append({ {}, nullptr, data.data(), data.size(), false });
+    }
+
+    bool OutboundQueue::PushShared(std::shared_ptr<const std::vector<std::uint8_t>> data)
+    {
+        if (data == nullptr || data->empty())
+            return !IsFull();
+
+        const std::uint8_t* bytes = data->data();
+        const size_t size         = data->size();
+        return Append({ {}, std::move(data), bytes, size, false });
+    }
+
+    size_t OutboundQueue::Gather(std::span<iovec> out) const
+    {
+        size_t count  = 0;
+        size_t offset = m_offset;
+        for (auto it = m_segments.begin(); it != m_segments.end() && count < out.size(); ++it, ++count)
+        {
+            out[count].iov_base = const_cast<std::uint8_t*>(it->data + offset);
+            out[count].iov_len  = it->size - offset;
+            offset = 0;
+        }
+        return count;
+    }
+
+    void OutboundQueue::Consume(size_t bytes)
+    {
+        m_size -= bytes;
+        while (bytes > 0)
+        {
+            Segment& front        = m_segments.front();
+            const size_t fromThis = std::min(bytes, front.size - m_offset);
+            m_offset += fromThis;
+            bytes    -= fromThis;
+
+            if (m_offset == front.size)
+            {
+                pool::release(std::move(front.owned));
+                m_segments.pop_front();
+                m_offset = 0;
+            }
+        }
+    }
+
+    OutboundQueue::FlushResult OutboundQueue::Flush(int fd)
+    {
+        if (IsCorked())
+            return FlushResult::CORKED;
+
+        std::array<iovec, MAX_IOVECS> iovecs;
+        while (!Empty())
+        {
+            msghdr message{};
+            message.msg_iov    = iovecs.data();
+            message.msg_iovlen = Gather(iovecs);
+
+            const ssize_t sent = ::sendmsg(fd, &message, MSG_NOSIGNAL);
+            if (sent >= 0)
+            {
+                Consume(sent);
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return FlushResult::BLOCKED;
+            if (errno != EINTR)
+                return FlushResult::FAILED;
+        }
+        return FlushResult::DONE;
+    }
+
+    //Private
+
+    bool OutboundQueue::Append(Segment segment)
+    {
+        m_size += segment.size;
+        m_segments.push_back(std::move(segment));
+        return !IsFull();
+    }
+}
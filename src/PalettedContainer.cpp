@@ -0,0 +1,468 @@
+#include "PalettedContainer.h"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <utility>
+
+#include "BlockState.h"
+#include "Registry.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MC_X86_SIMD 1
+#endif
+
+namespace mc
+{
+    namespace
+    {
+        // Kernels read and write up to a long worth of entries (plus a partial vector) past the end
+        constexpr size_t PADDING = 128;
+        using Scratch = std::array<std::uint32_t, PalettedContainer::BLOCK_STATE_COUNT + PADDING>;
+
+        // count entries of Bits each, out needs PADDING entries of room past count
+        using UnpackFunction = void (*)(const std::uint64_t* data, size_t count, std::uint32_t* out) noexcept;
+        // in has to be zero for PADDING entries past count
+        using PackFunction   = void (*)(const std::uint32_t* in, size_t count, std::uint64_t* data) noexcept;
+
+        // Lookup table of Assign, four times the largest indirect palette so probes stay short
+        constexpr size_t PALETTE_SLOTS = PalettedContainer::MAX_PALETTE_SIZE * 4;
+
+        constexpr size_t slotOf(int value)
+        {
+            return std::uint32_t(value) * 0x9e3779b1u >> (32 - std::countr_zero(PALETTE_SLOTS));
+        }
+
+        constexpr size_t longsFor(size_t count, unsigned bits)
+        {
+            const size_t perLong = 64 / bits;
+            return (count + perLong - 1) / perLong;
+        }
+
+        // The width is a template argument so the inner loop is fully unrolled with constant shifts
+        template<unsigned Bits>
+        void unpackScalar(const std::uint64_t* data, size_t count, std::uint32_t* out) noexcept
+        {
+            constexpr unsigned PER_LONG = 64 / Bits;
+            constexpr std::uint64_t MASK = (std::uint64_t(1) << Bits) - 1;
+            for (size_t i = 0; i < count; i += PER_LONG, ++data)
+            {
+                const std::uint64_t word = *data;
+                for (unsigned j = 0; j < PER_LONG; ++j)
+                    out[i + j] = std::uint32_t(word >> (j * Bits) & MASK);
+            }
+        }
+
+        template<unsigned Bits>
+        void packScalar(const std::uint32_t* in, size_t count, std::uint64_t* data) noexcept
+        {
+            constexpr unsigned PER_LONG = 64 / Bits;
+            for (size_t i = 0; i < count; i += PER_LONG, ++data)
+            {
+                std::uint64_t word = 0;
+                for (unsigned j = 0; j < PER_LONG; ++j)
+                    word |= std::uint64_t(in[i + j]) << (j * Bits);
+                *data = word;
+            }
+        }
+
+#ifdef MC_X86_SIMD
+        // Shift of every entry of a long, grouped by 4 for the 64 bit lanes. Lanes past the last
+        // entry shift by 64 which variable shifts turn into 0
+        template<unsigned Bits>
+        constexpr auto laneShifts()
+        {
+            constexpr unsigned PER_LONG = 64 / Bits;
+            std::array<std::uint64_t, (PER_LONG + 3) / 4 * 4> shifts{};
+            for (size_t i = 0; i < shifts.size(); ++i)
+                shifts[i] = i < PER_LONG ? i * Bits : 64;
+            return shifts;
+        }
+
+        // Every long is broadcast and shifted into 4 lanes at once, the lanes are narrowed to 32 bits
+        template<unsigned Bits>
+        __attribute__((target("avx2"))) void unpackAvx2(const std::uint64_t* data, size_t count, std::uint32_t* out) noexcept
+        {
+            constexpr unsigned PER_LONG = 64 / Bits;
+            static constexpr auto SHIFTS = laneShifts<Bits>();
+            constexpr size_t GROUPS = SHIFTS.size() / 4;
+
+            const __m256i mask   = _mm256_set1_epi64x((std::uint64_t(1) << Bits) - 1);
+            const __m256i narrow = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+            for (size_t i = 0; i < count; i += PER_LONG, ++data)
+            {
+                const __m256i word = _mm256_set1_epi64x(*data);
+                for (size_t group = 0; group < GROUPS; ++group)
+                {
+                    const __m256i shift  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(SHIFTS.data() + group * 4));
+                    const __m256i values = _mm256_permutevar8x32_epi32(_mm256_and_si256(_mm256_srlv_epi64(word, shift), mask), narrow);
+                    // Lanes past the long spill into the next one's entries, it overwrites them
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + group * 4), _mm256_castsi256_si128(values));
+                }
+            }
+        }
+
+        template<unsigned Bits>
+        __attribute__((target("avx2"))) void packAvx2(const std::uint32_t* in, size_t count, std::uint64_t* data) noexcept
+        {
+            constexpr unsigned PER_LONG = 64 / Bits;
+            static constexpr auto SHIFTS = laneShifts<Bits>();
+            constexpr size_t GROUPS = SHIFTS.size() / 4;
+
+            for (size_t i = 0; i < count; i += PER_LONG, ++data)
+            {
+                __m256i word = _mm256_setzero_si256();
+                for (size_t group = 0; group < GROUPS; ++group)
+                {
+                    const __m256i shift  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(SHIFTS.data() + group * 4));
+                    const __m256i values = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + group * 4)));
+                    word = _mm256_or_si256(word, _mm256_sllv_epi64(values, shift));
+                }
+                __m128i half = _mm_or_si128(_mm256_castsi256_si128(word), _mm256_extracti128_si256(word, 1));
+                half = _mm_or_si128(half, _mm_unpackhi_epi64(half, half));
+                *data = std::uint64_t(_mm_cvtsi128_si64(half));
+            }
+        }
+#endif
+
+        // Flags of the palette indices of 4 bit entries summed up, data is a whole number of longs
+        using CountFunction = size_t (*)(std::span<const std::uint64_t> data, const std::uint8_t* matches) noexcept;
+
+        size_t countNibblesScalar(std::span<const std::uint64_t> data, const std::uint8_t* matches) noexcept
+        {
+            size_t count = 0;
+            for (std::uint64_t word : data)
+            {
+                for (unsigned j = 0; j < 16; ++j, word >>= 4)
+                    count += matches[word & 0xf];
+            }
+            return count;
+        }
+
+#ifdef MC_X86_SIMD
+        // Each nibble is looked up in a 16 byte table with pshufb and the flags are summed with psadbw,
+        // the entries are never unpacked
+        __attribute__((target("avx2"))) size_t countNibblesAvx2(std::span<const std::uint64_t> data, const std::uint8_t* matches) noexcept
+        {
+            const __m256i table  = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(matches)));
+            const __m256i nibble = _mm256_set1_epi8(0x0f);
+            __m256i sums = _mm256_setzero_si256();
+
+            size_t i = 0;
+            for (; i + 4 <= data.size(); i += 4)
+            {
+                const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data.data() + i));
+                const __m256i low   = _mm256_shuffle_epi8(table, _mm256_and_si256(bytes, nibble));
+                const __m256i high  = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble));
+                sums = _mm256_add_epi64(sums, _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256()));
+            }
+
+            const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+            const size_t count = std::uint64_t(_mm_cvtsi128_si64(half)) + std::uint64_t(_mm_extract_epi64(half, 1));
+            return count + countNibblesScalar(data.subspan(i), matches);
+        }
+#endif
+
+        CountFunction pickCountNibbles() noexcept
+        {
+#ifdef MC_X86_SIMD
+            if (__builtin_cpu_supports("avx2"))
+                return countNibblesAvx2;
+#endif
+            return countNibblesScalar;
+        }
+
+        template<unsigned Bits>
+        UnpackFunction pickUnpack() noexcept
+        {
+            if constexpr (Bits == 0)
+                return nullptr;
+            else
+            {
+#ifdef MC_X86_SIMD
+                if (__builtin_cpu_supports("avx2"))
+                    return unpackAvx2<Bits>;
+#endif
+                return unpackScalar<Bits>;
+            }
+        }
+
+        template<unsigned Bits>
+        PackFunction pickPack() noexcept
+        {
+            if constexpr (Bits == 0)
+                return nullptr;
+            else
+            {
+#ifdef MC_X86_SIMD
+                if (__builtin_cpu_supports("avx2"))
+                    return packAvx2<Bits>;
+#endif
+                return packScalar<Bits>;
+            }
+        }
+
+        // Indexed by bits
+        void unpack(unsigned bits, std::span<const std::uint64_t> data, size_t count, std::uint32_t* out) noexcept
+        {
+            static const auto table = []<unsigned... Bits>(std::integer_sequence<unsigned, Bits...>)
+            {
+                return std::array<UnpackFunction, sizeof...(Bits)>{ pickUnpack<Bits>()... };
+            }(std::make_integer_sequence<unsigned, PalettedContainer::MAX_BITS + 1>{});
+            table[bits](data.data(), count, out);
+        }
+
+        void pack(unsigned bits, std::uint32_t* in, size_t count, std::vector<std::uint64_t>& data)
+        {
+            static const auto table = []<unsigned... Bits>(std::integer_sequence<unsigned, Bits...>)
+            {
+                return std::array<PackFunction, sizeof...(Bits)>{ pickPack<Bits>()... };
+            }(std::make_integer_sequence<unsigned, PalettedContainer::MAX_BITS + 1>{});
+
+            std::fill_n(in + count, PADDING, 0);
+            data.resize(longsFor(count, bits));
+            table[bits](in, count, data.data());
+        }
+    }
+
+    PalettedContainer::PalettedContainer(size_t size, unsigned minBits, unsigned maxBits, unsigned directBits, int value)
+        : m_size(size),
+        m_minBits(minBits),
+        m_maxBits(maxBits),
+        m_directBits(directBits),
+        m_bits(0),
+        m_mask(0),
+        m_palette({ value }),
+        m_data()
+    {
+        if (size > BLOCK_STATE_COUNT || (size_t(1) << maxBits) > MAX_PALETTE_SIZE || directBits <= maxBits || directBits > MAX_BITS)
+            throw std::out_of_range(std::format("Invalid paletted container of {} entries, {} direct bits", size, directBits));
+    }
+
+    int PalettedContainer::Set(size_t index, int value)
+    {
+        if (IsDirect())
+            return int(SetRaw(index, value));
+
+        auto it = std::ranges::find(m_palette, value);
+        if (it != m_palette.end() && m_bits == 0)
+            return value;
+
+        if (it == m_palette.end())
+        {
+            if (m_palette.size() >= (size_t(1) << m_bits))
+            {
+                const unsigned bits = std::max(m_bits + 1, m_minBits);
+                Resize(bits > m_maxBits ? m_directBits : bits);
+                if (IsDirect())
+                    return int(SetRaw(index, value));
+            }
+            m_palette.push_back(value);
+            it = m_palette.end() - 1;
+        }
+        return m_palette[SetRaw(index, it - m_palette.begin())];
+    }
+
+    void PalettedContainer::Fill(int value)
+    {
+        m_bits = 0;
+        m_mask = 0;
+        m_palette.assign({ value });
+        m_data.clear();
+    }
+
+    void PalettedContainer::Unpack(std::span<int> out) const
+    {
+        if (out.size() != m_size)
+            throw std::out_of_range(std::format("Unpacking {} entries into {}", m_size, out.size()));
+
+        if (m_bits == 0)
+        {
+            std::ranges::fill(out, m_palette.front());
+            return;
+        }
+
+        Scratch raw;
+        unpack(m_bits, m_data, m_size, raw.data());
+        if (IsDirect())
+            std::ranges::copy(std::span(raw).first(m_size), out.begin());
+        else
+            std::ranges::transform(std::span(raw).first(m_size), out.begin(), [this](std::uint32_t index) { return m_palette[index]; });
+    }
+
+    void PalettedContainer::Assign(std::span<const int> values)
+    {
+        if (values.size() != m_size)
+            throw std::out_of_range(std::format("Assigning {} entries to {}", values.size(), m_size));
+
+        // Runs of the same value are the common case, the last index found is tried first.
+        // Anything else goes through a small open addressing table of palette index + 1
+        const size_t maxPalette = size_t(1) << m_maxBits;
+        std::array<std::uint16_t, PALETTE_SLOTS> slots{};
+        std::vector<int> palette;
+        Scratch raw;
+        size_t last = 0;
+        for (size_t i = 0; i < m_size && palette.size() <= maxPalette; ++i)
+        {
+            const int value = values[i];
+            if (palette.empty() || palette[last] != value)
+            {
+                size_t slot = slotOf(value);
+                while (slots[slot] != 0 && palette[slots[slot] - 1] != value)
+                    slot = (slot + 1) % PALETTE_SLOTS;
+                if (slots[slot] == 0)
+                {
+                    palette.push_back(value);
+                    slots[slot] = palette.size();
+                }
+                last = slots[slot] - 1;
+            }
+            raw[i] = last;
+        }
+
+        if (palette.size() == 1)
+            return Fill(palette.front());
+
+        if (palette.size() > maxPalette)
+        {
+            std::ranges::copy(values, raw.begin());
+            m_palette.clear();
+            m_bits = m_directBits;
+        }
+        else
+        {
+            m_palette = std::move(palette);
+            m_bits    = std::max(BitsFor(m_palette.size()), m_minBits);
+        }
+        m_mask = (std::uint32_t(1) << m_bits) - 1;
+        pack(m_bits, raw.data(), m_size, m_data);
+    }
+
+    PalettedContainer PalettedContainer::LoadBlockStates(const NBT::LazyTag& blockStates, const BlockStateRegistry& registry)
+    {
+        std::vector<int> palette;
+        for (const NBT::LazyTag& entry : PaletteOf(blockStates))
+        {
+            const auto name = entry.Find("Name");
+            if (!name.has_value())
+                throw std::runtime_error("Block state without a name");
+
+            const Identifier block(name->Get<NBT::String>());
+            BlockState state(block);
+            if (const auto properties = entry.Find("Properties"); properties.has_value())
+            {
+                for (const NBT::LazyTag& property : properties->Children())
+                    state.AddProperty(property.Name(), std::string(property.Get<NBT::String>()));
+            }
+
+            // A value this version doesn't have falls back to the block's default state
+            auto id = registry.GetBlockStateId(state);
+            if (!id.has_value())
+                id = registry.GetDefaultStateId(block);
+            if (!id.has_value())
+                throw std::runtime_error(std::format("Unknown block {}", block.View()));
+            palette.push_back(*id);
+        }
+
+        PalettedContainer container = BlockStates(BitsFor(registry.StateCount()));
+        container.Load(std::move(palette), blockStates);
+        return container;
+    }
+
+    //Private
+
+    size_t PalettedContainer::CountMatching(std::span<const std::uint8_t, MAX_PALETTE_SIZE> matches) const
+    {
+        // 4 bits is what most block sections use, 16 entries fill each long exactly
+        if (m_bits == 4 && m_size % 16 == 0)
+        {
+            static const CountFunction countNibbles = pickCountNibbles();
+            return countNibbles(m_data, matches.data());
+        }
+
+        Scratch raw;
+        unpack(m_bits, m_data, m_size, raw.data());
+        size_t count = 0;
+        for (size_t i = 0; i < m_size; ++i)
+            count += matches[raw[i]];
+        return count;
+    }
+
+    std::vector<NBT::LazyTag> PalettedContainer::PaletteOf(const NBT::LazyTag& container)
+    {
+        const auto palette = container.Find("palette");
+        if (!palette.has_value() || palette->Type() != NBT::TagType::LIST)
+            throw std::runtime_error(std::format("{} has no palette", container.Name()));
+        return palette->Children();
+    }
+
+    void PalettedContainer::Load(std::vector<int> palette, const NBT::LazyTag& container)
+    {
+        if (palette.empty())
+            throw std::runtime_error(std::format("{} has an empty palette", container.Name()));
+        if (palette.size() == 1)
+            return Fill(palette.front());
+
+        // Region files use the same widths as the packet, only the direct one differs
+        const unsigned bits = std::max(BitsFor(palette.size()), m_minBits);
+        const auto dataTag  = container.Find("data");
+        if (!dataTag.has_value())
+            throw std::runtime_error(std::format("{} has a palette but no data", container.Name()));
+        const auto data = dataTag->Get<NBT::LongArray>();
+        if (data.size() != longsFor(m_size, bits))
+            throw std::runtime_error(std::format("{} holds {} longs, {} expected", container.Name(), data.size(), longsFor(m_size, bits)));
+
+        const std::span<const std::uint64_t> words(reinterpret_cast<const std::uint64_t*>(data.data()), data.size());
+        Scratch raw;
+        unpack(bits, words, m_size, raw.data());
+        if (std::ranges::any_of(std::span(raw).first(m_size), [&](std::uint32_t index) { return index >= palette.size(); }))
+            throw std::runtime_error(std::format("{} indexes past its palette", container.Name()));
+
+        if (bits <= m_maxBits)
+        {
+            m_palette = std::move(palette);
+            m_bits    = bits;
+            m_data.assign(words.begin(), words.end());
+        }
+        else
+        {
+            for (size_t i = 0; i < m_size; ++i)
+                raw[i] = palette[raw[i]];
+            m_palette.clear();
+            m_bits = m_directBits;
+            pack(m_bits, raw.data(), m_size, m_data);
+        }
+        m_mask = (std::uint32_t(1) << m_bits) - 1;
+    }
+
+    void PalettedContainer::Resize(unsigned bits)
+    {
+        Scratch raw;
+        if (m_bits == 0)
+            std::fill_n(raw.begin(), m_size, 0);
+        else
+            unpack(m_bits, m_data, m_size, raw.data());
+
+        if (bits > m_maxBits)
+        {
+            for (size_t i = 0; i < m_size; ++i)
+                raw[i] = m_palette[raw[i]];
+            m_palette.clear();
+        }
+        m_bits = bits;
+        m_mask = (std::uint32_t(1) << bits) - 1;
+        pack(bits, raw.data(), m_size, m_data);
+    }
+
+    std::uint32_t PalettedContainer::SetRaw(size_t index, std::uint32_t raw)
+    {
+        const size_t perLong = 64 / m_bits;
+        const unsigned shift = index % perLong * m_bits;
+        std::uint64_t& word  = m_data[index / perLong];
+
+        const std::uint32_t old = std::uint32_t(word >> shift) & m_mask;
+        word = (word & ~(std::uint64_t(m_mask) << shift)) | std::uint64_t(raw) << shift;
+        return old;
+    }
+}
@@ -1,16 +1,20 @@
-#include <SFW/Connection.h>
 #include <SFW/LoggerManager.h>
 #include <bit>
 #include <bits/stdint-uintn.h>
 #include <chrono>
+#include <cmath>
 #include <ranges>
 #include <ratio>
+#include <mutex>
+#include <span>
 #include <thread>
 #include <algorithm>
 #include <vector>
 
 #include "BlockState.h"
+#include "BufferPool.h"
 #include "ClientPackets.h"
+#include "Compression.h"
 #include "PlayerHandler.h"
 #include "DataTypes/BitSet.h"
 #include "DataTypes/Identifier.h"
@@ -24,299 +28,298 @@
 
 namespace mc
 {
-    PlayerHandler::PlayerHandler(iu::Connection& client, const ServerContext& context)
+    PlayerHandler::PlayerHandler(ClientConnection& client, const ServerContext& context)
         : m_client(client),
         m_state(PlayerHandlerState::IDLE),
-        m_context(context)
+        m_compressed(false),
+        m_inflated(),
+        m_context(context),
+        m_lastPositionSync(),
+        m_x(SPAWN_X),
+        m_y(SPAWN_Y),
+        m_z(SPAWN_Z),
+        m_view(VIEW_DISTANCE),
+        m_batcher(std::chrono::steady_clock::now())
     { 
     }
 
-    void PlayerHandler::Execute(const std::vector<uint8_t>& packets)
+    void PlayerHandler::Execute(std::span<const uint8_t> frame)
     {
-        auto packetsIter = packets.begin();
-        Packet::PacketPtr packet;
+        if (m_compressed)
+            frame = compression::decompressFrame(frame, m_inflated);
 
-        while(true)
-        {
-            switch(m_state)
-            {
-                case PlayerHandlerState::IDLE:
-                    packet = NextPacketIdle(packetsIter);
-                    if(packet == nullptr)
-                        return;
-                    OnIdle(std::move(packet));
-                    break;
-                case PlayerHandlerState::STATUS:
-                    packet = NextPacketStatus(packetsIter);
-                    if(packet == nullptr)
-                        return;
-                    OnStatus(std::move(packet));
-                    break;
-                case PlayerHandlerState::LOGIN:
-                    packet = NextPacketLogin(packetsIter);
-                    if(packet == nullptr)
-                        return;
-                    OnLogin(std::move(packet));
-                    break;
-                case PlayerHandlerState::CONFIG:
-                    packet = NextPacketConfig(packetsIter);
-                    if(packet == nullptr)
-                        return;
-                    OnConfig(std::move(packet));
-                    break;
-                case PlayerHandlerState::PLAY:
-                    packet = NextPacketPlay(packetsIter);
-                    if(packet == nullptr)
-                        return;
-                    OnPlay(std::move(packet));
-                    break;
-                default:
-                    SFW_LOG_WARN("PlayerHandler", "State is unknown");
-                    return;
-            }
-        }
-    
-    }
+        size_t position    = 0;
+        const int packetID = util::readVarInt(frame, position);
+        const auto payload = frame.subspan(position);
+        const auto handle  = [this](const auto& packet) { OnPacket(packet); };
 
-    void PlayerHandler::OnIdle(Packet::PacketPtr&& genericPacket)
-    {
-        switch(genericPacket->GetId<client::IdlePacketID>())
+        switch(m_state)
         {
-            case client::IdlePacketID::HANDSHAKE:
-            {
-                mc::client::HandshakePacket* packet = (mc::client::HandshakePacket*)genericPacket.get();  
-                SFW_LOG_DEBUG("PlayerHandler", "{}", *packet);
-                switch (packet->GetNextState())
-                {
-                    case 2:
-                        SFW_LOG_INFO("PlayerHandler", "Login request");
-                        m_state = PlayerHandlerState::LOGIN;
-                        break;
-                    case 1:
-                        SFW_LOG_INFO("PlayerHandler", "Status request");
-                        m_state = PlayerHandlerState::STATUS;
-                        break;
-                    default:
-                        SFW_LOG_WARN("PlayerHandler", "Unknown next state {}", packet->GetNextState());
-                        break;
-                }
+            case PlayerHandlerState::IDLE:
+                if (!client::IdlePackets::Dispatch(packetID, payload, handle))
+                    SFW_LOG_WARN("PlayerHandler", "Invalid idle packetID: {:0x}", packetID);
                 break;
-            }
-            default:
-                SFW_LOG_WARN("PlayerHandler", "Unknown packet ID: {}", genericPacket->GetId<int>());
+            case PlayerHandlerState::STATUS:
+                if (!client::StatusPackets::Dispatch(packetID, payload, handle))
+                    SFW_LOG_WARN("PlayerHandler", "Invalid status packetID: {:0x}", packetID);
+                break;
+            case PlayerHandlerState::LOGIN:
+                if (!client::LoginPackets::Dispatch(packetID, payload, handle))
+                    SFW_LOG_WARN("PlayerHandler", "Invalid login packetID: {:0x}", packetID);
+                break;
+            case PlayerHandlerState::CONFIG:
+                if (!client::ConfigPackets::Dispatch(packetID, payload, handle))
+                    SFW_LOG_WARN("PlayerHandler", "Invalid config packetID: {:0x}", packetID);
                 break;
+            case PlayerHandlerState::PLAY:
+                //Most play packets aren't handled yet, not worth a warning each
+                client::PlayPackets::Dispatch(packetID, payload, handle);
+                break;
+            default:
+                SFW_LOG_WARN("PlayerHandler", "State is unknown");
+                return;
         }
     }
 
-    void PlayerHandler::OnStatus(Packet::PacketPtr&& genericPacket)
+    // ########
+    // # Idle #
+    // ########
+
+    void PlayerHandler::OnPacket(const client::HandshakePacket& packet)
     {
-        switch (genericPacket->GetId<client::StatusPacketID>())
+        SFW_LOG_DEBUG("PlayerHandler", "{}", packet);
+        switch (packet.GetNextState())
         {
-            case client::StatusPacketID::STATUS:
-            {
-                m_client.Send(m_statusMessage);
-                SFW_LOG_DEBUG("PlayerHandler", "Status request sent");
+            case 2:
+                SFW_LOG_INFO("PlayerHandler", "Login request");
+                m_state = PlayerHandlerState::LOGIN;
                 break;
-            }
-            case client::StatusPacketID::PING:
-            {
-                client::PingRequest* packet = (client::PingRequest*)genericPacket.get();
-                SFW_LOG_DEBUG("PlayerHandler", "Ping request: {}", *packet);
-                std::vector<uint8_t> send;
-                util::writeVarInt(send, 1);
-                send.resize(9);
-                *(send.data() + 1) = packet->GetPayload();
-                util::writeVarInt(send, 0, send.size());
-                m_client.Send(send);
+            case 1:
+                SFW_LOG_INFO("PlayerHandler", "Status request");
+                m_state = PlayerHandlerState::STATUS;
                 break;
-            }
             default:
-                SFW_LOG_WARN("PlayerHandler", "Unknown packet ID: {}", genericPacket->GetId<int>());
+                SFW_LOG_WARN("PlayerHandler", "Unknown next state {}", packet.GetNextState());
                 break;
         }
     }
 
-    void PlayerHandler::OnLogin(Packet::PacketPtr&& genericPacket)
+    // ##########
+    // # Status #
+    // ##########
+
+    void PlayerHandler::OnPacket(const client::StatusRequestPacket&)
+    {
+        Send(m_statusMessage);
+        SFW_LOG_DEBUG("PlayerHandler", "Status request sent");
+    }
+
+    void PlayerHandler::OnPacket(const client::PingRequest& packet)
+    {
+        SFW_LOG_DEBUG("PlayerHandler", "Ping request: {}", packet);
+        Send(server::PongPacket(packet.GetPayload()));
+    }
+
+    // #########
+    // # Login #
+    // #########
+
+    void PlayerHandler::OnPacket(const client::LoginStartPacket& packet)
     {
-        switch (genericPacket->GetId<client::LoginPacketID>())
+        SFW_LOG_DEBUG("PlayerHandler", "{}", packet);
+        server::LoginSuccessPacket out(packet);
+        if (compression::enabled())
         {
-            case client::LoginPacketID::START:
-            {
-                client::LoginStartPacket* packet = (client::LoginStartPacket*) genericPacket.get();
-                SFW_LOG_DEBUG("PlayerHandler", "{}", *packet);
-                server::LoginSuccessPacket out(*packet);
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                m_client.Send(out);
-                SFW_LOG_DEBUG("PlayerHandler", "Success packet sent");
-                break;
-            }
-            case client::LoginPacketID::LoginAcknowledged:
-            {
-                SFW_LOG_INFO("PlayerHandler", "Login Acknowledged");
-                SFW_LOG_INFO("PlayerHandler", "Starting configuration");
-                m_state = PlayerHandlerState::CONFIG;
-                m_client.Send(server::KnownPacksPacket("minecraft", "core", "1.21.8"));
-                break;
-            }
-            default:
-                SFW_LOG_WARN("PlayerHandler", "Unknown packet ID: {}", genericPacket->GetId<int>());
-                break;
+            //Has to leave uncompressed, everything after it is compressed
+            Send(server::SetCompressionPacket(compression::threshold()));
+            m_compressed = true;
+            SFW_LOG_DEBUG("PlayerHandler", "Compression enabled, threshold {}", compression::threshold());
         }
+        Send(out);
+        SFW_LOG_DEBUG("PlayerHandler", "Success packet sent");
+    }
+
+    void PlayerHandler::OnPacket(const client::LoginAckPacket&)
+    {
+        SFW_LOG_INFO("PlayerHandler", "Login Acknowledged");
+        SFW_LOG_INFO("PlayerHandler", "Starting configuration");
+        m_state = PlayerHandlerState::CONFIG;
+        Send(server::KnownPacksPacket("minecraft", "core", "1.21.8"));
+    }
+
+    // ##########
+    // # Config #
+    // ##########
+
+    void PlayerHandler::OnPacket(const client::KnownPacksPacket& packet)
+    {
+        SFW_LOG_DEBUG("PlayerHandler", "{}", packet);
+
+        SFW_LOG_INFO("PlayerHandler", "Sending registry data ...");
+        SendRegistryPackets();
+        SFW_LOG_INFO("PlayerHandler", "Sending registry data ... DONE");
+        Send(server::FinishConfiguration());
+    }
+
+    void PlayerHandler::OnPacket(const client::AcknowledgeConfig&)
+    {
+        SFW_LOG_INFO("PlayerHandler", "ConfigAcknowledged switching to play state");
+        m_state = PlayerHandlerState::PLAY;
+        Send(server::LoginPlayPacket(VIEW_DISTANCE));
+        SFW_LOG_INFO("PlayerHandler", "Login(play) sent");
+        Send(server::GameEvent(server::GameEvent::Event::StartWaitingForChunks, 0));
+        SFW_LOG_INFO("PlayerHandler", "GameEvent with StartWaitingForChunks sent");
+
+        UpdateView();
+        SendPositionSync();
     }
 
-    void PlayerHandler::OnConfig(Packet::PacketPtr&& genericPacket)
+    // ########
+    // # Play #
+    // ########
+
+    void PlayerHandler::OnPacket(const client::ChunkBatchReceived& packet)
     {
-        switch (genericPacket->GetId<client::ConfigPacketID>())
+        m_batcher.OnBatchReceived(packet.GetChunksPerTick());
+        SFW_LOG_DEBUG("PlayerHandler", "Client wants {} chunks per tick", m_batcher.ChunksPerTick());
+        SendChunkBatch();
+    }
+
+    void PlayerHandler::OnPacket(const client::SetPlayerPosition& packet)
+    {
+        OnMove(packet.GetX(), packet.GetY(), packet.GetZ());
+    }
+
+    void PlayerHandler::OnPacket(const client::SetPlayerPositionAndRotation& packet)
+    {
+        OnMove(packet.GetX(), packet.GetY(), packet.GetZ());
+    }
+
+    // Coordinates come straight from the client
+    void PlayerHandler::OnMove(double x, double y, double z)
+    {
+        if (!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(z))
         {
-            case client::ConfigPacketID::KnownPacks:
-            {
-                SFW_LOG_DEBUG("PlayerHandler", "{}", *genericPacket);
+            SFW_LOG_WARN("PlayerHandler", "Ignoring move to {} {} {}", x, y, z);
+            return;
+        }
+        m_x = std::clamp(x, -ChunkPos::WORLD_BORDER, ChunkPos::WORLD_BORDER);
+        m_y = y;
+        m_z = std::clamp(z, -ChunkPos::WORLD_BORDER, ChunkPos::WORLD_BORDER);
+        UpdateView();
+    }
 
-                SFW_LOG_INFO("PlayerHandler", "Sending registry data ...");
-                for (const auto& registry : m_context.registry_packets)
-                    m_client.Send(registry);
-                SFW_LOG_INFO("PlayerHandler", "Sending registry data ... DONE");
-                m_client.Send(server::FinishConfiguration());
-                break;
-            }
-            case client::ConfigPacketID::AcknowledgeConfigEnd :
-            {
-                SFW_LOG_INFO("PlayerHandler", "ConfigAcknowledged switching to play state");
-                m_state = PlayerHandlerState::PLAY;
-                m_client.Send(server::LoginPlayPacket());
-                SFW_LOG_INFO("PlayerHandler", "Login(play) sent");
-                m_client.Send(server::GameEvent(server::GameEvent::Event::StartWaitingForChunks, 0));
-                SFW_LOG_INFO("PlayerHandler", "GameEvent with StartWaitingForChunks sent");
-
-                {
-                    std::vector<uint8_t> chunk_center = {3, 0x57,1 ,1};
-                    m_client.Send(chunk_center);
-                }
-
-                const auto& chunk = m_context.chunk_region[0][0].value();
-                const auto& world_surface = chunk->Get<NBT::NBTCompound>("Heightmaps")->Get<NBT::LongArray>("WORLD_SURFACE");
-                const auto& motion_blocking = chunk->Get<NBT::NBTCompound>("Heightmaps")->Get<NBT::LongArray>("MOTION_BLOCKING");
-                const auto& motion_blocking_no_leaves = chunk->Get<NBT::NBTCompound>("Heightmaps")->Get<NBT::LongArray>("MOTION_BLOCKING_NO_LEAVES");
-                const auto& sections = chunk->Get<NBT::NBTList>("sections");
-                for (int i : std::views::iota(0,16))
-                    for(int j : std::views::iota(0,16))
-                {
-                    std::vector<uint8_t> chunk_data;
-
-                    util::writeVarInt(chunk_data, 0x27); //ID
-                    
-                    util::IntSerializer().Serialize(chunk_data, i);
-                    util::IntSerializer().Serialize(chunk_data, j);
-                
-                    //3 heighetmaps
-                    util::writeVarInt(chunk_data, 3);
-                    
-                    //world surface map
-                    //type of map
-                    util::writeVarInt(chunk_data, 1);
-                    util::writeVarInt(chunk_data, world_surface.Get().size());
-                    iu::Serializer<std::vector<NBT::Long>>().Serialize(chunk_data, world_surface.Get());
-                    
-                    //motion_blocking map
-                    //type of map
-                    util::writeVarInt(chunk_data, 4);
-                    util::writeVarInt(chunk_data, motion_blocking.Get().size());
-                    iu::Serializer<std::vector<NBT::Long>>().Serialize(chunk_data, motion_blocking.Get());
-                
-                    //motion blocking no leaves map
-                    //type of map
-                    util::writeVarInt(chunk_data, 5);
-                    util::writeVarInt(chunk_data, motion_blocking_no_leaves.Get().size());
-                    iu::Serializer<std::vector<NBT::Long>>().Serialize(chunk_data, motion_blocking_no_leaves.Get());
-                
-                    std::vector<uint8_t> chunk_section_data;
-                    for (auto it = sections->begin(); it != sections->end(); it++)
-                    {
-                        //non air blocks
-                        util::ShortSerializer().Serialize(chunk_section_data, 10000);
-                    
-                        //Block states
-                        //0 bpe singled value palette
-                        util::writeVarInt(chunk_section_data, 0);
-                        //Value of the palette
-                        util::writeVarInt(chunk_section_data, 10);
-
-                        //Biomes
-                        //0 bpe singled value palette
-                        util::writeVarInt(chunk_section_data, 0);
-                        //Value of the palette
-                        util::writeVarInt(chunk_section_data, 10);
-                    }
-
-                    util::writeVarInt(chunk_data, chunk_section_data.size());
-                    iu::Serializer<decltype(chunk_section_data)>().Serialize(chunk_data, chunk_section_data);
-                    //Block entities
-                    util::writeVarInt(chunk_data, 0);
-                
-                    BitSet sky_light_mask(sections->Size() + 2);
-                    BitSet block_light_mask(sections->Size() + 2);
-                    BitSet empty_sky_light_mask(sections->Size()+ 2);
-                    BitSet empty_block_light_mask(sections->Size() + 2);
-                
-                    for (size_t idx : std::views::iota(0zu, sections->Size() + 2))
-                    {
-                        sky_light_mask.Set(idx, true);
-                        block_light_mask.Set(idx, true);
-                        empty_sky_light_mask.Set(idx, false);
-                        empty_block_light_mask.Set(idx, false);
-                    }
-                    BitSetSerializer().Serialize(chunk_data, sky_light_mask);
-                    BitSetSerializer().Serialize(chunk_data, block_light_mask);
-                    BitSetSerializer().Serialize(chunk_data, empty_sky_light_mask);
-                    BitSetSerializer().Serialize(chunk_data, empty_block_light_mask);
-                
-                    util::writeVarInt(chunk_data, sections->Size() + 2);
-                    for ([[maybe_unused]]size_t idx : std::views::iota(0zu, sections->Size() + 2))
-                    {
-                        util::writeVarInt(chunk_data, 2048);
-                        iu::Serializer<std::vector<uint8_t>>().Serialize(chunk_data, std::ranges::to<std::vector<uint8_t>>(std::views::repeat(0xee, 2048)));
-                    }
-                
-                    util::writeVarInt(chunk_data, sections->Size() + 2);
-                    for ([[maybe_unused]]size_t idx : std::views::iota(0zu, sections->Size() + 2))
-                    {
-                        util::writeVarInt(chunk_data, 2048);
-                        iu::Serializer<std::vector<uint8_t>>().Serialize(chunk_data, std::ranges::to<std::vector<uint8_t>>(std::views::repeat(0xee, 2048)));
-                    }
-                
-                    util::writeVarInt(chunk_data, 0, chunk_data.size());
-                
-                    m_client.Send(chunk_data);
-                    SFW_LOG_INFO("PlayerHandler", "Chunk Data Sent {} {}", i, j);
-                }
-                for (;;)
-                {
-                    SFW_LOG_INFO("PlayerHandler", "Sent sync packet");
-                    m_client.Send(server::SynchronisePlayerPosition(0, 30, 320, 30, 0, 0, 0, 0, 0, 0));
-                    std::this_thread::sleep_for(std::chrono::seconds(10));
-                }
-                break;
-            }
-            default:
+    void PlayerHandler::Tick()
+    {
+        if (m_state != PlayerHandlerState::PLAY)
+            return;
+
+        SendChunkBatch();
+        if (std::chrono::steady_clock::now() - m_lastPositionSync >= POSITION_SYNC_INTERVAL)
+            SendPositionSync();
+    }
+
+    void PlayerHandler::PlayLoop(const std::atomic_bool& stop, std::mutex& mutex)
+    {
+        while (!stop)
+        {
             {
-                SFW_LOG_WARN("PlayerHandler", "Unknown packet ID: {}", genericPacket->GetId<int>());
-                break;
+                std::lock_guard lock(mutex);
+                if (m_state != PlayerHandlerState::PLAY)
+                    return;
+                m_client.Cork();
+                Tick();
+                m_client.Uncork();
             }
+            std::this_thread::sleep_for(TICK_INTERVAL);
         }
     }
 
-    void PlayerHandler::OnPlay(Packet::PacketPtr&& genericPacket)
+    void PlayerHandler::SendPositionSync()
+    {
+        SFW_LOG_INFO("PlayerHandler", "Sent sync packet");
+        Send(server::SynchronisePlayerPosition(0, m_x, m_y, m_z, 0, 0, 0, 0, 0, 0));
+        m_lastPositionSync = std::chrono::steady_clock::now();
+    }
+
+    void PlayerHandler::Send(std::vector<std::uint8_t>&& frames)
     {
-        switch (genericPacket->GetId<client::PlayPacketID>())
+        if (m_compressed)
         {
+            m_client.Send(compression::compressFrames(frames));
+            pool::release(std::move(frames));
+        }
+        else
+            m_client.Send(std::move(frames));
+    }
 
-            default:
-                SFW_LOG_WARN("PlayerHandler", "Unknown packet ID:{}", genericPacket->GetId<int>());
+    // Only crossing a chunk border changes anything
+    void PlayerHandler::UpdateView()
+    {
+        const ChunkPos center = ChunkPos::At(m_x, m_z);
+        if (m_view.IsCentered() && center == m_view.Center())
+            return;
+
+        const std::vector<ChunkPos> unload = m_view.Move(center);
+        Send(server::SetCenterChunk(center.x, center.z));
+        for (const ChunkPos chunk : unload)
+            Send(server::ForgetLevelChunk(chunk.x, chunk.z));
+
+        SendChunkBatch();
+        SFW_LOG_DEBUG("PlayerHandler", "View centered on {} {}, {} chunks forgotten", center.x, center.z, unload.size());
+    }
+
+    // Nearest first so the chunk the player stands in arrives before anything else.
+    // Chunks that don't exist cost no token
+    void PlayerHandler::SendChunkBatch()
+    {
+        if (!m_view.HasPending())
+            return;
+        const size_t available = m_batcher.Available(std::chrono::steady_clock::now());
+        if (available == 0)
+            return;
+
+        Send(server::ChunkBatchStart());
+        size_t sent = 0;
+        for (size_t examined = 0; sent < available && examined < LOOKUPS_PER_CHUNK * available; ++examined)
+        {
+            const auto chunk = m_view.Next();
+            if (!chunk.has_value())
                 break;
+            if (SendChunk(chunk->x, chunk->z))
+                ++sent;
         }
+
+        // Answered even when empty, so it counts like any other
+        Send(server::ChunkBatchFinished(int(sent)));
+        m_batcher.OnBatchSent(sent);
+    }
+
+    // Every player in range gets the same cached buffer
+    bool PlayerHandler::SendChunk(int x, int z)
+    {
+        const auto chunk = m_context.chunk_packets.Get(x, z);
+        if (chunk == nullptr)
+        {
+            // Past the edge of the generated world, common at the border of the view
+            SFW_LOG_DEBUG("PlayerHandler", "No chunk at {} {}", x, z);
+            return false;
+        }
+
+        // Aliasing pointers, the cache entry stays alive as long as either format is queued
+        if (m_compressed)
+            m_client.SendShared(std::shared_ptr<const std::vector<std::uint8_t>>(chunk, &chunk->compressed));
+        else
+            m_client.SendShared(std::shared_ptr<const std::vector<std::uint8_t>>(chunk, &chunk->frame));
+        SFW_LOG_INFO("PlayerHandler", "Chunk Data Sent {} {}", x, z);
+        return true;
     }
 
-    void PlayerHandler::PlayLoop()
+    // Prebuilt in both formats, so they are never copied nor compressed per player
+    void PlayerHandler::SendRegistryPackets()
     {
+        const auto& packets = m_compressed ? m_context.compressed_registry_packets : m_context.registry_packets;
+        for (const auto& registry : packets)
+            m_client.SendPrebuilt(registry);
     }
 }
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "RegionManager.h"
+
+#include <SFW/LoggerManager.h>
+#include <algorithm>
+#include <stdexcept>
+#include <sys/mman.h>
+
+#include "Compression.h"
+#include "utils.h"
+
+namespace mc
+{
+    namespace
+    {
+        enum class ChunkCompression : std::uint8_t
+        {
+            GZIP         = 1,
+            ZLIB         = 2,
+            UNCOMPRESSED = 3
+        };
+        // Set on the compression type when the chunk lives in a separate .mcc file
+        constexpr std::uint8_t EXTERNAL_CHUNK_FLAG = 0x80;
+
+        std::uint32_t readBigEndian(const std::uint8_t* data, size_t bytes)
+        {
+            std::uint32_t value = 0;
+            for (size_t i = 0; i < bytes; ++i)
+                value = (value << 8) | data[i];
+            return value;
+        }
+
+        NBT::LazyDocument decodeChunk(ChunkCompression compression, std::span<const std::uint8_t> payload)
+        {
+            if (compression == ChunkCompression::UNCOMPRESSED)
+                return NBT::LazyDocument(std::vector<std::uint8_t>(payload.begin(), payload.end()));
+
+            // gzip and zlib are told apart by their header
+            return NBT::LazyDocument(compression::inflateStream(payload));
+        }
+
+        int floorDiv(int value, int divisor)
+        {
+            return (value >= 0 ? value : value - divisor + 1) / divisor;
+        }
+    }
+
+    // ##############
+    // # RegionFile #
+    // ##############
+
+    std::unique_ptr<RegionFile> RegionFile::Open(const std::filesystem::path& path)
+    {
+        // Chunks are looked up all over the file, the kernel's read ahead would only waste memory
+        auto file = MappedFile::Open(path, MADV_RANDOM);
+        if (file == nullptr)
+            return nullptr;
+
+        // Freshly created regions can be empty, there is nothing to read in them anyway
+        if (file->Size() < HEADER_SIZE)
+        {
+            SFW_LOG_WARN("RegionFile", "Ignoring {}, only {} bytes", path.string(), file->Size());
+            return nullptr;
+        }
+        return std::unique_ptr<RegionFile>(new RegionFile(path, std::move(file)));
+    }
+
+    RegionFile::RegionFile(std::filesystem::path path, std::unique_ptr<MappedFile> file)
+        : m_path(std::move(path)),
+        m_file(std::move(file)),
+        m_data(m_file->Data().data()),
+        m_size(m_file->Size())
+    {
+    }
+
+    std::optional<std::pair<std::uint8_t, std::span<const std::uint8_t>>> RegionFile::ChunkData(int localX, int localZ) const
+    {
+        // 3 byte big endian sector offset followed by the sector count
+        const std::uint8_t* entry = m_data + 4 * ((localX & 31) + (localZ & 31) * CHUNKS_PER_SIDE);
+        const size_t offset       = readBigEndian(entry, 3) * SECTOR_SIZE;
+        const size_t sectors      = entry[3];
+
+        if (offset == 0 && sectors == 0)
+            return {};
+
+        if (offset < HEADER_SIZE || offset + 5 > m_size)
+        {
+            SFW_LOG_WARN("RegionFile", "Chunk {} {} of {} points outside the file", localX, localZ, m_path.string());
+            return {};
+        }
+
+        // The length counts the compression type byte
+        const size_t length = readBigEndian(m_data + offset, 4);
+        if (length == 0 || offset + 4 + length > m_size)
+        {
+            SFW_LOG_WARN("RegionFile", "Chunk {} {} of {} has a bad length {}", localX, localZ, m_path.string(), length);
+            return {};
+        }
+
+        return std::pair{ m_data[offset + 4], std::span(m_data + offset + 5, length - 1) };
+    }
+
+    // #################
+    // # RegionManager #
+    // #################
+
+    RegionManager::RegionManager(std::filesystem::path directory, size_t cacheCapacity)
+        : m_directory(std::move(directory)),
+        m_shardCapacity(std::max<size_t>((cacheCapacity + SHARD_COUNT - 1) / SHARD_COUNT, 1)),
+        m_regionsMutex(),
+        m_regionLru(),
+        m_regions(),
+        m_shards()
+    {
+    }
+
+    RegionManager::ChunkHandle RegionManager::GetChunk(int x, int z) const
+    {
+        const std::uint64_t key = Key(x, z);
+        Shard& shard = ShardOf(key);
+        std::uint64_t generation = 0;
+        {
+            std::lock_guard lock(shard.mutex);
+            if (const auto it = shard.chunks.find(key); it != shard.chunks.end())
+            {
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                return it->second->second;
+            }
+            generation = shard.generation;
+        }
+
+        // Decoded without holding the lock, if two threads race the first one to insert wins
+        ChunkHandle chunk = Load(x, z);
+        if (chunk == nullptr)
+            return nullptr;
+
+        std::lock_guard lock(shard.mutex);
+        if (const auto it = shard.chunks.find(key); it != shard.chunks.end())
+            return it->second->second;
+        // Evicted while loading, it may have read the chunk as it was before
+        if (shard.generation != generation)
+            return chunk;
+
+        shard.lru.emplace_front(key, chunk);
+        shard.chunks.emplace(key, shard.lru.begin());
+        while (shard.lru.size() > m_shardCapacity)
+        {
+            shard.chunks.erase(shard.lru.back().first);
+            shard.lru.pop_back();
+        }
+        return chunk;
+    }
+
+    void RegionManager::Evict(int x, int z)
+    {
+        const std::uint64_t key = Key(x, z);
+        Shard& shard = ShardOf(key);
+        std::lock_guard lock(shard.mutex);
+        ++shard.generation;
+        if (const auto it = shard.chunks.find(key); it != shard.chunks.end())
+        {
+            shard.lru.erase(it->second);
+            shard.chunks.erase(it);
+        }
+    }
+
+    size_t RegionManager::CachedChunks() const
+    {
+        size_t count = 0;
+        for (Shard& shard : m_shards)
+        {
+            std::lock_guard lock(shard.mutex);
+            count += shard.lru.size();
+        }
+        return count;
+    }
+
+    //Private
+
+    RegionManager::RegionHandle RegionManager::Region(int regionX, int regionZ) const
+    {
+        const std::uint64_t key = Key(regionX, regionZ);
+        {
+            std::lock_guard lock(m_regionsMutex);
+            if (const auto it = m_regions.find(key); it != m_regions.end())
+            {
+                m_regionLru.splice(m_regionLru.begin(), m_regionLru, it->second);
+                return it->second->second;
+            }
+        }
+
+        // Mapped without holding the lock, if two threads race the first one to insert wins
+        const auto path = m_directory / std::format("r.{}.{}.mca", regionX, regionZ);
+        RegionHandle region = RegionFile::Open(path);
+
+        std::lock_guard lock(m_regionsMutex);
+        if (const auto it = m_regions.find(key); it != m_regions.end())
+            return it->second->second;
+
+        if (region != nullptr)
+            SFW_LOG_INFO("RegionManager", "Mapped {}", path.string());
+        m_regionLru.emplace_front(key, region);
+        m_regions.emplace(key, m_regionLru.begin());
+        while (m_regionLru.size() > REGION_CACHE_CAPACITY)
+        {
+            m_regions.erase(m_regionLru.back().first);
+            m_regionLru.pop_back();
+        }
+        return region;
+    }
+
+    RegionManager::ChunkHandle RegionManager::Load(int x, int z) const
+    {
+        const RegionHandle region = Region(floorDiv(x, RegionFile::CHUNKS_PER_SIDE), floorDiv(z, RegionFile::CHUNKS_PER_SIDE));
+        if (region == nullptr)
+            return nullptr;
+
+        const auto data = region->ChunkData(x, z);
+        if (!data.has_value())
+            return nullptr;
+
+        const auto [compression, payload] = *data;
+        if (compression & EXTERNAL_CHUNK_FLAG)
+        {
+            SFW_LOG_WARN("RegionManager", "Chunk {} {} is stored in an external .mcc file, not supported", x, z);
+            return nullptr;
+        }
+
+        const auto type = ChunkCompression(compression);
+        if (type != ChunkCompression::GZIP && type != ChunkCompression::ZLIB && type != ChunkCompression::UNCOMPRESSED)
+        {
+            SFW_LOG_WARN("RegionManager", "Chunk {} {} uses unsupported compression {}", x, z, compression);
+            return nullptr;
+        }
+
+        try
+        {
+            auto chunk = std::make_shared<const NBT::LazyDocument>(decodeChunk(type, payload));
+            SFW_LOG_DEBUG("RegionManager", "Loaded chunk {} {} from {}", x, z, region->Path().string());
+            return chunk;
+        }
+        catch (const std::exception& e)
+        {
+            SFW_LOG_WARN("RegionManager", "Failed to decode chunk {} {}: {}", x, z, e.what());
+            return nullptr;
+        }
+    }
+}
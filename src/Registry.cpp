@@ -1,16 +1,201 @@
 #include "Registry.h"
 #include "BlockState.h"
 #include "DataTypes/Identifier.h"
+#include "InternTable.h"
 #include "SFW/LoggerManager.h"
 #include "SFW/utils.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <memory>
 #include <mutex>
+#include <sys/mman.h>
+
+#include "generated/Blocks.h"
 
 
 namespace mc
 {
+    namespace
+    {
+        // The report lists properties in their layout order, which a sorted json object would lose
+        using OrderedJson = nlohmann::ordered_json;
+
+        std::optional<BlockState::PropertyValue> propertyValueFromJson(const OrderedJson& value)
+        {
+            if (value.is_string())
+                return value.get<std::string>();
+            else if (value.is_number_integer())
+                return value.get<int>();
+            else if (value.is_boolean())
+                return value.get<bool>();
+            return {};
+        }
+
+        std::optional<int> valueIndex(const std::vector<std::uint16_t>& values, std::uint16_t value)
+        {
+            const auto it = std::ranges::find(values, value);
+            if (it == values.end())
+                return {};
+            return it - values.begin();
+        }
+
+        bool isAir(const Identifier& id)
+        {
+            return id.GetCategory() == "minecraft" && (id.GetValue() == "air" || id.GetValue() == "cave_air" || id.GetValue() == "void_air");
+        }
+
+        // ############
+        // # Snapshot #
+        // ############
+
+        // Everything is stored in host byte order, the snapshot is a cache for the machine that
+        // wrote it. A snapshot from a machine with the other byte order fails the BYTE_ORDER check
+        constexpr char SNAPSHOT_MAGIC[8] = { 'M', 'C', 'R', 'E', 'G', 'S', 'N', 'P' };
+        constexpr std::uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+        struct StringRef
+        {
+            std::uint32_t offset;
+            std::uint32_t size;
+        };
+
+        struct SnapshotHeader
+        {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t byteOrder;
+            std::uint64_t sourceHash;
+            std::uint64_t sourceSize;
+
+            std::uint32_t blockCount;
+            std::uint32_t propertyCount;
+            std::uint32_t valueCount;
+            std::uint32_t stateCount;
+            std::uint32_t stringSize;
+            std::uint32_t padding;
+
+            // From the start of the file, each one 8 byte aligned
+            std::uint64_t blocksOffset;
+            std::uint64_t propertiesOffset;
+            std::uint64_t valuesOffset;
+            std::uint64_t stringsOffset;
+            std::uint64_t stateBlocksOffset;
+            std::uint64_t stateFlagsOffset;
+            std::uint64_t lightEmissionOffset;
+        };
+
+        struct BlockRecord
+        {
+            StringRef category;
+            StringRef value;
+            std::int32_t baseStateId;
+            std::int32_t stateCount;
+            std::int32_t defaultStateId;
+            std::uint32_t firstProperty;
+            std::uint32_t propertyCount;
+        };
+
+        struct PropertyRecord
+        {
+            StringRef name;
+            std::uint32_t firstValue;
+            std::uint32_t valueCount;
+            std::int32_t stride;
+        };
+
+        // Same order as the alternatives of BlockState::PropertyValue
+        enum class ValueType : std::uint32_t
+        {
+            INT,
+            BOOL,
+            STRING
+        };
+
+        struct ValueRecord
+        {
+            ValueType type;
+            std::int32_t number;
+            StringRef text;
+        };
+
+        std::string readFile(const std::filesystem::path& path)
+        {
+            std::ifstream file(path, std::ios::binary);
+            if (!file)
+                throw std::runtime_error(std::format("Failed to open {}", path.string()));
+            return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+        }
+
+        // Appends trivially copyable records to the snapshot image
+        class SnapshotWriter
+        {
+        public:
+            template<typename T>
+            size_t Append(std::span<const T> values)
+            {
+                const size_t offset = (m_image.size() + 7) & ~size_t(7);
+                m_image.resize(offset + values.size_bytes());
+                if (!values.empty())
+                    std::memcpy(m_image.data() + offset, values.data(), values.size_bytes());
+                return offset;
+            }
+
+            StringRef AddString(std::string_view text)
+            {
+                const StringRef ref{ std::uint32_t(m_strings.size()), std::uint32_t(text.size()) };
+                m_strings.append(text);
+                return ref;
+            }
+
+            inline const std::string& Strings() const noexcept { return m_strings; }
+            inline std::vector<std::uint8_t>& Image() noexcept { return m_image; }
+
+        private:
+            std::vector<std::uint8_t> m_image;
+            std::string m_strings;
+        };
+
+        // Bounds checked view over a mapped snapshot, throws std::runtime_error on anything out of place
+        class SnapshotReader
+        {
+        public:
+            SnapshotReader(std::span<const std::uint8_t> data)
+                : m_data(data),
+                m_strings()
+            {
+            }
+
+            template<typename T>
+            std::span<const T> Section(std::uint64_t offset, size_t count) const
+            {
+                if (offset % alignof(T) != 0 || offset > m_data.size() || count > (m_data.size() - offset) / sizeof(T))
+                    throw std::runtime_error("Snapshot section out of bounds");
+                return { reinterpret_cast<const T*>(m_data.data() + offset), count };
+            }
+
+            inline void SetStrings(std::uint64_t offset, size_t size)
+            {
+                const auto bytes = Section<char>(offset, size);
+                m_strings = { bytes.data(), bytes.size() };
+            }
+
+            std::string_view String(StringRef ref) const
+            {
+                if (ref.offset > m_strings.size() || ref.size > m_strings.size() - ref.offset)
+                    throw std::runtime_error("Snapshot string out of bounds");
+                return m_strings.substr(ref.offset, ref.size);
+            }
+
+        private:
+            std::span<const std::uint8_t> m_data;
+            std::string_view m_strings;
+        };
+    }
+
     //  #############################
     //  # BlockStateRegistry Static #
     //  #############################
@@ -19,7 +204,32 @@ namespace mc
         if (!s_registryInstance)
         {
             s_registryInstance.reset(new BlockStateRegistry());
-            LoadRegistryFile(registryPath);
+
+            const std::string source = readFile(registryPath);
+            const std::uint64_t sourceHash = util::fnv1a(source);
+            const auto snapshotPath = std::filesystem::path(registryPath).replace_extension(SNAPSHOT_EXTENSION);
+
+            if (!s_registryInstance->LoadSnapshot(snapshotPath, sourceHash, source.size()))
+            {
+                s_registryInstance->LoadJson(source);
+                s_registryInstance->WriteSnapshot(snapshotPath, sourceHash, source.size());
+            }
+            SFW_LOG_INFO("BlockRegistry", "Loaded {} blocks with {} states", s_registryInstance->m_blocks.size(), s_registryInstance->StateCount());
+        }
+        else
+        {
+            ASSERT(false, "Double initialization of BlockStateRegistry is not allowed");
+        }
+    }
+
+    void BlockStateRegistry::InitBuiltin()
+    {
+        static_assert(AIR_FLAG == generated::AIR_FLAG && OPAQUE_FLAG == generated::OPAQUE_FLAG && NO_BLOCK == generated::NO_BLOCK);
+        if (!s_registryInstance)
+        {
+            s_registryInstance.reset(new BlockStateRegistry());
+            s_registryInstance->LoadBuiltin();
+            SFW_LOG_INFO("BlockRegistry", "Loaded {} builtin blocks with {} states", s_registryInstance->m_blocks.size(), s_registryInstance->StateCount());
         }
         else
         {
@@ -35,82 +245,397 @@ namespace mc
         }
     }
 
-    void BlockStateRegistry::LoadRegistryFile(std::filesystem::path registryPath)
+    //  ######################
+    //  # BlockStateRegistry #
+    //  ######################
+
+    BlockStateRegistry::BlockStateRegistry()
+        : m_blocks(),
+        m_blockIndices(),
+        m_stateBlockStorage(),
+        m_stateFlagStorage(),
+        m_lightEmissionStorage(),
+        m_snapshot(),
+        m_stateBlocks(),
+        m_stateFlags(),
+        m_lightEmission()
+    {}
+
+    std::optional<int> BlockStateRegistry::GetBlockStateId(const BlockState& state) const
+    {
+        const Block* block = FindBlock(state.GetID());
+        if (block == nullptr)
+            return {};
+
+        const auto properties = state.GetPackedProperties();
+        int stateId = block->baseStateId;
+        for (const Property& property : block->properties)
+        {
+            const auto value = std::ranges::find(properties, property.name, &BlockState::PackedProperty::name);
+            // Properties that were left out keep the value of the default state
+            const auto index = value == properties.end()
+                ? std::optional<int>((block->defaultStateId - block->baseStateId) / property.stride % property.values.size())
+                : valueIndex(property.values, value->value);
+            if (!index.has_value())
+                return {};
+            stateId += *index * property.stride;
+        }
+        return stateId;
+    }
+
+    std::optional<BlockState> BlockStateRegistry::GetBlockState(int id) const
+    {
+        if (!IsValidState(id))
+            return {};
+
+        const Block& block = m_blocks[m_stateBlocks[id]];
+        const int offset   = id - block.baseStateId;
+
+        BlockState out(block.id);
+        for (const Property& property : block.properties)
+            out.AddProperty({ property.name, property.values[offset / property.stride % property.values.size()] });
+        return out;
+    }
+
+    std::optional<int> BlockStateRegistry::GetDefaultStateId(const Identifier& id) const
+    {
+        const Block* block = FindBlock(id);
+        if (block == nullptr)
+            return {};
+        return block->defaultStateId;
+    }
+
+    std::optional<int> BlockStateRegistry::WithProperty(int stateId, std::string_view name, const BlockState::PropertyValue& value) const
+    {
+        if (!IsValidState(stateId))
+            return {};
+
+        // Names and values nothing ever interned can't belong to any block
+        const auto nameId  = BlockState::FindName(name);
+        const auto valueId = BlockState::FindValue(value);
+        if (!nameId.has_value() || !valueId.has_value())
+            return {};
+
+        const Block& block = m_blocks[m_stateBlocks[stateId]];
+        const auto property = std::ranges::find(block.properties, *nameId, &Property::name);
+        if (property == block.properties.end())
+            return {};
+
+        const auto index = valueIndex(property->values, *valueId);
+        if (!index.has_value())
+            return {};
+
+        const int current = (stateId - block.baseStateId) / property->stride % property->values.size();
+        return stateId + (*index - current) * property->stride;
+    }
+
+    //Private
+
+    void BlockStateRegistry::AddBlock(Block block, std::span<const std::uint8_t> flags, std::span<const std::uint8_t> lightEmission)
+    {
+        const size_t end = block.baseStateId + block.stateCount;
+        if (end > m_stateBlockStorage.size())
+        {
+            m_stateBlockStorage.resize(end, NO_BLOCK);
+            m_stateFlagStorage.resize(end, 0);
+            m_lightEmissionStorage.resize(end, 0);
+        }
+
+        std::fill_n(m_stateBlockStorage.begin() + block.baseStateId, block.stateCount, m_blocks.size());
+        std::ranges::copy(flags, m_stateFlagStorage.begin() + block.baseStateId);
+        std::ranges::copy(lightEmission, m_lightEmissionStorage.begin() + block.baseStateId);
+
+        m_blockIndices.emplace(block.id, m_blocks.size());
+        m_blocks.push_back(std::move(block));
+    }
+
+    const BlockStateRegistry::Block* BlockStateRegistry::FindBlock(const Identifier& id) const
     {
-        std::ifstream file(registryPath);
-        const auto registryJson = nlohmann::json::parse(file);
+        const auto iter = m_blockIndices.find(id);
+        if (iter == m_blockIndices.cend())
+            return nullptr;
+        return &m_blocks[iter->second];
+    }
+
+    void BlockStateRegistry::LoadJson(std::string_view json)
+    {
+        const auto registryJson = OrderedJson::parse(json);
 
         for (const auto& [blockName, block] : registryJson.items())
         {
-            const auto delimiterPos = blockName.find(':');
-            const mc::Identifier blockIdentifier(blockName.substr(delimiterPos + 1));
-            
-            for (const auto& state : block["states"])
+            Block entry{ Identifier(blockName), 0, 1, 0, {} };
+
+            if (block.contains("properties"))
             {
-                mc::BlockState blockState(blockIdentifier);
+                for (const auto& [propertyName, values] : block.at("properties").items())
+                {
+                    Property property{ BlockState::InternName(propertyName), {}, 0 };
+                    for (const auto& value : values)
+                    {
+                        if (const auto parsed = propertyValueFromJson(value))
+                            property.values.push_back(BlockState::InternValue(*parsed));
+                        else
+                            SFW_LOG_WARN("BlockRegistry", "Failed to parse property {} unsuppoerted type", propertyName);
+                    }
+                    entry.properties.push_back(std::move(property));
+                }
+            }
 
-                if (!block.contains("properties"))
+            // Last property varies fastest
+            for (auto it = entry.properties.rbegin(); it != entry.properties.rend(); ++it)
+            {
+                it->stride        = entry.stateCount;
+                entry.stateCount *= it->values.size();
+            }
+
+            const auto& states = block.at("states");
+            if (states.size() != size_t(entry.stateCount))
+                throw std::runtime_error(std::format("{} lists {} states, its properties make {}", blockName, states.size(), entry.stateCount));
+
+            entry.baseStateId    = states.front().at("id").get<int>();
+            entry.defaultStateId = entry.baseStateId;
+
+            std::vector<std::uint8_t> flags(entry.stateCount, isAir(entry.id) ? AIR_FLAG : 0);
+            std::vector<std::uint8_t> lightEmission(entry.stateCount, 0);
+            for (const auto& state : states)
+            {
+                int stateId = entry.baseStateId;
+                for (const Property& property : entry.properties)
                 {
-                    s_registryInstance->MapState(blockState, state["id"].get<int>());
-                    continue;
+                    const std::string_view name = BlockState::NameOf(property.name);
+                    const auto value = propertyValueFromJson(state.at("properties").at(name));
+                    const auto index = value.has_value() ? valueIndex(property.values, BlockState::InternValue(*value)) : std::nullopt;
+                    if (!index.has_value())
+                        throw std::runtime_error(std::format("{} state {} has an unknown {}", blockName, state.at("id").get<int>(), name));
+                    stateId += *index * property.stride;
                 }
 
-                for (const auto& [propertyName, propertyValue] : state["properties"].items())
+                // The whole O(1) mapping depends on this, a report with another layout is refused
+                if (stateId != state.at("id").get<int>())
+                    throw std::runtime_error(std::format("{} state {} does not follow the vanilla layout", blockName, state.at("id").get<int>()));
+
+                if (state.value("default", false))
+                    entry.defaultStateId = stateId;
+
+                // Not part of the vanilla report, only filled when the registry was generated with them
+                const size_t offset = stateId - entry.baseStateId;
+                if (state.value("opaque", false))
+                    flags[offset] |= OPAQUE_FLAG;
+                lightEmission[offset] = state.value("light_emission", 0);
+            }
+
+            AddBlock(std::move(entry), flags, lightEmission);
+        }
+
+        m_stateBlocks   = m_stateBlockStorage;
+        m_stateFlags    = m_stateFlagStorage;
+        m_lightEmission = m_lightEmissionStorage;
+    }
+
+    bool BlockStateRegistry::LoadSnapshot(const std::filesystem::path& path, std::uint64_t sourceHash, std::uint64_t sourceSize)
+    {
+        try
+        {
+            // Read front to back once while the blocks are rebuilt, then by state id
+            m_snapshot = MappedFile::Open(path, MADV_WILLNEED);
+            if (m_snapshot == nullptr)
+                return false;
+
+            ReadSnapshot(m_snapshot->Data(), sourceHash, sourceSize);
+            SFW_LOG_DEBUG("BlockRegistry", "Using snapshot {}", path.string());
+            return true;
+        }
+        catch (const std::exception& e)
+        {
+            SFW_LOG_WARN("BlockRegistry", "Rebuilding {}: {}", path.string(), e.what());
+            Clear();
+            return false;
+        }
+    }
+
+    void BlockStateRegistry::ReadSnapshot(std::span<const std::uint8_t> data, std::uint64_t sourceHash, std::uint64_t sourceSize)
+    {
+        SnapshotReader reader(data);
+        const SnapshotHeader& header = reader.Section<SnapshotHeader>(0, 1).front();
+
+        if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+            throw std::runtime_error("Not a registry snapshot");
+        if (header.version != SNAPSHOT_VERSION || header.byteOrder != SNAPSHOT_BYTE_ORDER)
+            throw std::runtime_error(std::format("Snapshot version {} does not match {}", header.version, SNAPSHOT_VERSION));
+        if (header.sourceHash != sourceHash || header.sourceSize != sourceSize)
+            throw std::runtime_error("Registry changed since the snapshot was written");
+
+        const auto blocks     = reader.Section<BlockRecord>(header.blocksOffset, header.blockCount);
+        const auto properties = reader.Section<PropertyRecord>(header.propertiesOffset, header.propertyCount);
+        const auto values     = reader.Section<ValueRecord>(header.valuesOffset, header.valueCount);
+        reader.SetStrings(header.stringsOffset, header.stringSize);
+
+        m_stateBlocks   = reader.Section<std::uint32_t>(header.stateBlocksOffset, header.stateCount);
+        m_stateFlags    = reader.Section<std::uint8_t>(header.stateFlagsOffset, header.stateCount);
+        m_lightEmission = reader.Section<std::uint8_t>(header.lightEmissionOffset, header.stateCount);
+
+        m_blocks.reserve(blocks.size());
+        m_blockIndices.reserve(blocks.size());
+        for (const BlockRecord& record : blocks)
+        {
+            if (record.firstProperty > properties.size() || record.propertyCount > properties.size() - record.firstProperty)
+                throw std::runtime_error("Snapshot block properties out of bounds");
+            if (record.baseStateId < 0 || record.stateCount <= 0 || size_t(record.baseStateId) + record.stateCount > m_stateBlocks.size() ||
+                record.defaultStateId < record.baseStateId || record.defaultStateId >= record.baseStateId + record.stateCount)
+                throw std::runtime_error("Snapshot block states out of bounds");
+
+            Block block{ Identifier(reader.String(record.category), reader.String(record.value)), record.baseStateId, record.stateCount, record.defaultStateId, {} };
+
+            int stateCount = 1;
+            block.properties.reserve(record.propertyCount);
+            for (const PropertyRecord& propertyRecord : properties.subspan(record.firstProperty, record.propertyCount))
+            {
+                if (propertyRecord.firstValue > values.size() || propertyRecord.valueCount > values.size() - propertyRecord.firstValue)
+                    throw std::runtime_error("Snapshot property values out of bounds");
+
+                Property property{ BlockState::InternName(reader.String(propertyRecord.name)), {}, propertyRecord.stride };
+                property.values.reserve(propertyRecord.valueCount);
+                for (const ValueRecord& value : values.subspan(propertyRecord.firstValue, propertyRecord.valueCount))
                 {
-                    if (propertyValue.is_string())
-                    {
-                        blockState.AddProperty(propertyName, propertyValue.get<std::string>());
-                    }
-                    else if (propertyValue.is_number_integer())
+                    switch (value.type)
                     {
-                        blockState.AddProperty(propertyName, propertyValue.get<int>());
-                    }
-                    else if (propertyValue.is_boolean())
-                    {
-                        blockState.AddProperty(propertyName, propertyValue.get<bool>());
-                    }
-                    else
-                    {
-                        SFW_LOG_WARN("BlockRegistry", "Failed to parse property {} unsuppoerted type", propertyName);
+                        case ValueType::INT:
+                            property.values.push_back(BlockState::InternValue(value.number));
+                            break;
+                        case ValueType::BOOL:
+                            property.values.push_back(BlockState::InternValue(value.number != 0));
+                            break;
+                        case ValueType::STRING:
+                            property.values.push_back(BlockState::InternValue(std::string(reader.String(value.text))));
+                            break;
+                        default:
+                            throw std::runtime_error("Unknown snapshot value type");
                     }
                 }
 
-                s_registryInstance->MapState(blockState, state["id"].get<int>());
-
+                // Lookups divide by the stride and take the value count as modulo
+                if (property.values.empty() || property.stride <= 0)
+                    throw std::runtime_error(std::format("Snapshot property {} is malformed", BlockState::NameOf(property.name)));
+                stateCount *= property.values.size();
+                block.properties.push_back(std::move(property));
             }
+            if (stateCount != block.stateCount)
+                throw std::runtime_error(std::format("Snapshot block {} has {} states, its properties make {}", block.id, block.stateCount, stateCount));
+
+            m_blockIndices.emplace(block.id, m_blocks.size());
+            m_blocks.push_back(std::move(block));
         }
+
+        if (std::ranges::any_of(m_stateBlocks, [this](std::uint32_t block) { return block != NO_BLOCK && block >= m_blocks.size(); }))
+            throw std::runtime_error("Snapshot state points past the blocks");
     }
 
-    //  ######################
-    //  # BlockStateRegistry #
-    //  ######################
+    void BlockStateRegistry::WriteSnapshot(const std::filesystem::path& path, std::uint64_t sourceHash, std::uint64_t sourceSize) const
+    {
+        SnapshotWriter writer;
+        std::vector<BlockRecord> blocks;
+        std::vector<PropertyRecord> properties;
+        std::vector<ValueRecord> values;
 
-    BlockStateRegistry::BlockStateRegistry()
-        : m_stateToIdMap(),
-        m_idToBlockState()
-    {}
+        blocks.reserve(m_blocks.size());
+        for (const Block& block : m_blocks)
+        {
+            blocks.push_back({ writer.AddString(block.id.GetCategory()), writer.AddString(block.id.GetValue()), block.baseStateId,
+                block.stateCount, block.defaultStateId, std::uint32_t(properties.size()), std::uint32_t(block.properties.size()) });
 
-    void BlockStateRegistry::MapState(BlockState state, int stateId)
-    {
-        m_stateToIdMap.emplace(state, stateId);
-        m_idToBlockState.emplace(stateId, state);
+            for (const Property& property : block.properties)
+            {
+                properties.push_back({ writer.AddString(BlockState::NameOf(property.name)), std::uint32_t(values.size()), std::uint32_t(property.values.size()), property.stride });
+                for (const std::uint16_t valueId : property.values)
+                {
+                    const auto& value = BlockState::ValueOf(valueId);
+                    if (const auto* text = std::get_if<std::string>(&value))
+                        values.push_back({ ValueType::STRING, 0, writer.AddString(*text) });
+                    else if (const auto* flag = std::get_if<bool>(&value))
+                        values.push_back({ ValueType::BOOL, *flag, {} });
+                    else
+                        values.push_back({ ValueType::INT, std::get<int>(value), {} });
+                }
+            }
+        }
+
+        SnapshotHeader header{};
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version       = SNAPSHOT_VERSION;
+        header.byteOrder     = SNAPSHOT_BYTE_ORDER;
+        header.sourceHash    = sourceHash;
+        header.sourceSize    = sourceSize;
+        header.blockCount    = blocks.size();
+        header.propertyCount = properties.size();
+        header.valueCount    = values.size();
+        header.stateCount    = m_stateBlocks.size();
+        header.stringSize    = writer.Strings().size();
+
+        // The header goes first, its offsets are patched in once everything is placed
+        writer.Append(std::span<const SnapshotHeader>(&header, 1));
+        header.blocksOffset        = writer.Append(std::span<const BlockRecord>(blocks));
+        header.propertiesOffset    = writer.Append(std::span<const PropertyRecord>(properties));
+        header.valuesOffset        = writer.Append(std::span<const ValueRecord>(values));
+        header.stringsOffset       = writer.Append(std::span<const char>(writer.Strings()));
+        header.stateBlocksOffset   = writer.Append(m_stateBlocks);
+        header.stateFlagsOffset    = writer.Append(m_stateFlags);
+        header.lightEmissionOffset = writer.Append(m_lightEmission);
+        std::memcpy(writer.Image().data(), &header, sizeof(header));
+
+        // Another process booting at the same time must never map a half written snapshot
+        std::filesystem::path temporary = path;
+        temporary += ".tmp";
+        try
+        {
+            {
+                std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<const char*>(writer.Image().data()), writer.Image().size());
+                if (!file.flush())
+                    throw std::runtime_error("write failed");
+            }
+            std::filesystem::rename(temporary, path);
+            SFW_LOG_INFO("BlockRegistry", "Wrote snapshot {} ({} bytes)", path.string(), writer.Image().size());
+        }
+        catch (const std::exception& e)
+        {
+            std::error_code ignored;
+            std::filesystem::remove(temporary, ignored);
+            SFW_LOG_WARN("BlockRegistry", "Failed to write snapshot {}: {}", path.string(), e.what());
+        }
     }
 
-    std::optional<int> BlockStateRegistry::GetBlockStateId(const BlockState& state) const
+    void BlockStateRegistry::LoadBuiltin()
     {
-        const auto iter = m_stateToIdMap.find(state);
-        if (iter != m_stateToIdMap.cend())
-            return iter->second;
-        else
-            return {};
+        // The state arrays are used as compiled in, only the block tables are built
+        m_stateBlocks   = generated::blocks::STATE_BLOCKS;
+        m_stateFlags    = generated::blocks::STATE_FLAGS;
+        m_lightEmission = generated::blocks::LIGHT_EMISSION;
+
+        m_blocks.reserve(generated::blocks::ALL.size());
+        m_blockIndices.reserve(generated::blocks::ALL.size());
+        for (const generated::BlockType* type : generated::blocks::ALL)
+        {
+            Block block{ Identifier(type->name), type->baseStateId, type->stateCount, type->defaultStateId, {} };
+            for (const generated::BlockProperty& property : type->properties)
+            {
+                Property entry{ BlockState::InternName(property.name), {}, property.stride };
+                for (const std::string_view value : property.values)
+                    entry.values.push_back(BlockState::InternValue(std::string(value)));
+                block.properties.push_back(std::move(entry));
+            }
+
+            m_blockIndices.emplace(block.id, m_blocks.size());
+            m_blocks.push_back(std::move(block));
+        }
     }
 
-    std::optional<BlockState> BlockStateRegistry::GetBlockState(int id) const
+    void BlockStateRegistry::Clear()
     {
-        const auto iter = m_idToBlockState.find(id);
-        if (iter != m_idToBlockState.cend())
-            return iter->second;
-        else
-            return {};
+        m_blocks.clear();
+        m_blockIndices.clear();
+        m_stateBlocks   = {};
+        m_stateFlags    = {};
+        m_lightEmission = {};
+        m_snapshot.reset();
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,75 @@
+#include <SFW/LoggerManager.h>
+#include <filesystem>
+#include <fstream>
+#include <ranges>
+
+#include "ServerContext.h"
+#include "Compression.h"
+#include "PacketSchema.h"
+
+namespace mc
+{
+    ServerContext::ServerContext()
+        : registry_packets(),
+        compressed_registry_packets(),
+        regions(REGION_DIRECTORY),
+        chunk_encoder(BlockStateRegistry::Instance()),
+        chunk_packets(regions, chunk_encoder)
+    {
+    }
+
+    void ServerContext::Load()
+    {
+        BuildRegistryPackets();
+        LoadBiomes();
+        if (compression::enabled())
+        {
+            for (const auto& [compressed, registry] : std::ranges::views::zip(compressed_registry_packets, registry_packets))
+                compressed = compression::compressFrames(registry);
+        }
+    }
+
+    //These are semi hardcoded and inflexible for now in the name of progress
+    void ServerContext::BuildRegistryPackets()
+    {
+        SFW_LOG_INFO("MinecraftHandler", "Building registry packs");
+        for (const auto& [registry, packetFile] : std::ranges::views::zip(registry_packets, std::filesystem::directory_iterator("packets")))
+        {
+            SFW_LOG_DEBUG("MinecraftHandler", "Loading packet {}", packetFile.path().filename().string());
+            std::ifstream packet(packetFile.path(), std::ios::binary);
+            const size_t fileSize = packetFile.file_size();
+            registry.resize(fileSize);
+            packet.read(reinterpret_cast<char*>(registry.data()), fileSize);
+        }
+    }
+
+    //Chunks refer to biomes by their index in the registry the client got
+    void ServerContext::LoadBiomes()
+    {
+        for (const auto& registry : registry_packets)
+        {
+            if (registry.empty())
+                continue;
+
+            schema::Reader reader(registry);
+            reader.ReadLength();
+            reader.ReadVarInt();
+            //Built by us, the names are interned
+            if (Identifier(schema::Codec<schema::String>::Read(reader)) != Identifier("worldgen/biome"))
+                continue;
+
+            std::vector<Identifier> biomes(reader.ReadLength());
+            for (Identifier& biome : biomes)
+            {
+                biome = Identifier(schema::Codec<schema::String>::Read(reader));
+                //Entries come from the known packs, they never carry data
+                if (schema::Codec<schema::Bool>::Read(reader))
+                    throw std::runtime_error("Biome registry entries with data are not supported");
+            }
+            chunk_encoder.SetBiomes(biomes);
+            SFW_LOG_INFO("MinecraftHandler", "{} biomes registered", biomes.size());
+            return;
+        }
+        SFW_LOG_WARN("MinecraftHandler", "No biome registry packet, chunks can't be encoded");
+    }
+}
@@ -18,6 +18,13 @@ namespace mc::server
           m_numOfElements(0)
     {
     }
+
+    SetCompressionPacket::SetCompressionPacket(util::varInt threshold)
+        : Packet(LoginPacketID::SetCompression),
+          m_threshold(threshold)
+    {
+    }
+
     // *****************
     // * StatusPackets *
     // *****************
@@ -37,6 +44,13 @@ namespace mc::server
             { "enforceSecureChat", true },
             { "previewsChat", true } };
     }
+
+    PongPacket::PongPacket(std::int64_t payload)
+        : Packet(StatusPacketID::PONG),
+          m_payload(payload)
+    {
+    }
+
     // *****************
     // * ConfigPackets *
     // *****************
@@ -56,13 +70,13 @@ namespace mc::server
     // ****************
     // * PlayPackets *
     // ****************
-    LoginPlayPacket::LoginPlayPacket()
+    LoginPlayPacket::LoginPlayPacket(util::varInt viewDistance)
         : Packet((int)PlayPacketID::LoginPlay),
         m_entityID(243645754),
         m_isHardcore(false),
         m_dimensionIdentifiers({Identifier("overworld"), Identifier("nether")}),
         m_maxPlayers(32),
-        m_viewDistance(16),
+        m_viewDistance(viewDistance),
         m_simulationDistance(16),
         m_reducedDebugInfo(false),
         m_enableRespawnScreen(true),
@@ -74,9 +88,7 @@ namespace mc::server
         m_previousGameMode(-1),
         m_isDebug(false),
         m_isFlat(false),
-        m_hasDeathLocation(false),
-        m_deathDimension(),
-        m_deathPosition(),
+        m_deathLocation(),
         m_portalCooldown(1),
         m_seaLevel(100),
         m_enforceSecureChat(false)
@@ -115,4 +127,29 @@ namespace mc::server
           m_relativeMask(relativeMask)
     {
     }
+
+    SetCenterChunk::SetCenterChunk(util::varInt x, util::varInt z)
+        : Packet((int)PlayPacketID::SetCenterChunk),
+        m_x(x),
+        m_z(z)
+    {
+    }
+
+    ForgetLevelChunk::ForgetLevelChunk(std::int32_t x, std::int32_t z)
+        : Packet((int)PlayPacketID::ForgetLevelChunk),
+        m_x(x),
+        m_z(z)
+    {
+    }
+
+    ChunkBatchStart::ChunkBatchStart()
+        : Packet((int)PlayPacketID::ChunkBatchStart)
+    {
+    }
+
+    ChunkBatchFinished::ChunkBatchFinished(util::varInt batchSize)
+        : Packet((int)PlayPacketID::ChunkBatchFinished),
+        m_batchSize(batchSize)
+    {
+    }
 } // namespace mc::server
\ No newline at end of file
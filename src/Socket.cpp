@@ -0,0 +1,89 @@
+#include "Socket.h"
+
+#include <arpa/inet.h>
+#include <array>
+#include <charconv>
+#include <filesystem>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+namespace mc::net
+{
+    namespace
+    {
+        constexpr int LISTEN_BACKLOG = 1024;
+    }
+
+    int openListenSocket(const std::string& address, std::uint16_t port)
+    {
+        const int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            util::throwErrno("socket");
+
+        const int enable = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+        sockaddr_in bindAddress{};
+        bindAddress.sin_family = AF_INET;
+        bindAddress.sin_port   = htons(port);
+        if (::inet_pton(AF_INET, address.c_str(), &bindAddress.sin_addr) != 1)
+        {
+            ::close(fd);
+            throw std::runtime_error("Invalid listen address: " + address);
+        }
+
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&bindAddress), sizeof(bindAddress)) < 0 ||
+            ::listen(fd, LISTEN_BACKLOG) < 0)
+        {
+            const int error = errno;
+            ::close(fd);
+            errno = error;
+            util::throwErrno("bind/listen");
+        }
+        return fd;
+    }
+
+    void setNoDelay(int fd)
+    {
+        const int enable = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    }
+
+    std::pair<std::string, int> peerAddress(int fd)
+    {
+        sockaddr_in peer{};
+        socklen_t peerSize = sizeof(peer);
+        if (::getpeername(fd, reinterpret_cast<sockaddr*>(&peer), &peerSize) < 0)
+            return { "unknown", 0 };
+
+        std::array<char, INET_ADDRSTRLEN> host{};
+        ::inet_ntop(AF_INET, &peer.sin_addr, host.data(), host.size());
+        return { host.data(), ntohs(peer.sin_port) };
+    }
+
+    // Linux only, every open descriptor is listed in /proc/self/fd
+    bool shutdownPeer(const std::string& address, int port)
+    {
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator("/proc/self/fd", error))
+        {
+            const std::string name = entry.path().filename().string();
+            int fd = -1;
+            if (std::from_chars(name.data(), name.data() + name.size(), fd).ec != std::errc())
+                continue;
+
+            struct stat info{};
+            if (::fstat(fd, &info) < 0 || !S_ISSOCK(info.st_mode))
+                continue;
+            if (peerAddress(fd) == std::pair(address, port))
+                return ::shutdown(fd, SHUT_RDWR) == 0;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,539 @@
+#include "UringServer.h"
+
+#include <SFW/LoggerManager.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <exception>
+#include <linux/time_types.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+
+#include "ClientConnection.h"
+#include "FrameDecoder.h"
+#include "IoUring.h"
+#include "OutboundQueue.h"
+#include "PlayerHandler.h"
+#include "Socket.h"
+#include "utils.h"
+
+namespace mc
+{
+    namespace
+    {
+        constexpr unsigned RING_ENTRIES          = 1024;
+        constexpr std::uint16_t RECV_GROUP       = 0;
+        constexpr std::uint16_t RECV_BUFFERS     = 256;
+        constexpr std::uint32_t RECV_BUFFER_SIZE = 4096;
+        constexpr size_t IDLE_BUFFER_SIZE        = 512;
+        constexpr long long TICK_INTERVAL_NS     = std::chrono::nanoseconds(PlayerHandler::TICK_INTERVAL).count();
+
+        // Completions carry the connection pointer with the operation in the low bits
+        enum class Operation : std::uint64_t
+        {
+            ACCEPT = 0,
+            RECV   = 1,
+            SEND   = 2,
+            TICK   = 3,
+            WAKEUP = 4
+        };
+        constexpr std::uint64_t OPERATION_MASK = 0x7;
+
+        inline std::uint64_t tag(const void* object, Operation operation)
+        {
+            return reinterpret_cast<std::uint64_t>(object) | std::uint64_t(operation);
+        }
+    }
+
+    class UringWorker;
+
+    // ###################
+    // # UringConnection #
+    // ###################
+
+    class UringConnection : public ClientConnection
+    {
+    public:
+        UringConnection(UringWorker& worker, int fd, std::string address, int port, const ServerContext& context)
+            : m_worker(worker),
+            m_fd(fd),
+            m_address(std::move(address)),
+            m_port(port),
+            m_closing(false),
+            m_inflight(0),
+            m_sending(false),
+            m_readPaused(false),
+            m_outbound(),
+            m_message(),
+            m_decoder(IDLE_BUFFER_SIZE),
+            m_handler(*this, context)
+        {
+        }
+
+        ~UringConnection() override { ::close(m_fd); }
+
+        using ClientConnection::Send;
+        void Send(const std::vector<std::uint8_t>& data) override;
+        void Send(std::vector<std::uint8_t>&& data) override;
+        void SendPrebuilt(std::span<const std::uint8_t> data) override;
+        void SendShared(std::shared_ptr<const std::vector<std::uint8_t>> data) override;
+
+        inline void Cork() override { m_outbound.Cork(); }
+        void Uncork() override;
+
+        inline std::string GetAdress() const override { return m_address; }
+        inline int GetPort() const override { return m_port; }
+
+    private:
+        friend class UringWorker;
+
+        void Queued(bool belowLimit);
+
+        UringWorker& m_worker;
+        int m_fd;
+        std::string m_address;
+        int m_port;
+        bool m_closing;
+        unsigned m_inflight;
+        bool m_sending;
+        // Receives are not re-armed while the outbound queue is over its limit
+        bool m_readPaused;
+        OutboundQueue m_outbound;
+        // The one sendmsg in flight, both have to stay put until it completes
+        msghdr m_message;
+        std::array<iovec, OutboundQueue::MAX_IOVECS> m_iovecs;
+        FrameDecoder m_decoder;
+        PlayerHandler m_handler;
+    };
+
+    // ###############
+    // # UringWorker #
+    // ###############
+
+    class UringWorker
+    {
+    public:
+        UringWorker(const ServerContext& context)
+            : m_context(context),
+            m_ring(RING_ENTRIES),
+            m_recvBuffers(m_ring, RECV_GROUP, RECV_BUFFERS, RECV_BUFFER_SIZE),
+            m_wakeup(::eventfd(0, EFD_CLOEXEC)),
+            m_wakeupValue(0),
+            m_tickTimeout{ TICK_INTERVAL_NS / 1'000'000'000, TICK_INTERVAL_NS % 1'000'000'000 },
+            m_listenSocket(-1),
+            m_stop(false)
+        {
+            if (m_wakeup < 0)
+                util::throwErrno("eventfd");
+        }
+
+        ~UringWorker()
+        {
+            Stop();
+            Join();
+            for (auto& [_, connection] : m_connections)
+                ::shutdown(connection->m_fd, SHUT_RDWR);
+            m_connections.clear();
+            ::close(m_wakeup);
+        }
+
+        void Start(int listenSocket)
+        {
+            m_thread = std::thread([this, listenSocket]() { Loop(listenSocket); });
+        }
+
+        void Loop(int listenSocket)
+        {
+            m_listenSocket = listenSocket;
+            PostAccept();
+            PostTick();
+            PostWakeup();
+
+            try
+            {
+                while (!m_stop)
+                {
+                    m_ring.Submit(1);
+                    m_ring.ForEachCompletion([this](const io_uring_cqe& cqe) { OnCompletion(cqe); });
+                }
+            }
+            catch (const std::system_error& e)
+            {
+                SFW_LOG_ERROR("UringServer", "I/O thread stopped: {}", e.what());
+            }
+        }
+
+        // Safe from any thread, only the owner of the server joins
+        void Stop()
+        {
+            m_stop = true;
+            const std::uint64_t value = 1;
+            [[maybe_unused]] const ssize_t written = ::write(m_wakeup, &value, sizeof(value));
+        }
+
+        void Join()
+        {
+            if (m_thread.joinable())
+                m_thread.join();
+        }
+
+        // Called after something was pushed on the connection's queue
+        void Flush(UringConnection& connection)
+        {
+            if (connection.m_closing)
+                return;
+            if (!connection.m_sending && !connection.m_outbound.IsCorked() && !connection.m_outbound.Empty())
+                PostSend(connection);
+        }
+
+    private:
+        void PostAccept()
+        {
+            io_uring_sqe* sqe = m_ring.NextSqe();
+            sqe->opcode       = IORING_OP_ACCEPT;
+            sqe->fd           = m_listenSocket;
+            sqe->ioprio       = IORING_ACCEPT_MULTISHOT;
+            sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+            sqe->user_data    = tag(nullptr, Operation::ACCEPT);
+        }
+
+        void PostTick()
+        {
+            io_uring_sqe* sqe = m_ring.NextSqe();
+            sqe->opcode       = IORING_OP_TIMEOUT;
+            sqe->fd           = -1;
+            sqe->addr         = reinterpret_cast<std::uint64_t>(&m_tickTimeout);
+            sqe->len          = 1;
+            sqe->user_data    = tag(nullptr, Operation::TICK);
+        }
+
+        void PostWakeup()
+        {
+            io_uring_sqe* sqe = m_ring.NextSqe();
+            sqe->opcode       = IORING_OP_READ;
+            sqe->fd           = m_wakeup;
+            sqe->addr         = reinterpret_cast<std::uint64_t>(&m_wakeupValue);
+            sqe->len          = sizeof(m_wakeupValue);
+            sqe->user_data    = tag(nullptr, Operation::WAKEUP);
+        }
+
+        void PostRecv(UringConnection& connection)
+        {
+            io_uring_sqe* sqe = m_ring.NextSqe();
+            sqe->opcode       = IORING_OP_RECV;
+            sqe->fd           = connection.m_fd;
+            sqe->flags        = IOSQE_BUFFER_SELECT;
+            sqe->buf_group    = m_recvBuffers.Group();
+            sqe->user_data    = tag(&connection, Operation::RECV);
+            ++connection.m_inflight;
+        }
+
+        // Everything queued goes out in one sendmsg, borrowed registry packets included
+        void PostSend(UringConnection& connection)
+        {
+            connection.m_message            = {};
+            connection.m_message.msg_iov    = connection.m_iovecs.data();
+            connection.m_message.msg_iovlen = connection.m_outbound.Gather(connection.m_iovecs);
+
+            io_uring_sqe* sqe = m_ring.NextSqe();
+            sqe->opcode       = IORING_OP_SENDMSG;
+            sqe->fd           = connection.m_fd;
+            sqe->addr         = reinterpret_cast<std::uint64_t>(&connection.m_message);
+            sqe->len          = 1;
+            sqe->msg_flags    = MSG_NOSIGNAL;
+            sqe->user_data    = tag(&connection, Operation::SEND);
+
+            connection.m_sending = true;
+            ++connection.m_inflight;
+        }
+
+        void OnCompletion(const io_uring_cqe& cqe)
+        {
+            const auto operation = Operation(cqe.user_data & OPERATION_MASK);
+            auto* connection     = reinterpret_cast<UringConnection*>(cqe.user_data & ~OPERATION_MASK);
+
+            switch (operation)
+            {
+                case Operation::ACCEPT: OnAccept(cqe); break;
+                case Operation::RECV: OnConnectionCompletion(*connection, cqe, &UringWorker::OnRecv); break;
+                case Operation::SEND: OnConnectionCompletion(*connection, cqe, &UringWorker::OnSend); break;
+                case Operation::TICK: OnTick(); break;
+                case Operation::WAKEUP:
+                    if (!m_stop)
+                        PostWakeup();
+                    break;
+            }
+        }
+
+        // Whatever handling one connection's completion throws, only that connection is closed.
+        // Failures of the ring itself while the loop submits stop the thread in Loop
+        void OnConnectionCompletion(UringConnection& connection, const io_uring_cqe& cqe,
+            void (UringWorker::*handle)(UringConnection&, const io_uring_cqe&))
+        {
+            try
+            {
+                (this->*handle)(connection, cqe);
+            }
+            catch (const std::exception& e)
+            {
+                SFW_LOG_WARN("UringServer", "Dropping connection {}:{}, {}", connection.m_address, connection.m_port, e.what());
+                Close(connection);
+            }
+        }
+
+        void OnAccept(const io_uring_cqe& cqe)
+        {
+            if (!(cqe.flags & IORING_CQE_F_MORE) && !m_stop)
+                PostAccept();
+
+            if (cqe.res < 0)
+            {
+                SFW_LOG_WARN("UringServer", "accept failed: {}", std::strerror(-cqe.res));
+                return;
+            }
+
+            const int fd = cqe.res;
+            std::unique_ptr<UringConnection> connection;
+            try
+            {
+                net::setNoDelay(fd);
+                auto [host, port] = net::peerAddress(fd);
+                SFW_LOG_INFO("UringServer", "New connection from: {}:{}", host, port);
+
+                connection = std::make_unique<UringConnection>(*this, fd, std::move(host), port, m_context);
+                PostRecv(*connection);
+            }
+            catch (const std::exception& e)
+            {
+                SFW_LOG_WARN("UringServer", "Rejecting connection, {}", e.what());
+                // Owned by the connection once it exists
+                if (connection == nullptr)
+                    ::close(fd);
+                return;
+            }
+            UringConnection* key = connection.get();
+            m_connections.emplace(key, std::move(connection));
+        }
+
+        void OnRecv(UringConnection& connection, const io_uring_cqe& cqe)
+        {
+            --connection.m_inflight;
+
+            if (cqe.flags & IORING_CQE_F_BUFFER)
+            {
+                const std::uint16_t bufferId = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+                if (cqe.res > 0 && !connection.m_closing)
+                    connection.m_decoder.Feed(m_recvBuffers.Buffer(bufferId, cqe.res));
+                m_recvBuffers.Recycle(bufferId);
+            }
+
+            if (connection.m_closing)
+                return Release(connection);
+
+            if (cqe.res == -ENOBUFS || cqe.res == -EINTR)
+                return PostRecv(connection);
+
+            if (cqe.res <= 0)
+                return Close(connection);
+
+            try
+            {
+                connection.Cork();
+                while (const auto frame = connection.m_decoder.NextFrame())
+                    connection.m_handler.Execute(*frame);
+                connection.Uncork();
+            }
+            catch (const std::exception& e)
+            {
+                SFW_LOG_WARN("UringServer", "Dropping connection {}:{}, {}", connection.m_address, connection.m_port, e.what());
+                return Close(connection);
+            }
+
+            if (connection.m_closing)
+                return Release(connection);
+
+            // Backpressure, stop reading until the peer caught up with what it was sent
+            if (connection.m_outbound.IsFull())
+                connection.m_readPaused = true;
+            else
+                PostRecv(connection);
+        }
+
+        void OnSend(UringConnection& connection, const io_uring_cqe& cqe)
+        {
+            --connection.m_inflight;
+            connection.m_sending = false;
+
+            if (connection.m_closing)
+                return Release(connection);
+
+            if (cqe.res < 0 && cqe.res != -EAGAIN && cqe.res != -EINTR)
+                return Close(connection);
+
+            connection.m_outbound.Consume(std::max(cqe.res, 0));
+            Flush(connection);
+
+            if (connection.m_readPaused && !connection.m_outbound.IsFull())
+            {
+                connection.m_readPaused = false;
+                PostRecv(connection);
+            }
+        }
+
+        void OnTick()
+        {
+            if (m_stop)
+                return;
+
+            // Closing can free a connection, so not while walking the map
+            std::vector<UringConnection*> failed;
+            for (auto& [_, connection] : m_connections)
+            {
+                if (connection->m_closing)
+                    continue;
+                try
+                {
+                    connection->Cork();
+                    connection->m_handler.Tick();
+                    connection->Uncork();
+                }
+                catch (const std::exception& e)
+                {
+                    SFW_LOG_WARN("UringServer", "Dropping connection {}:{}, {}", connection->m_address, connection->m_port, e.what());
+                    failed.push_back(connection.get());
+                }
+            }
+            for (UringConnection* connection : failed)
+                Close(*connection);
+            PostTick();
+        }
+
+        // Outstanding operations have to complete before the connection can be freed,
+        // shutting the socket down makes them do so quickly
+        void Close(UringConnection& connection)
+        {
+            if (!connection.m_closing)
+            {
+                connection.m_closing = true;
+                ::shutdown(connection.m_fd, SHUT_RDWR);
+            }
+            Release(connection);
+        }
+
+        void Release(UringConnection& connection)
+        {
+            if (connection.m_inflight > 0)
+                return;
+            m_connections.erase(&connection);
+        }
+
+        const ServerContext& m_context;
+        IoUring m_ring;
+        ProvidedBufferRing m_recvBuffers;
+
+        int m_wakeup;
+        std::uint64_t m_wakeupValue;
+        __kernel_timespec m_tickTimeout;
+        int m_listenSocket;
+        std::atomic_bool m_stop;
+        std::thread m_thread;
+
+        std::unordered_map<UringConnection*, std::unique_ptr<UringConnection>> m_connections;
+    };
+
+    void UringConnection::Send(const std::vector<std::uint8_t>& data)
+    {
+        if (!m_closing)
+            Queued(m_outbound.Push(std::span<const std::uint8_t>(data)));
+    }
+
+    void UringConnection::Send(std::vector<std::uint8_t>&& data)
+    {
+        if (!m_closing)
+            Queued(m_outbound.Push(std::move(data)));
+    }
+
+    void UringConnection::SendPrebuilt(std::span<const std::uint8_t> data)
+    {
+        if (!m_closing)
+            Queued(m_outbound.PushBorrowed(data));
+    }
+
+    void UringConnection::SendShared(std::shared_ptr<const std::vector<std::uint8_t>> data)
+    {
+        if (!m_closing)
+            Queued(m_outbound.PushShared(std::move(data)));
+    }
+
+    void UringConnection::Uncork()
+    {
+        m_outbound.Uncork();
+        m_worker.Flush(*this);
+    }
+
+    //Private
+
+    void UringConnection::Queued(bool belowLimit)
+    {
+        if (!belowLimit && !m_readPaused)
+            SFW_LOG_DEBUG("UringServer", "Outbound queue of {}:{} full ({} bytes)", m_address, m_port, m_outbound.Size());
+        m_worker.Flush(*this);
+    }
+
+    // ###############
+    // # UringServer #
+    // ###############
+
+    UringServer::UringServer(std::string address, std::uint16_t port, size_t ioThreads)
+        : m_address(std::move(address)),
+        m_port(port),
+        m_ioThreads(std::max<size_t>(ioThreads, 1)),
+        m_listenSocket(-1),
+        m_stop(false)
+    {
+        m_context.Load();
+        for (size_t i = 0; i < m_ioThreads; ++i)
+            m_workers.push_back(std::make_unique<UringWorker>(m_context));
+    }
+
+    UringServer::~UringServer()
+    {
+        m_workers.clear();
+        if (m_listenSocket >= 0)
+            ::close(m_listenSocket);
+    }
+
+    void UringServer::Run()
+    {
+        // A write to a socket the peer closed must not kill the process
+        std::signal(SIGPIPE, SIG_IGN);
+
+        m_listenSocket = net::openListenSocket(m_address, m_port);
+        SFW_LOG_INFO("UringServer", "Listening on {}:{} with {} I/O threads", m_address, m_port, m_workers.size());
+
+        for (size_t i = 1; i < m_workers.size(); ++i)
+            m_workers[i]->Start(m_listenSocket);
+
+        if (!m_stop)
+            m_workers.front()->Loop(m_listenSocket);
+
+        for (auto& worker : m_workers)
+        {
+            worker->Stop();
+            worker->Join();
+        }
+    }
+
+    void UringServer::Stop()
+    {
+        m_stop = true;
+        for (auto& worker : m_workers)
+            worker->Stop();
+    }
+}
@@ -1,25 +1,111 @@
 #include <SFW/Server.h>
 #include <SFW/LoggerManager.h>
 
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "Compression.h"
+#include "EpollServer.h"
+#include "IoUring.h"
 #include "Registry.h"
 #include "MinecraftHandler.h"
+#include "UringServer.h"
+
+namespace
+{
+    template<typename Server>
+    void runUntilInput(Server& server)
+    {
+        std::thread serverThread([&server](){
+            server.Run();
+        });
+        char c = 'a'; 
+        std::cin >> c;
+
+        server.Stop();
 
-int main()
+        serverThread.join();
+    }
+}
+
+// --backend=sfw (default) keeps a thread per connection
+// --backend=epoll [--io-threads=N] uses the event driven reactor
+// --backend=uring [--io-threads=N] same on io_uring, falls back to epoll if the kernel can't
+// --compression-threshold=N (-1 disables) --compression-level=0..9 apply to every backend
+// --blocks=path loads a block report (e.g. one a data pack changed) instead of the tables compiled in
+// --blocks=builtin uses the compiled in tables even when the build only had the trimmed report
+int main(int argc, char** argv)
 {
     iu::LoggerManager::LogToConsole();
     iu::LoggerManager::LogFile("lastrun.log");
-    mc::BlockStateRegistry::Init("registries/blocks.json");
 #if 1
-    iu::AggregateServer<mc::MinecraftHanlder> server("0.0.0.0", 25565);
-    std::thread serverThread([&server](){
-        server.Run();
-    });
-    char c = 'a'; 
-    std::cin >> c;
+    std::string blocksReport;
+    std::string_view backend = "sfw";
+    size_t ioThreads = mc::EpollServer::DEFAULT_IO_THREADS;
+    int compressionThreshold = mc::compression::DEFAULT_THRESHOLD;
+    int compressionLevel = mc::compression::DEFAULT_LEVEL;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg.starts_with("--backend="))
+            backend = arg.substr(arg.find('=') + 1);
+        else if (arg.starts_with("--io-threads="))
+            ioThreads = std::stoul(std::string(arg.substr(arg.find('=') + 1)));
+        else if (arg.starts_with("--compression-threshold="))
+            compressionThreshold = std::stoi(std::string(arg.substr(arg.find('=') + 1)));
+        else if (arg.starts_with("--compression-level="))
+            compressionLevel = std::stoi(std::string(arg.substr(arg.find('=') + 1)));
+        else if (arg.starts_with("--blocks="))
+            blocksReport = arg.substr(arg.find('=') + 1);
+    }
+
+    // A level zlib refuses would drop every player at their first compressed packet
+    try
+    {
+        mc::compression::configure(compressionThreshold, compressionLevel);
+    }
+    catch (const std::out_of_range& e)
+    {
+        SFW_LOG_ERROR("main", "{}", e.what());
+        return 1;
+    }
+
+    // Only a build from the full report starts from the compiled in tables by default
+    if (blocksReport == "builtin")
+        mc::BlockStateRegistry::InitBuiltin();
+    else if (!blocksReport.empty())
+        mc::BlockStateRegistry::Init(blocksReport);
+    else
+    {
+#ifdef MC_GENERATED_BLOCKS
+        mc::BlockStateRegistry::InitBuiltin();
+#else
+        mc::BlockStateRegistry::Init("registries/blocks.json");
+#endif
+    }
 
-    server.Stop();
+    if (backend == "uring" && !mc::IoUring::IsSupported())
+    {
+        SFW_LOG_WARN("main", "io_uring backend not available, using epoll");
+        backend = "epoll";
+    }
 
-    serverThread.join();
+    if (backend == "uring")
+    {
+        mc::UringServer server("0.0.0.0", 25565, ioThreads);
+        runUntilInput(server);
+    }
+    else if (backend == "epoll")
+    {
+        mc::EpollServer server("0.0.0.0", 25565, ioThreads);
+        runUntilInput(server);
+    }
+    else
+    {
+        iu::AggregateServer<mc::MinecraftHanlder> server("0.0.0.0", 25565);
+        runUntilInput(server);
+    }
 
 #else 
 
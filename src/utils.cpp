@@ -1,9 +1,92 @@
 #include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
 #include "utils.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MC_X86_SIMD 1
+#endif
+
 namespace mc
 {
     namespace util
     {
+        namespace
+        {
+            using ByteswapFunction = void (*)(std::uint8_t*, size_t) noexcept;
+
+            template<size_t Size>
+            using Word = std::conditional_t<Size == 2, std::uint16_t, std::conditional_t<Size == 4, std::uint32_t, std::uint64_t>>;
+
+            template<size_t Size>
+            void byteswapScalar(std::uint8_t* data, size_t count) noexcept
+            {
+                for (size_t i = 0; i < count; ++i, data += Size)
+                {
+                    Word<Size> value;
+                    std::memcpy(&value, data, Size);
+                    value = byteswap(value);
+                    std::memcpy(data, &value, Size);
+                }
+            }
+
+#ifdef MC_X86_SIMD
+            // pshufb control that reverses every Size byte group of a 32 byte block
+            template<size_t Size>
+            constexpr std::array<std::uint8_t, 32> shuffleMask()
+            {
+                std::array<std::uint8_t, 32> mask{};
+                for (size_t i = 0; i < mask.size(); ++i)
+                    mask[i] = (i % 16) / Size * Size + (Size - 1 - i % Size);
+                return mask;
+            }
+
+            template<size_t Size>
+            __attribute__((target("avx2"))) void byteswapAvx2(std::uint8_t* data, size_t count) noexcept
+            {
+                static constexpr auto MASK = shuffleMask<Size>();
+                const __m256i mask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(MASK.data()));
+                const size_t bytes = count * Size;
+                size_t i = 0;
+                for (; i + 32 <= bytes; i += 32)
+                {
+                    __m256i* block = reinterpret_cast<__m256i*>(data + i);
+                    _mm256_storeu_si256(block, _mm256_shuffle_epi8(_mm256_loadu_si256(block), mask));
+                }
+                byteswapScalar<Size>(data + i, (bytes - i) / Size);
+            }
+
+            template<size_t Size>
+            __attribute__((target("ssse3"))) void byteswapSsse3(std::uint8_t* data, size_t count) noexcept
+            {
+                static constexpr auto MASK = shuffleMask<Size>();
+                const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(MASK.data()));
+                const size_t bytes = count * Size;
+                size_t i = 0;
+                for (; i + 16 <= bytes; i += 16)
+                {
+                    __m128i* block = reinterpret_cast<__m128i*>(data + i);
+                    _mm_storeu_si128(block, _mm_shuffle_epi8(_mm_loadu_si128(block), mask));
+                }
+                byteswapScalar<Size>(data + i, (bytes - i) / Size);
+            }
+#endif
+
+            template<size_t Size>
+            ByteswapFunction pickByteswap() noexcept
+            {
+#ifdef MC_X86_SIMD
+                if (__builtin_cpu_supports("avx2"))
+                    return byteswapAvx2<Size>;
+                if (__builtin_cpu_supports("ssse3"))
+                    return byteswapSsse3<Size>;
+#endif
+                return byteswapScalar<Size>;
+            }
+        }
+
         
         uuid::uuid()
         {
@@ -37,51 +120,39 @@ namespace mc
             buffer.insert(buffer.end(), m_data, m_data + 16);
         }
 
-        void writeVarInt(std::vector<uint8_t>& buffer, int value)
+        void writeStringToBuff(std::vector<uint8_t>& buffer, std::string_view str)
         {
-            while (true)
-            {
-                if ((value & (~SEGMENT_BIT)) == 0)
-                {
-                    buffer.push_back(value);
-                    return;
-                }
-            buffer.push_back((value & SEGMENT_BIT) | CONTINUE_BIT);
-            value >>= 7;
-            }
+            writeVarInt(buffer, str.size());
+            buffer.insert(buffer.end(), str.begin(), str.end());
+        }
 
+        void toLower(std::string& s)
+        {
+            for(auto& c : s)
+                c = std::tolower(c);
         }
 
-        void writeVarInt(std::vector<uint8_t>&buffer, size_t pos, int value)
+        void throwErrno(const char* what)
         {
-            while (true)
-            {
-                if ((value & (~SEGMENT_BIT)) == 0)
-                {
-                    buffer.insert(buffer.begin()+pos,value);
-                    return;
-                }
-            buffer.insert(buffer.begin() + pos, (value & SEGMENT_BIT) | CONTINUE_BIT);
-            value >>= 7;
-            ++pos;
-            }
-        
+            throw std::system_error(errno, std::generic_category(), what);
         }
-    
-        void writeStringToBuff(std::vector<uint8_t>& buffer, std::string_view str)
+
+        void byteswap16(void* data, size_t count) noexcept
         {
-            writeVarInt(buffer, str.size());
+            static const ByteswapFunction swap = pickByteswap<2>();
+            swap(static_cast<std::uint8_t*>(data), count);
+        }
 
-            for(const char c : str)
-            {
-                buffer.push_back(c);
-            }
+        void byteswap32(void* data, size_t count) noexcept
+        {
+            static const ByteswapFunction swap = pickByteswap<4>();
+            swap(static_cast<std::uint8_t*>(data), count);
         }
 
-        void toLower(std::string& s)
+        void byteswap64(void* data, size_t count) noexcept
         {
-            for(auto& c : s)
-                c = std::tolower(c);
+            static const ByteswapFunction swap = pickByteswap<8>();
+            swap(static_cast<std::uint8_t*>(data), count);
         }
     }
 }
\ No newline at end of file
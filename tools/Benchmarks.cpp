@@ -0,0 +1,460 @@
+// Throughput of the hot paths, run from the directory the server runs in (map/, packets/, registries/):
+//   mc-bench chunks [threads]    Chunk Data encoding of every stored chunk, chunks per second per core
+//   mc-bench compression         Compressed size and CPU time of those Chunk Data frames at every zlib level
+//   mc-bench nbt                 Allocations and parse rate of the stored chunks as NBT tree and LazyDocument
+//   mc-bench varint              VarInt.h against the byte at a time loops it replaced
+//   mc-bench registry            Block registry setup from the compiled in tables and from registries/blocks.json
+// Every measurement warms up with one run, then repeats the work for at least MIN_DURATION.
+// Results go to stdout, one line per measurement
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BufferPool.h"
+#include "ChunkView.h"
+#include "Compression.h"
+#include "DataTypes/NBTLazyDocument.h"
+#include "DataTypes/nbt.h"
+#include "RegionManager.h"
+#include "Registry.h"
+#include "ServerContext.h"
+#include "VarInt.h"
+#include "utils.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr auto MIN_DURATION = std::chrono::seconds(1);
+    // zlib's, 0 stores without compressing
+    constexpr int MIN_COMPRESSION_LEVEL = 0;
+    constexpr int MAX_COMPRESSION_LEVEL = 9;
+    constexpr const char* BLOCK_REPORT = "registries/blocks.json";
+
+    // Seconds one call of run takes. The first call only warms caches, pools and thread local streams up
+    template<typename Run>
+    double secondsPerRun(Run&& run)
+    {
+        run();
+
+        size_t runs = 0;
+        const auto start = Clock::now();
+        Clock::duration elapsed{};
+        do
+        {
+            run();
+            ++runs;
+            elapsed = Clock::now() - start;
+        } while (elapsed < MIN_DURATION);
+        return std::chrono::duration<double>(elapsed).count() / runs;
+    }
+
+    // Same as main
+    void loadBlocks()
+    {
+#ifdef MC_GENERATED_BLOCKS
+        mc::BlockStateRegistry::InitBuiltin();
+#else
+        mc::BlockStateRegistry::Init(BLOCK_REPORT);
+#endif
+    }
+
+    // Counted per thread by the global operator new below, so threads don't contend on them
+    thread_local size_t t_allocations     = 0;
+    thread_local size_t t_allocatedBytes  = 0;
+
+    struct Allocations
+    {
+        size_t count;
+        size_t bytes;
+    };
+
+    // What run allocated on this thread
+    template<typename Run>
+    Allocations allocationsOf(Run&& run)
+    {
+        const Allocations before{ t_allocations, t_allocatedBytes };
+        run();
+        return { t_allocations - before.count, t_allocatedBytes - before.bytes };
+    }
+
+    // Fixed so every run measures the same values
+    constexpr unsigned VARINT_SEED  = 25565;
+    constexpr size_t VARINT_COUNT   = 1 << 20;
+
+    // Region file compression type of chunks that are stored as they are
+    constexpr std::uint8_t UNCOMPRESSED_CHUNK = 3;
+
+    // Calls callback(position, compression type, payload) for every chunk stored in the region files of directory
+    template<typename Callback>
+    void forEachStoredChunk(const std::filesystem::path& directory, Callback&& callback)
+    {
+        for (const auto& entry : std::filesystem::directory_iterator(directory))
+        {
+            int regionX = 0;
+            int regionZ = 0;
+            if (std::sscanf(entry.path().filename().c_str(), "r.%d.%d.mca", &regionX, &regionZ) != 2)
+                continue;
+
+            const auto region = mc::RegionFile::Open(entry.path());
+            if (region == nullptr)
+                continue;
+            for (int z = 0; z < mc::RegionFile::CHUNKS_PER_SIDE; ++z)
+            {
+                for (int x = 0; x < mc::RegionFile::CHUNKS_PER_SIDE; ++x)
+                {
+                    if (const auto data = region->ChunkData(x, z); data.has_value())
+                    {
+                        const mc::ChunkPos position{ regionX * mc::RegionFile::CHUNKS_PER_SIDE + x, regionZ * mc::RegionFile::CHUNKS_PER_SIDE + z };
+                        callback(position, data->first, data->second);
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<mc::ChunkPos> storedChunks(const std::filesystem::path& directory)
+    {
+        std::vector<mc::ChunkPos> chunks;
+        forEachStoredChunk(directory, [&](mc::ChunkPos position, std::uint8_t, std::span<const std::uint8_t>)
+        {
+            chunks.push_back(position);
+        });
+        if (chunks.empty())
+            throw std::runtime_error("No chunks in " + directory.string());
+        return chunks;
+    }
+
+    // Registry, biomes and world set up the way the server does it
+    template<typename Bench>
+    void withContext(Bench&& bench)
+    {
+        loadBlocks();
+        {
+            mc::ServerContext context;
+            context.Load();
+            bench(context);
+        }
+        mc::BlockStateRegistry::Deinit();
+    }
+
+    std::vector<std::pair<mc::ChunkPos, mc::RegionManager::ChunkHandle>> decodedChunks(const mc::ServerContext& context)
+    {
+        std::vector<std::pair<mc::ChunkPos, mc::RegionManager::ChunkHandle>> chunks;
+        for (const mc::ChunkPos position : storedChunks(mc::ServerContext::REGION_DIRECTORY))
+        {
+            if (auto chunk = context.regions.GetChunk(position.x, position.z))
+                chunks.emplace_back(position, std::move(chunk));
+        }
+        return chunks;
+    }
+
+    // Chunks are decoded up front, only the encoder is measured. Every thread encodes all of them
+    void benchChunks(const mc::ServerContext& context, size_t threads)
+    {
+        const auto chunks = decodedChunks(context);
+
+        std::vector<double> seconds(threads);
+        std::vector<size_t> bytes(threads);
+        {
+            std::vector<std::jthread> workers;
+            for (size_t i = 0; i < threads; ++i)
+            {
+                workers.emplace_back([&, i]()
+                {
+                    seconds[i] = secondsPerRun([&]()
+                    {
+                        bytes[i] = 0;
+                        for (const auto& [position, chunk] : chunks)
+                        {
+                            auto frame = context.chunk_encoder.Encode(position.x, position.z, *chunk);
+                            bytes[i] += frame.size();
+                            mc::pool::release(std::move(frame));
+                        }
+                    });
+                });
+            }
+        }
+
+        double chunksPerSecond = 0;
+        for (const double s : seconds)
+            chunksPerSecond += chunks.size() / s;
+        std::cout << std::fixed << std::setprecision(0)
+                  << "chunks: " << chunks.size() << " chunks, " << threads << " threads, "
+                  << chunksPerSecond / threads << " chunks/s per core, "
+                  << chunksPerSecond << " chunks/s, "
+                  << bytes.front() / chunks.size() << " bytes per chunk\n";
+    }
+
+    void benchChunks(int argc, char** argv)
+    {
+        size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+        if (argc > 2)
+            threads = std::stoul(argv[2]);
+
+        withContext([&](const mc::ServerContext& context)
+        {
+            benchChunks(context, 1);
+            if (threads > 1)
+                benchChunks(context, threads);
+        });
+    }
+
+    // Chunk Data is the bulk of what a server compresses, so the frames of the world are the input.
+    // Each level is measured on one thread as bytes in per second against bytes out
+    void benchCompression(const mc::ServerContext& context)
+    {
+        std::vector<std::vector<std::uint8_t>> frames;
+        size_t uncompressed = 0;
+        for (const auto& [position, chunk] : decodedChunks(context))
+        {
+            frames.push_back(context.chunk_encoder.Encode(position.x, position.z, *chunk));
+            uncompressed += frames.back().size();
+        }
+
+        std::vector<std::uint8_t> out;
+        for (int level = MIN_COMPRESSION_LEVEL; level <= MAX_COMPRESSION_LEVEL; ++level)
+        {
+            mc::compression::configure(mc::compression::DEFAULT_THRESHOLD, level);
+            const double seconds = secondsPerRun([&]()
+            {
+                out.clear();
+                for (const auto& frame : frames)
+                    mc::compression::compressFrames(frame, out);
+            });
+            std::cout << std::fixed << std::setprecision(1)
+                      << "compression: level " << level << ", "
+                      << uncompressed / seconds / 1e6 << " MB/s per core, "
+                      << out.size() << " of " << uncompressed << " bytes ("
+                      << 100.0 * out.size() / uncompressed << "%)\n";
+        }
+    }
+
+    // Uncompressed NBT of every stored chunk, chunks in external .mcc files are skipped like the server does
+    std::vector<std::vector<std::uint8_t>> inflatedChunks(const std::filesystem::path& directory)
+    {
+        std::vector<std::vector<std::uint8_t>> chunks;
+        forEachStoredChunk(directory, [&](mc::ChunkPos, std::uint8_t compression, std::span<const std::uint8_t> payload)
+        {
+            if (compression == UNCOMPRESSED_CHUNK)
+                chunks.emplace_back(payload.begin(), payload.end());
+            else if (compression < UNCOMPRESSED_CHUNK)
+                chunks.push_back(mc::compression::inflateStream(payload));
+        });
+        if (chunks.empty())
+            throw std::runtime_error("No chunks in " + directory.string());
+        return chunks;
+    }
+
+    void reportNbt(std::string_view model, size_t chunks, double seconds, Allocations allocations, size_t retained)
+    {
+        std::cout << std::fixed << std::setprecision(0)
+                  << "nbt: " << model << ", " << chunks / seconds << " chunks/s per core, "
+                  << allocations.count / chunks << " allocations and "
+                  << allocations.bytes / chunks << " bytes allocated per chunk, "
+                  << retained / chunks << " bytes held per chunk\n";
+    }
+
+    // Parsing a chunk into the tree against indexing it as a LazyDocument, freeing included. The
+    // document takes over its buffer, so its runs pay for a copy of the inflated chunk as well
+    void benchNbt()
+    {
+        const auto chunks = inflatedChunks(mc::ServerContext::REGION_DIRECTORY);
+        size_t inflated = 0;
+        for (const auto& chunk : chunks)
+            inflated += chunk.size();
+        std::cout << "nbt: " << chunks.size() << " chunks, " << inflated / chunks.size() << " bytes of NBT per chunk\n";
+
+        const Allocations treeAllocations = allocationsOf([&]()
+        {
+            for (const auto& chunk : chunks)
+                mc::NBT::parse(chunk);
+        });
+        const double treeSeconds = secondsPerRun([&]()
+        {
+            for (const auto& chunk : chunks)
+                mc::NBT::parse(chunk);
+        });
+        // The tree holds nothing but what it allocated, except for the temporaries of parsing
+        reportNbt("tree", chunks.size(), treeSeconds, treeAllocations, treeAllocations.bytes);
+
+        size_t retained = 0;
+        const Allocations lazyAllocations = allocationsOf([&]()
+        {
+            for (const auto& chunk : chunks)
+                retained += mc::NBT::LazyDocument(chunk).MemoryUsage();
+        });
+        const double lazySeconds = secondsPerRun([&]()
+        {
+            for (const auto& chunk : chunks)
+                mc::NBT::LazyDocument document(chunk);
+        });
+        reportNbt("lazy", chunks.size(), lazySeconds, lazyAllocations, retained);
+    }
+
+    // writeVarInt as it was before VarInt.h, a push_back per byte. Never ends on negative values
+    void byteLoopWriteVarInt(std::vector<std::uint8_t>& buffer, std::int32_t value)
+    {
+        while ((value & ~std::int32_t(mc::util::SEGMENT_BIT)) != 0)
+        {
+            buffer.push_back((value & mc::util::SEGMENT_BIT) | mc::util::CONTINUE_BIT);
+            value >>= 7;
+        }
+        buffer.push_back(value);
+    }
+
+    // Bit widths from 1 to 31 equally often so every size from 1 to 5 bytes shows up, negative
+    // values are left out since the old writer can't encode them
+    std::vector<std::int32_t> varIntValues()
+    {
+        std::mt19937 random(VARINT_SEED);
+        std::uniform_int_distribution<int> width(1, 31);
+        std::vector<std::int32_t> values(VARINT_COUNT);
+        for (std::int32_t& value : values)
+            value = std::int32_t(random() & ((1u << width(random)) - 1));
+        return values;
+    }
+
+    void reportVarInt(std::string_view operation, double seconds, double byteLoopSeconds)
+    {
+        std::cout << std::fixed << std::setprecision(2)
+                  << "varint: " << operation << ", " << seconds / VARINT_COUNT * 1e9 << " ns per value, byte loop "
+                  << byteLoopSeconds / VARINT_COUNT * 1e9 << " ns per value\n";
+    }
+
+    // Both sides write into and read from the same buffers, so only the coding itself differs
+    void benchVarInt()
+    {
+        const auto values = varIntValues();
+
+        std::vector<std::uint8_t> encoded;
+        std::vector<std::uint8_t> byteLoopEncoded;
+        const double encodeSeconds = secondsPerRun([&]()
+        {
+            encoded.clear();
+            for (const std::int32_t value : values)
+                mc::util::writeVarInt(encoded, value);
+        });
+        const double byteLoopEncodeSeconds = secondsPerRun([&]()
+        {
+            byteLoopEncoded.clear();
+            for (const std::int32_t value : values)
+                byteLoopWriteVarInt(byteLoopEncoded, value);
+        });
+        if (encoded != byteLoopEncoded)
+            throw std::runtime_error("The encoders disagree");
+        reportVarInt("encode", encodeSeconds, byteLoopEncodeSeconds);
+
+        std::int64_t expected = 0;
+        for (const std::int32_t value : values)
+            expected += value;
+
+        std::int64_t sum = 0;
+        const double decodeSeconds = secondsPerRun([&]()
+        {
+            sum = 0;
+            for (size_t position = 0; position < encoded.size();)
+                sum += mc::util::readVarInt(encoded, position);
+        });
+        std::int64_t byteLoopSum = 0;
+        const double byteLoopDecodeSeconds = secondsPerRun([&]()
+        {
+            byteLoopSum = 0;
+            for (auto it = encoded.cbegin(); it != encoded.cend();)
+                byteLoopSum += mc::util::readVarInt(it);
+        });
+        if (sum != expected || byteLoopSum != expected)
+            throw std::runtime_error("The decoders disagree");
+        reportVarInt("decode", decodeSeconds, byteLoopDecodeSeconds);
+    }
+
+    void reportRegistry(std::string_view source, double seconds)
+    {
+        std::cout << std::fixed << std::setprecision(3)
+                  << "registry: " << source << ", " << mc::BlockStateRegistry::Instance().StateCount() << " states, "
+                  << seconds * 1e3 << " ms per load\n";
+    }
+
+    // The registry is left loaded after the last run so its size can be reported. The first load of
+    // the report writes its snapshot, the ones after it are snapshot loads
+    template<typename Init>
+    double registrySeconds(Init&& init)
+    {
+        bool loaded = false;
+        return secondsPerRun([&]()
+        {
+            if (std::exchange(loaded, true))
+                mc::BlockStateRegistry::Deinit();
+            init();
+        });
+    }
+
+    void benchRegistry()
+    {
+        const double builtinSeconds = registrySeconds([]() { mc::BlockStateRegistry::InitBuiltin(); });
+        reportRegistry("builtin", builtinSeconds);
+        mc::BlockStateRegistry::Deinit();
+
+        if (!std::filesystem::exists(BLOCK_REPORT))
+            return;
+        const double reportSeconds = registrySeconds([]() { mc::BlockStateRegistry::Init(BLOCK_REPORT); });
+        reportRegistry(BLOCK_REPORT, reportSeconds);
+        mc::BlockStateRegistry::Deinit();
+    }
+}
+
+// Only counts, the default operator delete already hands memory back with std::free
+void* operator new(size_t size)
+{
+    ++t_allocations;
+    t_allocatedBytes += size;
+    if (void* memory = std::malloc(size == 0 ? 1 : size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " chunks [threads] | compression | nbt | varint | registry\n";
+        return 2;
+    }
+
+    try
+    {
+        const std::string_view benchmark = argv[1];
+        if (benchmark == "chunks")
+            benchChunks(argc, argv);
+        else if (benchmark == "compression")
+            withContext([](const mc::ServerContext& context) { benchCompression(context); });
+        else if (benchmark == "nbt")
+            benchNbt();
+        else if (benchmark == "varint")
+            benchVarInt();
+        else if (benchmark == "registry")
+            benchRegistry();
+        else
+            throw std::runtime_error("Unknown benchmark " + std::string(benchmark));
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "mc-bench: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,311 @@
+// Turns the vanilla data reports into headers of constexpr tables, run by the build:
+//   registry-generator <output dir> <registries.json> <blocks.json>
+// Writes Registries.h and Blocks.h.
+// Headers whose content did not change are left alone so they don't trigger a rebuild
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "RegistryTables.h"
+
+namespace
+{
+    // The block report lists properties in their layout order, which a sorted json object would lose
+    using OrderedJson = nlohmann::ordered_json;
+
+    // Entries per line of the state arrays
+    constexpr size_t ROW_SIZE = 32;
+
+    OrderedJson readJson(const std::filesystem::path& path)
+    {
+        std::ifstream file(path);
+        if (!file)
+            throw std::runtime_error("Failed to open " + path.string());
+        return OrderedJson::parse(file);
+    }
+
+    // "minecraft:oak_stairs" -> OAK_STAIRS, "mod:ambient.cave" -> MOD_AMBIENT_CAVE
+    std::string constantName(std::string_view name)
+    {
+        if (name.starts_with("minecraft:"))
+            name.remove_prefix(std::string_view("minecraft:").size());
+
+        std::string out;
+        if (name.empty() || std::isdigit((unsigned char)name.front()))
+            out += 'N';
+        for (const char c : name)
+            out += std::isalnum((unsigned char)c) ? (char)std::toupper((unsigned char)c) : '_';
+        return out;
+    }
+
+    // "minecraft:worldgen/biome" -> worldgen_biome
+    std::string namespaceName(std::string_view name)
+    {
+        std::string out = constantName(name);
+        for (char& c : out)
+            c = std::tolower((unsigned char)c);
+        return out;
+    }
+
+    std::string literal(std::string_view text)
+    {
+        std::string out = "\"";
+        for (const char c : text)
+        {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            out += c;
+        }
+        return out + '"';
+    }
+
+    // Vanilla has no clashes, a data pack might
+    void checkUnique(std::set<std::string>& names, const std::string& name, std::string_view where)
+    {
+        if (!names.insert(name).second)
+            throw std::runtime_error("Two entries of " + std::string(where) + " are both named " + name);
+    }
+
+    template<typename T>
+    void writeArray(std::ostream& out, std::string_view declaration, const std::vector<T>& values)
+    {
+        out << "    inline constexpr " << declaration << "[] = {";
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            out << (i % ROW_SIZE == 0 ? "\n        " : " ") << +values[i] << ',';
+        }
+        out << "\n    };\n\n";
+    }
+
+    void writeIfChanged(const std::filesystem::path& path, const std::string& content)
+    {
+        std::ifstream existing(path, std::ios::binary);
+        if (existing)
+        {
+            std::stringstream current;
+            current << existing.rdbuf();
+            if (current.str() == content)
+                return;
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << content;
+        if (!file.flush())
+            throw std::runtime_error("Failed to write " + path.string());
+    }
+
+    void writeHeaderStart(std::ostream& out, std::string_view guard, std::string_view source)
+    {
+        out << "// Generated by registry-generator from " << source << ", do not edit\n"
+            << "#ifndef " << guard << "\n#define " << guard << "\n\n";
+    }
+
+    // ##############
+    // # Registries #
+    // ##############
+
+    std::string generateRegistries(const OrderedJson& registries)
+    {
+        std::ostringstream out;
+        writeHeaderStart(out, "GENERATED_REGISTRIES_H", "registries.json");
+        out << "#include <array>\n#include <string_view>\n\nnamespace mc::generated::registries\n{\n";
+
+        for (const auto& [registryName, registry] : registries.items())
+        {
+            // Ordered by protocol id so NAMES can be indexed with one
+            std::map<int, std::string> entries;
+            for (const auto& [entryName, entry] : registry.at("entries").items())
+            {
+                if (!entries.emplace(entry.at("protocol_id").get<int>(), entryName).second)
+                    throw std::runtime_error(registryName + " uses protocol id " + entry.at("protocol_id").dump() + " twice");
+            }
+
+            std::set<std::string> names;
+            out << "    namespace " << namespaceName(registryName) << "\n    {\n";
+            for (const auto& [id, entryName] : entries)
+            {
+                const std::string name = constantName(entryName);
+                checkUnique(names, name, registryName);
+                out << "        inline constexpr int " << name << " = " << id << ";\n";
+            }
+
+            // Protocol ids are dense in vanilla, holes stay empty
+            const int count = entries.empty() ? 0 : entries.rbegin()->first + 1;
+            out << "\n        inline constexpr std::array<std::string_view, " << count << "> NAMES = {";
+            for (int id = 0; id < count; ++id)
+            {
+                const auto entry = entries.find(id);
+                out << "\n            " << (entry == entries.end() ? std::string("\"\"") : literal(entry->second)) << ',';
+            }
+            out << "\n        };\n    }\n\n";
+        }
+
+        out << "}\n\n#endif //GENERATED_REGISTRIES_H\n";
+        return out.str();
+    }
+
+    // ##########
+    // # Blocks #
+    // ##########
+
+    bool isAir(std::string_view name)
+    {
+        return name == "minecraft:air" || name == "minecraft:cave_air" || name == "minecraft:void_air";
+    }
+
+    // Same layout rules BlockStateRegistry checks when it loads the report at runtime
+    std::string generateBlocks(const OrderedJson& blocks)
+    {
+        std::ostringstream values;
+        std::ostringstream properties;
+        std::ostringstream types;
+        // Most blocks share a handful of value lists (facing, half, waterlogged...)
+        std::map<std::vector<std::string>, std::string> valueLists;
+        std::set<std::string> names;
+        std::vector<std::string> all;
+
+        std::vector<std::uint32_t> stateBlocks;
+        std::vector<std::uint8_t> stateFlags;
+        std::vector<std::uint8_t> lightEmission;
+
+        for (const auto& [blockName, block] : blocks.items())
+        {
+            const std::string name = constantName(blockName);
+            checkUnique(names, name, "blocks");
+
+            struct Property
+            {
+                std::string name;
+                std::vector<std::string> values;
+                int stride;
+            };
+            std::vector<Property> blockProperties;
+            if (block.contains("properties"))
+            {
+                for (const auto& [propertyName, propertyValues] : block.at("properties").items())
+                    blockProperties.push_back({ propertyName, propertyValues.get<std::vector<std::string>>(), 0 });
+            }
+
+            int stateCount = 1;
+            for (auto it = blockProperties.rbegin(); it != blockProperties.rend(); ++it)
+            {
+                it->stride  = stateCount;
+                stateCount *= it->values.size();
+            }
+
+            const auto& states = block.at("states");
+            if (states.size() != size_t(stateCount))
+                throw std::runtime_error(blockName + " lists " + std::to_string(states.size()) + " states, its properties make " + std::to_string(stateCount));
+
+            const int baseStateId = states.front().at("id").get<int>();
+            int defaultStateId    = baseStateId;
+            if (stateBlocks.size() < size_t(baseStateId + stateCount))
+            {
+                stateBlocks.resize(baseStateId + stateCount, mc::generated::NO_BLOCK);
+                stateFlags.resize(baseStateId + stateCount, 0);
+                lightEmission.resize(baseStateId + stateCount, 0);
+            }
+
+            for (const auto& state : states)
+            {
+                int stateId = baseStateId;
+                for (const Property& property : blockProperties)
+                {
+                    const auto value = state.at("properties").at(property.name).get<std::string>();
+                    const auto index = std::find(property.values.begin(), property.values.end(), value);
+                    if (index == property.values.end())
+                        throw std::runtime_error(blockName + " has an unknown " + property.name + " value " + value);
+                    stateId += (index - property.values.begin()) * property.stride;
+                }
+                if (stateId != state.at("id").get<int>())
+                    throw std::runtime_error(blockName + " state " + state.at("id").dump() + " does not follow the vanilla layout");
+
+                if (state.value("default", false))
+                    defaultStateId = stateId;
+
+                stateBlocks[stateId]   = all.size();
+                stateFlags[stateId]    = (isAir(blockName) ? mc::generated::AIR_FLAG : 0) | (state.value("opaque", false) ? mc::generated::OPAQUE_FLAG : 0);
+                lightEmission[stateId] = state.value("light_emission", 0);
+            }
+
+            std::string propertySpan = "{}";
+            if (!blockProperties.empty())
+            {
+                properties << "        inline constexpr BlockProperty " << name << "[] = {\n";
+                for (const Property& property : blockProperties)
+                {
+                    auto [list, added] = valueLists.emplace(property.values, "V" + std::to_string(valueLists.size()));
+                    if (added)
+                    {
+                        values << "        inline constexpr std::string_view " << list->second << "[] = {";
+                        for (const std::string& value : property.values)
+                            values << ' ' << literal(value) << ',';
+                        values << " };\n";
+                    }
+                    properties << "            { " << literal(property.name) << ", values::" << list->second << ", " << property.stride << " },\n";
+                }
+                properties << "        };\n";
+                propertySpan = "properties::" + name;
+            }
+
+            types << "    inline constexpr BlockType " << name << "{ " << literal(blockName) << ", " << baseStateId << ", "
+                << stateCount << ", " << defaultStateId << ", " << propertySpan << " };\n";
+            all.push_back(name);
+        }
+
+        std::ostringstream out;
+        writeHeaderStart(out, "GENERATED_BLOCKS_H", "blocks.json");
+        out << "#include <array>\n#include <cstdint>\n#include <string_view>\n\n#include \"RegistryTables.h\"\n\n"
+            << "namespace mc::generated::blocks\n{\n"
+            << "    inline constexpr size_t STATE_COUNT = " << stateBlocks.size() << ";\n\n"
+            << "    namespace values\n    {\n" << values.str() << "    }\n\n"
+            << "    namespace properties\n    {\n" << properties.str() << "    }\n\n"
+            << types.str() << '\n';
+
+        out << "    inline constexpr std::array<const BlockType*, " << all.size() << "> ALL = {";
+        for (size_t i = 0; i < all.size(); ++i)
+            out << (i % 8 == 0 ? "\n        " : " ") << '&' << all[i] << ',';
+        out << "\n    };\n\n";
+
+        out << "    // Indexed by state id\n";
+        writeArray(out, "std::uint32_t STATE_BLOCKS", stateBlocks);
+        writeArray(out, "std::uint8_t STATE_FLAGS", stateFlags);
+        writeArray(out, "std::uint8_t LIGHT_EMISSION", lightEmission);
+        out << "}\n\n#endif //GENERATED_BLOCKS_H\n";
+        return out.str();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 4)
+    {
+        std::cerr << "Usage: " << argv[0] << " <output dir> <registries.json> <blocks.json>\n";
+        return 2;
+    }
+
+    try
+    {
+        const std::filesystem::path output = argv[1];
+        std::filesystem::create_directories(output);
+        writeIfChanged(output / "Registries.h", generateRegistries(readJson(argv[2])));
+        writeIfChanged(output / "Blocks.h", generateBlocks(readJson(argv[3])));
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "registry-generator: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}